@@ -23,6 +23,15 @@ getScratchConfigForCvtLayout(triton::gpu::ConvertLayoutOp op, unsigned &inVec,
                              unsigned &outVec);
 SmallVector<unsigned> getRepShapeForCvtLayout(triton::gpu::ConvertLayoutOp op);
 
+/// Same as above, for a conversion from \p srcTy to \p dstTy that does not
+/// exist in the IR yet.
+SmallVector<unsigned> getScratchConfigForCvtLayout(RankedTensorType srcTy,
+                                                   RankedTensorType dstTy,
+                                                   unsigned &inVec,
+                                                   unsigned &outVec);
+SmallVector<unsigned> getRepShapeForCvtLayout(RankedTensorType srcTy,
+                                              RankedTensorType dstTy);
+
 } // namespace triton
 
 /// Modified from llvm-15.0: llvm/ADT/AddressRanges.h
@@ -135,6 +144,12 @@ public:
   /// Returns the size of total shared memory allocated
   size_t getSharedMemorySize() const { return sharedMemorySize; }
 
+  /// Returns the size of total shared memory that first-fit graph coloring
+  /// would have allocated. Only used to report the packing improvement.
+  size_t getFirstFitSharedMemorySize() const {
+    return firstFitSharedMemorySize;
+  }
+
 private:
   /// A class that represents a shared memory buffer
   struct BufferT {
@@ -197,6 +212,7 @@ private:
   AliasBufferMapT aliasBuffer;
   BufferSetT bufferSet;
   size_t sharedMemorySize = 0;
+  size_t firstFitSharedMemorySize = 0;
 
   friend class triton::AllocationAnalysis;
 };
@@ -361,6 +361,11 @@ public:
 
   unsigned getPtrAlignment(Value ptr);
 
+  /// Returns the axis info of the addresses accessed through the tensor
+  /// pointer `ptr`, derived from the bases, strides and offsets of the
+  /// `tt.make_tensor_ptr` and `tt.advance` ops it can come from.
+  AxisInfo getTensorPointerAxisInfo(Value ptr);
+
   unsigned getMaskAlignment(Value mask);
 
 private:
@@ -0,0 +1,60 @@
+#ifndef TRITON_ANALYSIS_BANKCONFLICTS_H
+#define TRITON_ANALYSIS_BANKCONFLICTS_H
+
+#include "triton/Dialect/TritonGPU/IR/Dialect.h"
+
+#include <optional>
+#include <utility>
+
+namespace mlir {
+
+/// Shared memory is split into 32 banks of 4 bytes. Each bank serves one 4-byte
+/// word per cycle; lanes reading the same word are served by a broadcast.
+constexpr unsigned kNumSharedMemoryBanks = 32;
+constexpr unsigned kSharedMemoryBankBytes = 4;
+
+/// Returns the number of wavefronts needed to serve a warp-wide access to
+/// shared memory in which lane `i` accesses `accessBytes` bytes at byte offset
+/// `offsets[i]`. Accesses wider than a bank are served a half warp (64-bit)
+/// or a quarter warp (128-bit) at a time. 1 means conflict free.
+unsigned getBankConflictDegree(ArrayRef<int64_t> offsets, unsigned accessBytes);
+
+/// Returns the offset, in elements, of the element at `coord` in a tensor of
+/// shape `shape` stored in shared memory with `encoding`.
+int64_t getSharedMemoryOffset(triton::gpu::SharedEncodingAttr encoding,
+                              ArrayRef<int64_t> shape,
+                              ArrayRef<unsigned> coord);
+
+/// Returns the worst bank conflict degree of the accesses of the threads of
+/// the blocked layout of `type` to its elements stored in shared memory with
+/// `encoding`, `vec` contiguous elements at a time, or std::nullopt if the
+/// layouts are not modeled.
+std::optional<unsigned>
+getBlockedAccessBankConflicts(RankedTensorType type,
+                              triton::gpu::SharedEncodingAttr encoding,
+                              unsigned vec);
+
+/// Returns the worst bank conflict degree of the `ldmatrix` reads of the
+/// operands of MMAv2 dots from a 2D tensor of shape `shape` stored with
+/// `encoding`: every phase reads 16 bytes from 8 consecutive rows.
+unsigned getLdmatrixBankConflicts(triton::gpu::SharedEncodingAttr encoding,
+                                  ArrayRef<int64_t> shape,
+                                  unsigned elemBitWidth);
+
+/// Returns the worst bank conflict degrees of the stores and of the loads to
+/// the scratch buffer of a conversion between blocked layouts through shared
+/// memory, or std::nullopt for other conversions.
+std::optional<std::pair<unsigned, unsigned>>
+getConvertLayoutBankConflicts(triton::gpu::ConvertLayoutOp op);
+
+/// Returns the swizzling of a shared memory buffer holding `type`, with the
+/// dimensions ordered by `order`, that minimizes the bank conflicts of the
+/// accesses of its blocked layout `vec` elements at a time. Buffers are left
+/// unswizzled unless that causes conflicts.
+triton::gpu::SharedEncodingAttr
+getMinBankConflictSharedEncoding(RankedTensorType type,
+                                 ArrayRef<unsigned> order, unsigned vec);
+
+} // namespace mlir
+
+#endif // TRITON_ANALYSIS_BANKCONFLICTS_H
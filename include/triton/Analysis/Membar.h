@@ -8,6 +8,7 @@
 
 namespace mlir {
 
+class DominanceInfo;
 class OpBuilder;
 
 struct BlockInfo {
@@ -52,12 +53,25 @@ struct BlockInfo {
   bool operator!=(const BlockInfo &other) const { return !(*this == other); }
 
 private:
+  /// Both sets are ordered by start address, so a single sweep over them
+  /// finds an intersection: an interval intersects one of the intervals of
+  /// the other set that start before it iff it starts before the furthest
+  /// end among them.
   bool isIntersected(const IntervalSetT &lhsIntervalSet,
                      const IntervalSetT &rhsIntervalSet) const {
-    for (auto &lhs : lhsIntervalSet)
-      for (auto &rhs : rhsIntervalSet)
-        if (lhs.intersects(rhs))
-          return true;
+    auto lhsIt = lhsIntervalSet.begin(), lhsEnd = lhsIntervalSet.end();
+    auto rhsIt = rhsIntervalSet.begin(), rhsEnd = rhsIntervalSet.end();
+    size_t lhsMaxEnd = 0, rhsMaxEnd = 0;
+    while (lhsIt != lhsEnd || rhsIt != rhsEnd) {
+      bool fromLhs =
+          rhsIt == rhsEnd || (lhsIt != lhsEnd && *lhsIt < *rhsIt);
+      auto &interval = fromLhs ? *lhsIt++ : *rhsIt++;
+      size_t &maxEnd = fromLhs ? lhsMaxEnd : rhsMaxEnd;
+      size_t otherMaxEnd = fromLhs ? rhsMaxEnd : lhsMaxEnd;
+      if (interval.size() > 0 && interval.start() < otherMaxEnd)
+        return true;
+      maxEnd = std::max(maxEnd, interval.end());
+    }
     return false;
   }
 };
@@ -81,6 +95,10 @@ public:
   /// a shared memory read. If the temporary storage is written but not read,
   /// it is considered as the problem of the operation itself but not the membar
   /// analysis.
+  /// Once every hazard is covered, the inserted barriers are revisited:
+  /// - A barrier is dropped if the remaining ones already order every access.
+  /// - A barrier inside a loop is hoisted to the loop entries if the hazard it
+  /// guards only comes from outside the loop.
   MembarAnalysis() = default;
   explicit MembarAnalysis(Allocation *allocation) : allocation(allocation) {}
 
@@ -103,20 +121,42 @@ private:
   ///        op6
   ///   op7
   /// TODO: Explain why we don't use ForwardAnalysis:
-  void resolve(FunctionOpInterface funcOp, FuncBlockInfoMapT *funcBlockInfoMap,
-               OpBuilder *builder);
-
-  /// Updates the BlockInfo operation based on the operation.
-  void update(Operation *operation, BlockInfo *blockInfo,
+  /// Without a builder, no barrier is inserted and false is returned as soon
+  /// as one would be needed.
+  bool resolve(FunctionOpInterface funcOp, FuncBlockInfoMapT *funcBlockInfoMap,
+               OpBuilder *builder,
+               DenseMap<Block *, BlockInfo> &outputBlockInfoMap);
+
+  /// Updates the BlockInfo operation based on the operation. Without a
+  /// builder, returns false if the operation needs a barrier instead.
+  bool update(Operation *operation, BlockInfo *blockInfo,
               FuncBlockInfoMapT *funcBlockInfoMap, OpBuilder *builder);
 
+  /// Collects the shared memory intervals read and written by the operation.
+  BlockInfo getBlockInfo(Operation *operation,
+                         FuncBlockInfoMapT *funcBlockInfoMap);
+
   /// Collects the successors of the terminator
   void visitTerminator(Operation *operation, SmallVector<Block *> &successors);
 
-  void insertBarrier(Operation *operation, OpBuilder *builder);
+  Operation *insertBarrier(Operation *operation, OpBuilder *builder);
+
+  /// Drops or hoists the barriers inserted by resolve() as long as the
+  /// function stays free of hazards. The accesses around barriers are
+  /// computed once, and updated as barriers are dropped or hoisted.
+  void optimizeBarriers(FunctionOpInterface funcOp,
+                        FuncBlockInfoMapT *funcBlockInfoMap);
+
+  /// Returns the header of the loop that contains the barrier and collects
+  /// the blocks entering it, if the barrier is reached from the header
+  /// without branching. Returns nullptr otherwise.
+  Block *getLoopEntries(Operation *barrier, DominanceInfo &domInfo,
+                        SmallVector<Block *> &entries);
 
 private:
   Allocation *allocation = nullptr;
+  /// Barriers inserted by resolve() to cover a hazard.
+  SmallVector<Operation *> insertedBarriers;
 };
 
 /// Postorder traversal on the callgraph to insert membar instructions
@@ -0,0 +1,93 @@
+#ifndef TRITON_ANALYSIS_RANGEANALYSIS_H
+#define TRITON_ANALYSIS_RANGEANALYSIS_H
+
+#include "mlir/Analysis/DataFlow/SparseAnalysis.h"
+#include "mlir/Interfaces/InferIntRangeInterface.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "mlir/Support/LLVM.h"
+
+#include <optional>
+
+namespace mlir {
+
+//===----------------------------------------------------------------------===//
+// IntegerRange
+//===----------------------------------------------------------------------===//
+
+/// This lattice value represents the signed and unsigned bounds of an integer
+/// scalar, or of every element of an integer tensor.
+class IntegerRange {
+public:
+  IntegerRange() = default;
+  IntegerRange(ConstantIntRanges range) : range(std::move(range)) {}
+
+  bool isUninitialized() const { return !range.has_value(); }
+  const ConstantIntRanges &getValue() const { return *range; }
+
+  bool operator==(const IntegerRange &other) const {
+    return range == other.range;
+  }
+
+  /// The pessimistic state covers every value of the element type, narrowed by
+  /// the `tt.min_value` / `tt.max_value` hints of function arguments.
+  static IntegerRange getPessimisticValueState(Value value);
+
+  /// The union of both ranges
+  static IntegerRange join(const IntegerRange &lhs, const IntegerRange &rhs);
+
+  void print(raw_ostream &os) const {
+    if (isUninitialized())
+      os << "<uninitialized>";
+    else
+      os << getValue();
+  }
+
+private:
+  std::optional<ConstantIntRanges> range;
+};
+
+//===----------------------------------------------------------------------===//
+// IntegerRangeAnalysis
+//===----------------------------------------------------------------------===//
+
+/// Computes value ranges over integer scalars and tensors. The upstream
+/// analysis only reasons about scalars; this one also knows about
+/// tt.make_range, the program ids, shape manipulations and scf.for induction
+/// variables, and defers to InferIntRangeInterface for the arith ops.
+/// Ranges can be narrowed by the signed, inclusive `tt.min_value` and
+/// `tt.max_value` attributes, on function arguments and on operations.
+class TritonIntegerRangeAnalysis
+    : public dataflow::SparseForwardDataFlowAnalysis<
+          dataflow::Lattice<IntegerRange>> {
+private:
+  void setToEntryState(dataflow::Lattice<IntegerRange> *lattice) override {
+    propagateIfChanged(lattice,
+                       lattice->join(IntegerRange::getPessimisticValueState(
+                           lattice->getPoint())));
+  }
+
+  void visitNonControlFlowArguments(
+      Operation *op, const RegionSuccessor &successor,
+      ArrayRef<dataflow::Lattice<IntegerRange> *> argLattices,
+      unsigned firstIndex) override;
+
+public:
+  using dataflow::SparseForwardDataFlowAnalysis<
+      dataflow::Lattice<IntegerRange>>::SparseForwardDataFlowAnalysis;
+  using dataflow::SparseForwardDataFlowAnalysis<
+      dataflow::Lattice<IntegerRange>>::getLatticeElement;
+
+  void
+  visitOperation(Operation *op,
+                 ArrayRef<const dataflow::Lattice<IntegerRange> *> operands,
+                 ArrayRef<dataflow::Lattice<IntegerRange> *> results) override;
+};
+
+/// Returns the range \p solver computed for \p value, if any.
+std::optional<ConstantIntRanges> getIntegerRange(DataFlowSolver &solver,
+                                                 Value value);
+
+} // namespace mlir
+
+#endif
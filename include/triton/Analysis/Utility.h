@@ -72,11 +72,30 @@ private:
   int axis;
 };
 
+/// The registers, lanes and warps of a distributed layout, described as a
+/// blocked layout over a tensor whose dimensions may be split or padded with
+/// size-1 dimensions. Scans along `axis` of the view are scans of the original
+/// tensor.
+struct ScanBlockedView {
+  triton::gpu::BlockedEncodingAttr encoding;
+  SmallVector<int64_t> shape;
+  unsigned axis;
+  /// For each register of the view, the register of the original layout
+  /// holding it. Empty when the registers are in the same order.
+  SmallVector<unsigned> srcRegs;
+};
+
+/// Returns the blocked view of a scan along \p axis of a tensor of type
+/// \p type, or std::nullopt if its layout can't be described as a blocked
+/// layout with the scan axis kept in a single dimension.
+std::optional<ScanBlockedView> getScanBlockedView(RankedTensorType type,
+                                                  unsigned axis);
+
 class ScanLoweringHelper {
 public:
   explicit ScanLoweringHelper(triton::ScanOp op) : scanOp(op) {
     auto type = scanOp.getOperand(0).getType().cast<RankedTensorType>();
-    srcEncoding = type.getEncoding();
+    view = getScanBlockedView(type, scanOp.getAxis());
   }
   // Return true if the lowering of the scan op is supported.
   bool isSupported();
@@ -102,6 +121,12 @@ public:
   unsigned getNonAxisNumBlocks();
   // Return the size of the scratch space needed for scan lowering.
   unsigned getScratchSizeInBytes();
+  // Return the size of the scratch space holding the partial scans of each
+  // operand, in number of elements.
+  unsigned getScratchNumElementsPerOperand();
+  // Return the byte offset of the partial scans of each operand in the
+  // scratch space, followed by their total size.
+  SmallVector<unsigned> getScratchOperandOffsets();
 
   // Stride between contiguous element along axis dim.
   unsigned getAxisElementStride();
@@ -111,14 +136,20 @@ public:
   unsigned getAxisBlockStride();
 
   Location getLoc() { return scanOp.getLoc(); }
-  unsigned getAxis() { return scanOp.getAxis(); }
+  // The axis, encoding and shape of the blocked view of the operands.
+  unsigned getAxis() { return view->axis; }
   triton::gpu::BlockedEncodingAttr getEncoding();
   llvm::ArrayRef<int64_t> getShape();
+  // For each register of the blocked view, the register of the operands
+  // holding it, or an empty list if they are in the same order.
+  ArrayRef<unsigned> getSrcRegs() { return view->srcRegs; }
+  unsigned getNumOperands() { return scanOp.getNumOperands(); }
+  SmallVector<Type> getElementTypes();
   Region &getCombineOp();
 
 private:
   triton::ScanOp scanOp;
-  Attribute srcEncoding;
+  std::optional<ScanBlockedView> view;
 };
 
 bool maybeSharedAllocationOp(Operation *op);
@@ -135,6 +166,39 @@ bool isMmaToDotShortcut(RankedTensorType srcTy, RankedTensorType dstTy);
 
 bool isMmaToMmaShortcut(RankedTensorType srcTy, RankedTensorType dstTy);
 
+/// Returns the offsets of the elements held by a thread of a blocked layout
+/// relative to its base index, in the order the LLVM lowering stores them in
+/// registers.
+SmallVector<SmallVector<unsigned>>
+getBlockedRegisterOffsets(triton::gpu::BlockedEncodingAttr layout,
+                          ArrayRef<int64_t> shape);
+
+/// Returns the index of the first element held by lane \p lane of warp
+/// \p warp in a blocked layout, wrapping around warps and lanes that replicate
+/// the tensor like the LLVM lowering.
+SmallVector<unsigned>
+getBlockedThreadBase(triton::gpu::BlockedEncodingAttr layout,
+                     ArrayRef<int64_t> shape, unsigned warp, unsigned lane);
+
+/// A conversion between two blocked layouts in which every thread reads its
+/// elements from threads of the same warp, so it needs no shared memory.
+struct CvtLayoutWithinWarp {
+  /// Every thread already holds the elements it needs, and the conversion
+  /// only renames registers.
+  bool intraThread;
+  /// For each destination register, the source register holding its value,
+  /// either in the same thread or in the lane it is shuffled from. The
+  /// source lane is computed from the element's coordinates with the source
+  /// layout.
+  SmallVector<unsigned> srcRegs;
+};
+
+/// Returns how to convert \p srcTy to \p dstTy with register moves or warp
+/// shuffles, or std::nullopt if the conversion has to go through shared
+/// memory.
+std::optional<CvtLayoutWithinWarp>
+getCvtLayoutWithinWarp(RankedTensorType srcTy, RankedTensorType dstTy);
+
 // Return true if the src and dst layout match.
 bool matchMmaV3AndDotOperandLayout(RankedTensorType srcTy,
                                    RankedTensorType dstTy);
@@ -10,7 +10,9 @@ namespace gpu {
 
 std::unique_ptr<Pass> createPipelinePass(int numStages = 3, int numWarps = 4,
                                          int numCTAs = 1,
-                                         int computeCapability = 80);
+                                         int computeCapability = 80,
+                                         bool autoNumStages = false,
+                                         int maxSharedMem = 0);
 
 std::unique_ptr<Pass> createAccelerateMatmulPass(int computeCapability = 80);
 
@@ -34,6 +36,8 @@ std::unique_ptr<Pass> createOptimizeEpiloguePass();
 
 std::unique_ptr<Pass> createOptimizeThreadLocalityPass();
 
+std::unique_ptr<Pass> createReportBankConflictsPass();
+
 } // namespace gpu
 } // namespace triton
 
@@ -6,10 +6,13 @@
 #include "triton/Analysis/Alias.h"
 #include "triton/Dialect/TritonGPU/IR/Dialect.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
 
 #include <algorithm>
+#include <functional>
 #include <limits>
 #include <numeric>
+#include <optional>
 
 using ::mlir::triton::gpu::BlockedEncodingAttr;
 using ::mlir::triton::gpu::DotOperandEncodingAttr;
@@ -53,9 +56,8 @@ getCvtOrder(Attribute srcLayout, Attribute dstLayout) {
   return {inOrd, outOrd};
 }
 
-SmallVector<unsigned> getRepShapeForCvtLayout(triton::gpu::ConvertLayoutOp op) {
-  auto srcTy = op.getSrc().getType().cast<RankedTensorType>();
-  auto dstTy = op.getResult().getType().cast<RankedTensorType>();
+SmallVector<unsigned> getRepShapeForCvtLayout(RankedTensorType srcTy,
+                                              RankedTensorType dstTy) {
   Attribute srcLayout = srcTy.getEncoding();
   Attribute dstLayout = dstTy.getEncoding();
 
@@ -95,15 +97,20 @@ SmallVector<unsigned> getRepShapeForCvtLayout(triton::gpu::ConvertLayoutOp op) {
   return repShape;
 }
 
-SmallVector<unsigned>
-getScratchConfigForCvtLayout(triton::gpu::ConvertLayoutOp op, unsigned &inVec,
-                             unsigned &outVec) {
-  auto repShape = getRepShapeForCvtLayout(op);
+SmallVector<unsigned> getRepShapeForCvtLayout(triton::gpu::ConvertLayoutOp op) {
+  return getRepShapeForCvtLayout(
+      op.getSrc().getType().cast<RankedTensorType>(),
+      op.getResult().getType().cast<RankedTensorType>());
+}
+
+SmallVector<unsigned> getScratchConfigForCvtLayout(RankedTensorType srcTy,
+                                                   RankedTensorType dstTy,
+                                                   unsigned &inVec,
+                                                   unsigned &outVec) {
+  auto repShape = getRepShapeForCvtLayout(srcTy, dstTy);
   if (repShape.empty())
     return repShape;
 
-  auto srcTy = op.getSrc().getType().cast<RankedTensorType>();
-  auto dstTy = op.getResult().getType().cast<RankedTensorType>();
   Attribute srcLayout = srcTy.getEncoding();
   Attribute dstLayout = dstTy.getEncoding();
 
@@ -128,6 +135,14 @@ getScratchConfigForCvtLayout(triton::gpu::ConvertLayoutOp op, unsigned &inVec,
   return repShape;
 }
 
+SmallVector<unsigned>
+getScratchConfigForCvtLayout(triton::gpu::ConvertLayoutOp op, unsigned &inVec,
+                             unsigned &outVec) {
+  return getScratchConfigForCvtLayout(
+      op.getSrc().getType().cast<RankedTensorType>(),
+      op.getResult().getType().cast<RankedTensorType>(), inVec, outVec);
+}
+
 SmallVector<unsigned>
 getScratchConfigForStoreAsync(triton::nvidia_gpu::StoreAsyncOp op) {
   auto srcTy = op.getSrc().getType().cast<RankedTensorType>();
@@ -152,6 +167,61 @@ SmallVector<unsigned> getScratchConfigForAtomicCAS(triton::AtomicCASOp op) {
   return SmallVector<unsigned>{1};
 }
 
+/// A static index over a fixed set of intervals that enumerates the entries
+/// intersecting a query interval in O(log(n) + k * log(n)) time, where k is
+/// the number of reported entries. Entries are sorted by start and a segment
+/// tree keeps the maximum end of every subrange, so that subranges ending
+/// before the query starts are pruned.
+template <typename T> class IntervalIndex {
+public:
+  IntervalIndex() = default;
+
+  explicit IntervalIndex(SmallVector<std::pair<Interval<size_t>, T>> entries)
+      : entries(std::move(entries)) {
+    llvm::stable_sort(this->entries, [](const auto &lhs, const auto &rhs) {
+      return lhs.first.start() < rhs.first.start();
+    });
+    numLeaves = llvm::PowerOf2Ceil(std::max<size_t>(this->entries.size(), 1));
+    maxEnd.assign(2 * numLeaves, 0);
+    for (size_t i = 0; i < this->entries.size(); ++i)
+      maxEnd[numLeaves + i] = this->entries[i].first.end();
+    for (size_t i = numLeaves - 1; i > 0; --i)
+      maxEnd[i] = std::max(maxEnd[2 * i], maxEnd[2 * i + 1]);
+  }
+
+  /// Calls `fn` on every entry whose interval intersects `range`.
+  template <typename FnT>
+  void forEachIntersecting(Interval<size_t> range, FnT &&fn) const {
+    // Only entries starting before the end of the query can intersect it.
+    size_t limit = llvm::partition_point(entries,
+                                         [&](const auto &entry) {
+                                           return entry.first.start() <
+                                                  range.end();
+                                         }) -
+                   entries.begin();
+    visit(1, 0, numLeaves, limit, range, fn);
+  }
+
+private:
+  template <typename FnT>
+  void visit(size_t node, size_t lo, size_t hi, size_t limit,
+             Interval<size_t> range, FnT &fn) const {
+    if (lo >= limit || maxEnd[node] <= range.start())
+      return;
+    if (hi - lo == 1) {
+      fn(entries[lo].second);
+      return;
+    }
+    size_t mid = (lo + hi) / 2;
+    visit(2 * node, lo, mid, limit, range, fn);
+    visit(2 * node + 1, mid, hi, limit, range, fn);
+  }
+
+  SmallVector<std::pair<Interval<size_t>, T>> entries;
+  SmallVector<size_t> maxEnd;
+  size_t numLeaves = 0;
+};
+
 class AllocationAnalysis {
 public:
   AllocationAnalysis(Operation *operation,
@@ -254,10 +324,11 @@ private:
         // Conversions from/to shared memory do not need scratch memory.
         return;
       }
+      if (getCvtLayoutWithinWarp(srcTy, dstTy)) {
+        // Lowered to register moves or warp shuffles.
+        return;
+      }
       // ConvertLayoutOp with both input/output non-shared_layout
-      // TODO: Besides of implementing ConvertLayoutOp via shared memory, it's
-      //       also possible to realize it with other approaches in restricted
-      //       conditions, such as warp-shuffle
       unsigned inVec = 0;
       unsigned outVec = 0;
       auto smemShape = getScratchConfigForCvtLayout(cvtLayout, inVec, outVec);
@@ -472,29 +543,51 @@ private:
   }
 
   /// Computes the shared memory offsets for all related values.
-  /// Paper: Algorithms for Compile-Time Memory Optimization
-  /// (https://www.cs.utexas.edu/users/harrison/papers/compile-time.pdf)
+  ///
+  /// Two assignments are computed: the first-fit graph coloring below and an
+  /// interval packing driven by liveness and size (see packOffsets). The
+  /// packed assignment is only adopted when it strictly shrinks the total
+  /// shared memory, so offsets stay stable whenever coloring is already tight.
   void computeOffsets() {
     SmallVector<BufferT *> buffers;
+    SmallVector<std::pair<Interval<size_t>, BufferT *>> ranges;
     for (auto bufferIter : bufferRange) {
       buffers.emplace_back(bufferIter.first);
+      ranges.emplace_back(bufferIter.second, bufferIter.first);
     }
+    livenessIndex = IntervalIndex<BufferT *>(std::move(ranges));
 
+    computeColoredOffsets(buffers);
+    allocation->firstFitSharedMemorySize = allocation->sharedMemorySize;
+
+    DenseMap<BufferT *, size_t> packedStart;
+    size_t packedSize = packOffsets(buffers, packedStart);
+    if (packedSize < allocation->sharedMemorySize) {
+      for (auto *buffer : buffers)
+        buffer->offset = packedStart.lookup(buffer);
+      allocation->sharedMemorySize = packedSize;
+    }
+  }
+
+  /// Computes the shared memory offsets using first-fit graph coloring.
+  /// Paper: Algorithms for Compile-Time Memory Optimization
+  /// (https://www.cs.utexas.edu/users/harrison/papers/compile-time.pdf)
+  void computeColoredOffsets(const SmallVector<BufferT *> &buffers) {
     DenseMap<BufferT *, size_t> bufferStart;
     calculateStarts(buffers, bufferStart);
 
     // NOTE: The original paper doesn't consider interference between
     // the bumped ranges. Buffers that previously do not interfere with
     // could interfere after offset bumping if their liveness ranges overlap.
-    // Therefore, we rerun the interference graph algorithm after bumping so
-    // that we regroup the buffers and color them again. Since we always
-    // increase the buffer offset and keep reducing conflicts, we will
-    // eventually reach a fixed point.
+    // Therefore, we recompute the interference of the bumped buffers after
+    // each round so that we regroup the buffers and color them again. Since
+    // we always increase the buffer offset and keep reducing conflicts, we
+    // will eventually reach a fixed point.
     GraphT interference;
     buildInterferenceGraph(buffers, bufferStart, interference);
     do {
-      allocate(buffers, interference, bufferStart);
-      buildInterferenceGraph(buffers, bufferStart, interference);
+      auto bumped = allocate(buffers, interference, bufferStart);
+      updateInterferenceGraph(bumped, bufferStart, interference);
     } while (!interference.empty());
   }
 
@@ -521,23 +614,36 @@ private:
     using TripleMapT = std::multimap<size_t, Interval<size_t>>;
     TripleMapT tripleMap;
     tripleMap.insert(std::make_pair(0, Interval<size_t>()));
-    SmallVector<BufferT *> xBuffers = buffers;
-    while (!xBuffers.empty()) {
+    // Buffers are picked in their original order among the pending ones whose
+    // liveness range intersects the triple, which the index enumerates
+    // without scanning all pending buffers.
+    DenseMap<BufferT *, size_t> bufferIndex;
+    for (size_t i = 0; i < buffers.size(); ++i)
+      bufferIndex[buffers[i]] = i;
+    SmallVector<bool> pending(buffers.size(), true);
+    size_t numPending = buffers.size();
+    SmallVector<size_t> candidates;
+    while (numPending > 0) {
       auto tripleIt = tripleMap.begin();
       auto size = tripleIt->first;
       auto range = tripleIt->second;
       tripleMap.erase(tripleIt);
-      auto bufferIt =
-          std::find_if(xBuffers.begin(), xBuffers.end(), [&](auto *buffer) {
-            auto xRange = bufferRange[buffer];
-            bool res = xRange.intersects(range);
-            for (auto val : tripleMap)
-              res = res &&
-                    !val.second.intersects(xRange); // only one buffer intersect
-            return res;
-          });
-      if (bufferIt != xBuffers.end()) {
-        auto buffer = *bufferIt;
+      candidates.clear();
+      livenessIndex.forEachIntersecting(range, [&](BufferT *buffer) {
+        auto index = bufferIndex.lookup(buffer);
+        if (pending[index])
+          candidates.push_back(index);
+      });
+      llvm::sort(candidates);
+      auto candidateIt = llvm::find_if(candidates, [&](size_t index) {
+        auto xRange = bufferRange.lookup(buffers[index]);
+        // only one buffer intersect
+        return llvm::none_of(tripleMap, [&](const auto &val) {
+          return val.second.intersects(xRange);
+        });
+      });
+      if (candidateIt != candidates.end()) {
+        auto buffer = buffers[*candidateIt];
         auto xSize = buffer->size;
         auto xRange = bufferRange.lookup(buffer);
         // TODO(Keren): A buffer's size shouldn't be determined here, have to
@@ -556,11 +662,31 @@ private:
           tripleMap.insert({size, Interval{range.start(), xRange.end()}});
         if (xRange.end() < range.end())
           tripleMap.insert({size, Interval{xRange.start(), range.end()}});
-        xBuffers.erase(bufferIt);
+        pending[*candidateIt] = false;
+        --numPending;
       }
     }
   }
 
+  /// Adds edges between `x` and every buffer overlapping it in both liveness
+  /// and shared memory.
+  void addInterference(BufferT *x,
+                       const DenseMap<BufferT *, size_t> &bufferStart,
+                       GraphT &interference) {
+    auto xStart = bufferStart.lookup(x);
+    Interval xSizeRange = {xStart, xStart + x->size};
+    livenessIndex.forEachIntersecting(bufferRange.lookup(x), [&](BufferT *y) {
+      if (x == y)
+        return;
+      auto yStart = bufferStart.lookup(y);
+      Interval ySizeRange = {yStart, yStart + y->size};
+      if (xSizeRange.intersects(ySizeRange)) {
+        interference[x].insert(y);
+        interference[y].insert(x);
+      }
+    });
+  }
+
   /// Builds a graph of all shared memory values. Edges are created between
   /// shared memory values that are overlapping.
   void buildInterferenceGraph(const SmallVector<BufferT *> &buffers,
@@ -568,43 +694,62 @@ private:
                               GraphT &interference) {
     // Reset interference graph
     interference.clear();
-    for (auto x : buffers) {
-      for (auto y : buffers) {
-        if (x == y)
+    for (auto x : buffers)
+      addInterference(x, bufferStart, interference);
+  }
+
+  /// Updates the interference graph after the `bumped` buffers moved. Edges
+  /// between buffers that kept their offsets cannot change, so only the edges
+  /// of the bumped buffers are recomputed.
+  void updateInterferenceGraph(ArrayRef<BufferT *> bumped,
+                               const DenseMap<BufferT *, size_t> &bufferStart,
+                               GraphT &interference) {
+    SmallVector<BufferT *> touched;
+    for (auto *x : bumped) {
+      auto it = interference.find(x);
+      if (it == interference.end())
+        continue;
+      auto neighbors = std::move(it->second);
+      interference.erase(it);
+      for (auto *y : neighbors) {
+        auto yIt = interference.find(y);
+        if (yIt == interference.end())
           continue;
-        auto xStart = bufferStart.lookup(x);
-        auto yStart = bufferStart.lookup(y);
-        auto xSize = x->size;
-        auto ySize = y->size;
-        Interval xSizeRange = {xStart, xStart + xSize};
-        Interval ySizeRange = {yStart, yStart + ySize};
-        auto xOpRange = bufferRange.lookup(x);
-        auto yOpRange = bufferRange.lookup(y);
-        if (xOpRange.intersects(yOpRange) &&
-            xSizeRange.intersects(ySizeRange)) {
-          interference[x].insert(y);
-        }
+        yIt->second.erase(x);
+        touched.push_back(y);
       }
     }
+    for (auto *x : bumped)
+      addInterference(x, bufferStart, interference);
+    // Nodes without neighbors are not part of the graph.
+    for (auto *y : touched) {
+      auto it = interference.find(y);
+      if (it != interference.end() && it->second.empty())
+        interference.erase(it);
+    }
   }
 
   /// Finalizes shared memory offsets considering interference.
-  void allocate(const SmallVector<BufferT *> &buffers,
-                const GraphT &interference,
-                DenseMap<BufferT *, size_t> &bufferStart) {
-    // Reset shared memory size
-    allocation->sharedMemorySize = 0;
+  /// Returns the buffers whose offsets were bumped.
+  SmallVector<BufferT *> allocate(const SmallVector<BufferT *> &buffers,
+                                  const GraphT &interference,
+                                  DenseMap<BufferT *, size_t> &bufferStart) {
     // First-fit graph coloring
     // Neighbors are nodes that interfere with each other.
     // We color a node by finding the index of the first available
     // non-neighboring node or the first neighboring node without any color.
     // Nodes with the same color do not interfere with each other.
+    // Nodes without neighbors always get color 0 and keep their offsets, so
+    // only the nodes of the graph are colored.
+    SmallVector<BufferT *> nodes;
+    for (auto *x : buffers)
+      if (interference.count(x))
+        nodes.push_back(x);
     DenseMap<BufferT *, int> colors;
-    for (auto value : buffers) {
-      colors[value] = (value == buffers[0]) ? 0 : -1;
-    }
-    SmallVector<bool> available(buffers.size());
-    for (auto x : buffers) {
+    for (auto *x : nodes)
+      colors[x] = -1;
+    SmallVector<bool> available(nodes.size());
+    for (auto x : nodes) {
       std::fill(available.begin(), available.end(), true);
       for (auto y : interference.lookup(x)) {
         int color = colors[y];
@@ -621,23 +766,166 @@ private:
     // color2: [8, 12) -> [8 + 2 * 15, 12 + 2 * 15) -> [38, 42)
     // TODO(Keren): We are wasting memory here.
     // Nodes with color2 can actually start with 24.
-    for (auto x : buffers) {
+    SmallVector<BufferT *> bumped;
+    for (auto x : nodes) {
       size_t adj = 0;
       for (auto y : interference.lookup(x)) {
         adj = std::max(adj, bufferStart.lookup(y) + y->size);
       }
-      x->offset = bufferStart.lookup(x) + colors.lookup(x) * adj;
-      bufferStart[x] = x->offset;
+      auto offset = bufferStart.lookup(x) + colors.lookup(x) * adj;
+      if (offset != bufferStart.lookup(x))
+        bumped.push_back(x);
+      bufferStart[x] = offset;
+    }
+    // Reset shared memory size
+    allocation->sharedMemorySize = 0;
+    for (auto x : buffers) {
+      x->offset = bufferStart.lookup(x);
       allocation->sharedMemorySize =
           std::max(allocation->sharedMemorySize, x->offset + x->size);
     }
+    return bumped;
+  }
+
+  /// Returns an aligned offset for `buffer` that does not overlap any of the
+  /// buffers placed in `bufferStart` whose liveness ranges intersect its own.
+  /// With `bestFit`, the hole leaving the least slack is chosen; otherwise the
+  /// lowest hole is. If no hole fits, the buffer goes above all conflicts.
+  size_t findOffset(BufferT *buffer,
+                    const DenseMap<BufferT *, size_t> &bufferStart,
+                    bool bestFit) {
+    SmallVector<Interval<size_t>> occupied;
+    livenessIndex.forEachIntersecting(
+        bufferRange.lookup(buffer), [&](BufferT *other) {
+          auto it = bufferStart.find(other);
+          if (other == buffer || it == bufferStart.end())
+            return;
+          occupied.push_back({it->second, it->second + other->size});
+        });
+    llvm::sort(occupied);
+
+    auto alignUp = [&](size_t offset) {
+      return llvm::alignTo(offset, buffer->alignment);
+    };
+    std::optional<size_t> bestOffset;
+    size_t bestSlack = std::numeric_limits<size_t>::max();
+    size_t top = 0;
+    for (auto interval : occupied) {
+      size_t candidate = alignUp(top);
+      if (candidate + buffer->size <= interval.start()) {
+        if (!bestFit)
+          return candidate;
+        size_t slack = interval.start() - (candidate + buffer->size);
+        if (slack < bestSlack) {
+          bestSlack = slack;
+          bestOffset = candidate;
+        }
+      }
+      top = std::max(top, interval.end());
+    }
+    return bestOffset ? *bestOffset : alignUp(top);
+  }
+
+  /// Returns the maximum number of bytes simultaneously live, which no
+  /// assignment can go below.
+  size_t getLiveBytesLowerBound(ArrayRef<BufferT *> buffers) {
+    size_t bound = 0;
+    for (auto *x : buffers) {
+      auto point = bufferRange.lookup(x).start();
+      size_t bytes = 0;
+      for (auto *y : buffers)
+        if (bufferRange.lookup(y).contains(point))
+          bytes += y->size;
+      bound = std::max(bound, bytes);
+    }
+    return bound;
+  }
+
+  /// Computes shared memory offsets by interval packing and returns the total
+  /// shared memory size.
+  ///
+  /// Buffers are placed in decreasing order of size and liveness length, each
+  /// one into the best-fitting hole left by the already placed buffers whose
+  /// liveness ranges intersect its own. Since every placement avoids all
+  /// conflicts, no interference graph or fixed-point iteration is needed.
+  /// Small buffer sets are refined with a bounded branch-and-bound search.
+  size_t packOffsets(const SmallVector<BufferT *> &buffers,
+                     DenseMap<BufferT *, size_t> &bufferStart) {
+    SmallVector<BufferT *> order(buffers.begin(), buffers.end());
+    llvm::stable_sort(order, [&](BufferT *x, BufferT *y) {
+      auto xRange = bufferRange.lookup(x);
+      auto yRange = bufferRange.lookup(y);
+      if (x->size != y->size)
+        return x->size > y->size;
+      if (xRange.size() != yRange.size())
+        return xRange.size() > yRange.size();
+      return std::make_pair(xRange.start(), x->id) <
+             std::make_pair(yRange.start(), y->id);
+    });
+
+    size_t size = 0;
+    for (auto *buffer : order) {
+      auto offset = findOffset(buffer, bufferStart, /*bestFit=*/true);
+      bufferStart[buffer] = offset;
+      size = std::max(size, offset + buffer->size);
+    }
+
+    if (order.size() <= kMaxExactPackingBuffers)
+      size = searchOffsets(order, size, bufferStart);
+    return size;
+  }
+
+  /// Depth-first branch-and-bound over placement orders, placing each buffer
+  /// at its lowest feasible offset. Any packing can be compacted downwards
+  /// into one produced this way, so the search is exact unless it runs out of
+  /// its node budget. Returns the best size found and updates `bufferStart`
+  /// only if it beats `bestSize`.
+  size_t searchOffsets(ArrayRef<BufferT *> order, size_t bestSize,
+                       DenseMap<BufferT *, size_t> &bufferStart) {
+    const size_t lowerBound = getLiveBytesLowerBound(order);
+    size_t numNodes = 0;
+    DenseMap<BufferT *, size_t> start;
+    SmallVector<bool> used(order.size(), false);
+
+    std::function<void(size_t)> search = [&](size_t size) {
+      if (bestSize <= lowerBound || numNodes >= kMaxExactPackingNodes)
+        return;
+      if (start.size() == order.size()) {
+        bestSize = size;
+        bufferStart = start;
+        return;
+      }
+      for (size_t i = 0; i < order.size(); ++i) {
+        if (used[i])
+          continue;
+        ++numNodes;
+        auto *buffer = order[i];
+        auto offset = findOffset(buffer, start, /*bestFit=*/false);
+        auto newSize = std::max(size, offset + buffer->size);
+        if (newSize >= bestSize)
+          continue;
+        used[i] = true;
+        start[buffer] = offset;
+        search(newSize);
+        start.erase(buffer);
+        used[i] = false;
+      }
+    };
+    search(0);
+    return bestSize;
   }
 
 private:
+  /// Buffer sets up to this size are packed with an exact search.
+  static constexpr size_t kMaxExactPackingBuffers = 10;
+  /// Maximum number of placements tried by the exact search.
+  static constexpr size_t kMaxExactPackingNodes = 1 << 14;
+
   Operation *operation;
   Allocation::FuncAllocMapT *funcAllocMap;
   Allocation *allocation;
   BufferRangeMapT bufferRange;
+  IntervalIndex<BufferT *> livenessIndex;
 };
 
 } // namespace triton
@@ -1031,6 +1031,118 @@ unsigned ModuleAxisInfoAnalysis::getPtrAlignment(Value ptr) {
   return alignment;
 }
 
+// Product of two divisibilities, saturated to the largest one we track.
+static int64_t multiplyDivisibility(int64_t lhs, int64_t rhs) {
+  int64_t maxDivisibility = highestPowOf2Divisor<int64_t>(0);
+  if (lhs != 0 && rhs > maxDivisibility / lhs)
+    return maxDivisibility;
+  return lhs * rhs;
+}
+
+AxisInfo ModuleAxisInfoAnalysis::getTensorPointerAxisInfo(Value ptr) {
+  auto tensorTy = ptr.getType()
+                      .cast<triton::PointerType>()
+                      .getPointeeType()
+                      .cast<RankedTensorType>();
+  int rank = tensorTy.getRank();
+  AxisInfo pessimistic(AxisInfo::DimVectorT(rank, 1),
+                       AxisInfo::DimVectorT(rank, 1),
+                       AxisInfo::DimVectorT(rank, 1));
+
+  // Find all the tt.make_tensor_ptr and tt.advance ops `ptr` can come from.
+  SmallVector<triton::MakeTensorPtrOp> makeTensorPtrOps;
+  SmallVector<triton::AdvanceOp> advanceOps;
+  SmallVector<Value> worklist{ptr};
+  DenseSet<Value> visited;
+  while (!worklist.empty()) {
+    Value value = worklist.pop_back_val();
+    if (!visited.insert(value).second)
+      continue;
+    if (auto arg = value.dyn_cast<BlockArgument>()) {
+      auto forOp = dyn_cast<scf::ForOp>(arg.getOwner()->getParentOp());
+      if (!forOp || arg.getArgNumber() < forOp.getNumInductionVars())
+        return pessimistic;
+      unsigned idx = arg.getArgNumber() - forOp.getNumInductionVars();
+      worklist.push_back(forOp.getInitArgs()[idx]);
+      worklist.push_back(forOp.getBody()->getTerminator()->getOperand(idx));
+      continue;
+    }
+    Operation *op = value.getDefiningOp();
+    unsigned idx = value.cast<OpResult>().getResultNumber();
+    if (auto makeTensorPtrOp = dyn_cast<triton::MakeTensorPtrOp>(op)) {
+      makeTensorPtrOps.push_back(makeTensorPtrOp);
+    } else if (auto advanceOp = dyn_cast<triton::AdvanceOp>(op)) {
+      advanceOps.push_back(advanceOp);
+      worklist.push_back(advanceOp.getPtr());
+    } else if (auto forOp = dyn_cast<scf::ForOp>(op)) {
+      worklist.push_back(forOp.getInitArgs()[idx]);
+      worklist.push_back(forOp.getBody()->getTerminator()->getOperand(idx));
+    } else if (auto ifOp = dyn_cast<scf::IfOp>(op)) {
+      worklist.push_back(ifOp.thenYield().getOperand(idx));
+      worklist.push_back(ifOp.elseYield().getOperand(idx));
+    } else {
+      return pessimistic;
+    }
+  }
+  if (makeTensorPtrOps.empty())
+    return pessimistic;
+
+  auto getDivisibility = [&](Value value) -> int64_t {
+    AxisInfo *axisInfo = getAxisInfo(value);
+    return axisInfo ? axisInfo->getDivisibility(0) : 1;
+  };
+  // The divisibility of the base is in bytes, the one of the offsets and
+  // strides in elements.
+  int64_t baseDivisibility = 0;
+  AxisInfo::DimVectorT offsetDivisibility(rank, 0);
+  AxisInfo::DimVectorT strideDivisibility(rank, 0);
+  SmallVector<bool> unitStride(rank, true);
+  for (triton::MakeTensorPtrOp makeTensorPtrOp : makeTensorPtrOps) {
+    baseDivisibility =
+        gcd(baseDivisibility, getDivisibility(makeTensorPtrOp.getBase()));
+    for (int i = 0; i < rank; ++i) {
+      Value stride = makeTensorPtrOp.getStrides()[i];
+      offsetDivisibility[i] =
+          gcd(offsetDivisibility[i],
+              getDivisibility(makeTensorPtrOp.getOffsets()[i]));
+      strideDivisibility[i] =
+          gcd(strideDivisibility[i], getDivisibility(stride));
+      AxisInfo *strideInfo = getAxisInfo(stride);
+      unitStride[i] = unitStride[i] && strideInfo &&
+                      strideInfo->getConstantValue() == 1;
+    }
+  }
+  for (triton::AdvanceOp advanceOp : advanceOps) {
+    for (int i = 0; i < rank; ++i)
+      offsetDivisibility[i] = gcd(offsetDivisibility[i],
+                                  getDivisibility(advanceOp.getOffsets()[i]));
+  }
+
+  // Element (i_0, ..., i_n) of the tile is at
+  //   base + sum_d (offset_d + i_d) * stride_d * elemBytes
+  // A dimension with a unit stride is contiguous over the whole tile, so only
+  // the other indices move the start of its contiguous sequences.
+  int64_t elemBytes = std::max<int64_t>(tensorTy.getElementTypeBitWidth() / 8,
+                                        1);
+  auto tileShape = triton::gpu::getShapePerCTA(tensorTy);
+  AxisInfo::DimVectorT contiguity(rank, 1);
+  AxisInfo::DimVectorT divisibility(rank, 1);
+  for (int d = 0; d < rank; ++d) {
+    contiguity[d] = unitStride[d] ? tileShape[d] : 1;
+    int64_t divisibilityBytes = baseDivisibility;
+    for (int i = 0; i < rank; ++i) {
+      int64_t stride = multiplyDivisibility(elemBytes, strideDivisibility[i]);
+      divisibilityBytes =
+          gcd(divisibilityBytes,
+              multiplyDivisibility(stride, offsetDivisibility[i]));
+      if (i != d || contiguity[d] == 1)
+        divisibilityBytes = gcd(divisibilityBytes, stride);
+    }
+    divisibility[d] = divisibilityBytes;
+  }
+  return AxisInfo(contiguity, divisibility, AxisInfo::DimVectorT(rank, 1));
+}
+
 unsigned ModuleAxisInfoAnalysis::getMaskAlignment(Value mask) {
   auto tensorTy = mask.getType().dyn_cast<RankedTensorType>();
   if (!tensorTy)
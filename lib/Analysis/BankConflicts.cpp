@@ -0,0 +1,214 @@
+#include "triton/Analysis/BankConflicts.h"
+#include "triton/Analysis/Allocation.h"
+#include "triton/Analysis/Utility.h"
+#include "llvm/ADT/DenseSet.h"
+
+#include <algorithm>
+
+using ::mlir::triton::gpu::BlockedEncodingAttr;
+using ::mlir::triton::gpu::getCTALayout;
+using ::mlir::triton::gpu::getShapePerCTA;
+using ::mlir::triton::gpu::SharedEncodingAttr;
+
+namespace mlir {
+
+namespace {
+
+unsigned getElemBytes(Type elemTy) {
+  if (elemTy.isa<triton::PointerType>())
+    return 8;
+  return std::max<unsigned>(elemTy.getIntOrFloatBitWidth() / 8, 1);
+}
+
+// Worst bank conflict degree of the accesses of all the warps of `layout` to
+// the elements of a tensor of shape `shape` stored at `getOffset(coord)`.
+// Every instruction accesses `vec` registers of each lane, which hold
+// elements contiguous along order[0].
+unsigned getBlockedAccessBankConflicts(
+    BlockedEncodingAttr layout, ArrayRef<int64_t> shape, unsigned vec,
+    unsigned elemBytes,
+    function_ref<int64_t(ArrayRef<unsigned>)> getOffset) {
+  unsigned rank = shape.size();
+  unsigned numWarps = product<unsigned>(layout.getWarpsPerCTA());
+  unsigned numLanes = product<unsigned>(layout.getThreadsPerWarp());
+  auto regOffsets = getBlockedRegisterOffsets(layout, shape);
+  unsigned degree = 1;
+  for (unsigned warp = 0; warp < numWarps; ++warp) {
+    SmallVector<SmallVector<unsigned>> bases;
+    for (unsigned lane = 0; lane < numLanes; ++lane)
+      bases.push_back(getBlockedThreadBase(layout, shape, warp, lane));
+    for (unsigned reg = 0; reg < regOffsets.size(); reg += vec) {
+      SmallVector<int64_t> offsets;
+      for (const auto &base : bases) {
+        SmallVector<unsigned> coord(rank);
+        for (unsigned d = 0; d < rank; ++d)
+          coord[d] = (base[d] + regOffsets[reg][d]) % shape[d];
+        offsets.push_back(getOffset(coord) * elemBytes);
+      }
+      degree =
+          std::max(degree, getBankConflictDegree(offsets, vec * elemBytes));
+    }
+  }
+  return degree;
+}
+
+} // namespace
+
+unsigned getBankConflictDegree(ArrayRef<int64_t> offsets,
+                               unsigned accessBytes) {
+  unsigned wordsPerLane =
+      std::max<unsigned>(accessBytes / kSharedMemoryBankBytes, 1);
+  unsigned lanesPerPhase =
+      std::max<unsigned>(kNumSharedMemoryBanks / wordsPerLane, 1);
+  unsigned degree = 1;
+  for (unsigned first = 0; first < offsets.size(); first += lanesPerPhase) {
+    SmallVector<llvm::DenseSet<int64_t>> words(kNumSharedMemoryBanks);
+    unsigned last = std::min<unsigned>(first + lanesPerPhase, offsets.size());
+    for (unsigned lane = first; lane < last; ++lane) {
+      for (unsigned i = 0; i < wordsPerLane; ++i) {
+        int64_t word = offsets[lane] / kSharedMemoryBankBytes + i;
+        words[word % kNumSharedMemoryBanks].insert(word);
+      }
+    }
+    for (const auto &bankWords : words)
+      degree = std::max<unsigned>(degree, bankWords.size());
+  }
+  return degree;
+}
+
+int64_t getSharedMemoryOffset(SharedEncodingAttr encoding,
+                              ArrayRef<int64_t> shape,
+                              ArrayRef<unsigned> coord) {
+  auto order = encoding.getOrder();
+  unsigned rank = coord.size();
+  // Vectors of `vec` elements along order[0] are permuted by xor-ing their
+  // index with the phase of the row.
+  unsigned col = coord[order[0]];
+  if (rank >= 2) {
+    unsigned vec = encoding.getVec();
+    unsigned phase =
+        (coord[order[1]] / encoding.getPerPhase()) % encoding.getMaxPhase();
+    col = ((col / vec) ^ phase) * vec + col % vec;
+  }
+  int64_t offset = 0;
+  int64_t stride = 1;
+  for (unsigned i = 0; i < rank; ++i) {
+    unsigned d = order[i];
+    offset += (i == 0 ? col : coord[d]) * stride;
+    stride *= shape[d];
+  }
+  return offset;
+}
+
+std::optional<unsigned>
+getBlockedAccessBankConflicts(RankedTensorType type,
+                              SharedEncodingAttr encoding, unsigned vec) {
+  auto layout = type.getEncoding().dyn_cast<BlockedEncodingAttr>();
+  if (!layout || encoding.getHasLeadingOffset())
+    return std::nullopt;
+  // Only elements contiguous both in registers and in shared memory are
+  // accessed together.
+  unsigned contig = layout.getSizePerThread()[layout.getOrder()[0]];
+  vec = std::max(std::min(vec, contig), 1u);
+  if (layout.getOrder()[0] != encoding.getOrder()[0])
+    vec = 1;
+  auto shape = getShapePerCTA(type);
+  return getBlockedAccessBankConflicts(
+      layout, shape, vec, getElemBytes(type.getElementType()),
+      [&](ArrayRef<unsigned> coord) {
+        return getSharedMemoryOffset(encoding, shape, coord);
+      });
+}
+
+unsigned getLdmatrixBankConflicts(SharedEncodingAttr encoding,
+                                  ArrayRef<int64_t> shape,
+                                  unsigned elemBitWidth) {
+  auto order = encoding.getOrder();
+  unsigned elemBytes = std::max<unsigned>(elemBitWidth / 8, 1);
+  unsigned rowElems = 16 / elemBytes;
+  unsigned degree = 1;
+  for (unsigned row = 0; row + 8 <= shape[order[1]]; row += 8) {
+    for (unsigned col = 0; col + rowElems <= shape[order[0]];
+         col += rowElems) {
+      SmallVector<int64_t> offsets;
+      for (unsigned i = 0; i < 8; ++i) {
+        SmallVector<unsigned> coord(2);
+        coord[order[0]] = col;
+        coord[order[1]] = row + i;
+        offsets.push_back(getSharedMemoryOffset(encoding, shape, coord) *
+                          elemBytes);
+      }
+      degree = std::max(degree, getBankConflictDegree(offsets, 16));
+    }
+  }
+  return degree;
+}
+
+std::optional<std::pair<unsigned, unsigned>>
+getConvertLayoutBankConflicts(triton::gpu::ConvertLayoutOp op) {
+  auto srcTy = op.getSrc().getType().cast<RankedTensorType>();
+  auto dstTy = op.getResult().getType().cast<RankedTensorType>();
+  auto srcLayout = srcTy.getEncoding().dyn_cast<BlockedEncodingAttr>();
+  auto dstLayout = dstTy.getEncoding().dyn_cast<BlockedEncodingAttr>();
+  if (!srcLayout || !dstLayout || getCvtLayoutWithinWarp(srcTy, dstTy) ||
+      shouldUseDistSmem(srcLayout, dstLayout))
+    return std::nullopt;
+  unsigned inVec = 0;
+  unsigned outVec = 0;
+  SmallVector<unsigned> paddedRepShape =
+      triton::getScratchConfigForCvtLayout(op, inVec, outVec);
+  if (paddedRepShape.empty())
+    return std::nullopt;
+  SmallVector<unsigned> repShape = triton::getRepShapeForCvtLayout(op);
+  auto outOrd = dstLayout.getOrder();
+  // The elements of each replica are stored in the padded buffer, dimensions
+  // ordered as in the destination layout.
+  auto getOffset = [&](ArrayRef<unsigned> coord) {
+    int64_t offset = 0;
+    int64_t stride = 1;
+    for (unsigned d : outOrd) {
+      offset += (coord[d] % repShape[d]) * stride;
+      stride *= paddedRepShape[d];
+    }
+    return offset;
+  };
+  unsigned elemBytes = getElemBytes(srcTy.getElementType());
+  unsigned storeDegree = getBlockedAccessBankConflicts(
+      srcLayout, getShapePerCTA(srcTy), inVec, elemBytes, getOffset);
+  unsigned loadDegree = getBlockedAccessBankConflicts(
+      dstLayout, getShapePerCTA(dstTy), outVec, elemBytes, getOffset);
+  return std::make_pair(storeDegree, loadDegree);
+}
+
+SharedEncodingAttr getMinBankConflictSharedEncoding(RankedTensorType type,
+                                                    ArrayRef<unsigned> order,
+                                                    unsigned vec) {
+  MLIRContext *ctx = type.getContext();
+  auto CTALayout = getCTALayout(type.getEncoding());
+  // Vectors of `vec` elements let both the writes and the reads of the buffer
+  // be vectorized.
+  auto best = SharedEncodingAttr::get(ctx, vec, 1, 1, order, CTALayout);
+  std::optional<unsigned> bestDegree =
+      getBlockedAccessBankConflicts(type, best, vec);
+  if (!bestDegree || *bestDegree == 1 || order.size() < 2)
+    return best;
+  // Swizzle whole accesses, across at most the length of a row.
+  auto shape = getShapePerCTA(type);
+  for (unsigned maxPhase = 2; vec * maxPhase <= shape[order[0]];
+       maxPhase *= 2) {
+    for (unsigned perPhase = 1; perPhase * maxPhase <= shape[order[1]];
+         perPhase *= 2) {
+      auto encoding =
+          SharedEncodingAttr::get(ctx, vec, perPhase, maxPhase, order,
+                                  CTALayout);
+      unsigned degree = *getBlockedAccessBankConflicts(type, encoding, vec);
+      if (degree < *bestDegree) {
+        best = encoding;
+        bestDegree = degree;
+      }
+    }
+  }
+  return best;
+}
+
+} // namespace mlir
@@ -10,7 +10,9 @@
 
 #include "mlir/Dialect/GPU/IR/GPUDialect.h"
 #include "mlir/Dialect/Tensor/IR/Tensor.h"
+#include "mlir/IR/Dominance.h"
 #include <deque>
+#include <functional>
 
 namespace mlir {
 
@@ -18,15 +20,30 @@ void MembarAnalysis::run(FuncBlockInfoMapT &funcBlockInfoMap) {
   FunctionOpInterface funcOp =
       dyn_cast<FunctionOpInterface>(allocation->getOperation());
   OpBuilder builder(funcOp.getContext());
-  resolve(funcOp, &funcBlockInfoMap, &builder);
+  DenseMap<Block *, BlockInfo> outputBlockInfoMap;
+  resolve(funcOp, &funcBlockInfoMap, &builder, outputBlockInfoMap);
+  optimizeBarriers(funcOp, &funcBlockInfoMap);
+
+  // Update the final dangling buffers that haven't been synced
+  outputBlockInfoMap.clear();
+  bool synced =
+      resolve(funcOp, &funcBlockInfoMap, nullptr, outputBlockInfoMap);
+  assert(synced && "barrier optimization introduced a hazard");
+  (void)synced;
+  auto &funcBlockInfo = funcBlockInfoMap[funcOp];
+  funcOp.walk<WalkOrder::PreOrder>([&](Block *block) {
+    block->walk([&](triton::ReturnOp returnOp) {
+      funcBlockInfo.join(outputBlockInfoMap[block]);
+    });
+  });
 }
 
-void MembarAnalysis::resolve(FunctionOpInterface funcOp,
+bool MembarAnalysis::resolve(FunctionOpInterface funcOp,
                              FuncBlockInfoMapT *funcBlockInfoMap,
-                             OpBuilder *builder) {
+                             OpBuilder *builder,
+                             DenseMap<Block *, BlockInfo> &outputBlockInfoMap) {
   // Initialize the blockList
   DenseMap<Block *, BlockInfo> inputBlockInfoMap;
-  DenseMap<Block *, BlockInfo> outputBlockInfoMap;
   std::deque<Block *> blockList;
   funcOp.walk<WalkOrder::PreOrder>([&](Block *block) {
     for (auto &op : block->getOperations()) {
@@ -53,8 +70,8 @@ void MembarAnalysis::resolve(FunctionOpInterface funcOp,
     for (auto &op : block->getOperations()) {
       if (op.hasTrait<OpTrait::IsTerminator>()) {
         visitTerminator(&op, successors);
-      } else {
-        update(&op, &inputBlockInfo, funcBlockInfoMap, builder);
+      } else if (!update(&op, &inputBlockInfo, funcBlockInfoMap, builder)) {
+        return false;
       }
     }
     // Get the reference because we want to update if it changed
@@ -72,14 +89,242 @@ void MembarAnalysis::resolve(FunctionOpInterface funcOp,
       blockList.emplace_back(successor);
     }
   }
+  return true;
+}
 
-  // Update the final dangling buffers that haven't been synced
-  auto &funcBlockInfo = (*funcBlockInfoMap)[funcOp];
-  funcOp.walk<WalkOrder::PreOrder>([&](Block *block) {
-    block->walk([&](triton::ReturnOp returnOp) {
-      funcBlockInfo.join(outputBlockInfoMap[block]);
-    });
+namespace {
+
+// Ops that only create a view of shared memory or manage its allocation.
+bool isSharedMemoryView(Operation *op) {
+  // FIXME(Keren): extract_slice is always alias for now
+  return isa<triton::gpu::ExtractSliceOp, triton::gpu::AllocTensorOp,
+             triton::gpu::DeallocTensorOp, triton::TransOp,
+             triton::nvidia_gpu::AllocMBarrierOp>(op);
+}
+
+// Shared memory accesses that reach each block boundary without crossing a
+// barrier: the pending ones flow forward from the last barrier, the ones
+// ahead flow backward from the next barrier. A barrier is redundant if none
+// of the accesses pending at it conflicts with the accesses ahead of it.
+//
+// Removing a barrier only grows these sets, so they are updated from the
+// block of the removed barrier on. Adding barriers shrinks them; the sets
+// ahead are then left as they are, which is conservative.
+class BarrierLiveness {
+public:
+  using AccessFn = std::function<BlockInfo(Operation *)>;
+  using Snapshot = SmallVector<std::tuple<Block *, BlockInfo, BlockInfo>>;
+
+  BarrierLiveness(FunctionOpInterface funcOp, AccessFn getAccesses)
+      : getAccesses(std::move(getAccesses)) {
+    std::deque<Block *> blocks;
+    funcOp.walk([&](Block *block) { blocks.push_back(block); });
+    propagatePending(blocks);
+    propagateAhead(blocks);
+  }
+
+  /// Accesses since the last barrier that may be pending when `op` runs.
+  BlockInfo pendingAt(Operation *op) {
+    Block *block = op->getBlock();
+    return transferPending(block, pendingIn[block], op);
+  }
+
+  /// Accesses that may happen after `op` and before the next barrier.
+  BlockInfo aheadOf(Operation *op) {
+    Block *block = op->getBlock();
+    return transferAhead(block, aheadOut[block], op);
+  }
+
+  /// Updates the accesses once a barrier has been removed from `block`.
+  void barrierRemoved(Block *block) {
+    propagatePending({block});
+    propagateAhead({block});
+  }
+
+  /// Recomputes the pending accesses of `region`, the blocks dominated by
+  /// `header`, once barriers have been added to the end of `entries`, the
+  /// other predecessors of `header`.
+  void recomputePending(Block *header, ArrayRef<Block *> region,
+                        ArrayRef<Block *> entries) {
+    for (Block *entry : entries)
+      pendingOut[entry] = transferPending(entry, pendingIn[entry]);
+    for (Block *block : region) {
+      pendingIn.erase(block);
+      pendingOut.erase(block);
+    }
+    BlockInfo in;
+    for (Block *entry : entries)
+      in.join(pendingOut[entry]);
+    pendingIn[header] = in;
+    propagatePending({header});
+  }
+
+  Snapshot savePending(ArrayRef<Block *> blocks) {
+    Snapshot snapshot;
+    for (Block *block : blocks)
+      snapshot.emplace_back(block, pendingIn[block], pendingOut[block]);
+    return snapshot;
+  }
+
+  void restorePending(const Snapshot &snapshot) {
+    for (auto &[block, in, out] : snapshot) {
+      pendingIn[block] = in;
+      pendingOut[block] = out;
+    }
+  }
+
+private:
+  BlockInfo transferPending(Block *block, BlockInfo state,
+                            Operation *until = nullptr) {
+    for (Operation &op : *block) {
+      if (&op == until)
+        break;
+      visit(&op, state);
+    }
+    return state;
+  }
+
+  BlockInfo transferAhead(Block *block, BlockInfo state,
+                          Operation *until = nullptr) {
+    for (Operation &op : llvm::reverse(*block)) {
+      if (&op == until)
+        break;
+      visit(&op, state);
+    }
+    return state;
+  }
+
+  void visit(Operation *op, BlockInfo &state) {
+    if (isa<gpu::BarrierOp>(op))
+      state.sync();
+    else if (!op->hasTrait<OpTrait::IsTerminator>())
+      state.join(getAccesses(op));
+  }
+
+  void propagatePending(std::deque<Block *> worklist) {
+    while (!worklist.empty()) {
+      Block *block = worklist.front();
+      worklist.pop_front();
+      BlockInfo out = transferPending(block, pendingIn[block]);
+      auto it = pendingOut.find(block);
+      if (it != pendingOut.end() && it->second == out)
+        continue;
+      for (Block *successor : block->getSuccessors()) {
+        pendingIn[successor].join(out);
+        worklist.push_back(successor);
+      }
+      pendingOut[block] = std::move(out);
+    }
+  }
+
+  void propagateAhead(std::deque<Block *> worklist) {
+    while (!worklist.empty()) {
+      Block *block = worklist.front();
+      worklist.pop_front();
+      BlockInfo in = transferAhead(block, aheadOut[block]);
+      auto it = aheadIn.find(block);
+      if (it != aheadIn.end() && it->second == in)
+        continue;
+      for (Block *predecessor : block->getPredecessors()) {
+        aheadOut[predecessor].join(in);
+        worklist.push_back(predecessor);
+      }
+      aheadIn[block] = std::move(in);
+    }
+  }
+
+  AccessFn getAccesses;
+  DenseMap<Block *, BlockInfo> pendingIn, pendingOut;
+  DenseMap<Block *, BlockInfo> aheadIn, aheadOut;
+};
+
+} // namespace
+
+void MembarAnalysis::optimizeBarriers(FunctionOpInterface funcOp,
+                                      FuncBlockInfoMapT *funcBlockInfoMap) {
+  DenseMap<Operation *, BlockInfo> accesses;
+  BarrierLiveness liveness(funcOp, [&](Operation *op) {
+    if (isSharedMemoryView(op))
+      return BlockInfo();
+    auto it = accesses.find(op);
+    if (it == accesses.end())
+      it = accesses.try_emplace(op, getBlockInfo(op, funcBlockInfoMap)).first;
+    return it->second;
   });
+  DominanceInfo domInfo(funcOp);
+  OpBuilder builder(funcOp.getContext());
+  // Barriers hoisted out of an inner loop may be hoisted again out of the
+  // enclosing one.
+  for (unsigned i = 0; i < insertedBarriers.size(); ++i) {
+    Operation *barrier = insertedBarriers[i];
+    // Async waits must be followed by a barrier
+    if (isa_and_nonnull<triton::gpu::AsyncWaitOp, triton::gpu::AsyncBulkWaitOp>(
+            barrier->getPrevNode()))
+      continue;
+    Block *block = barrier->getBlock();
+    BlockInfo ahead = liveness.aheadOf(barrier);
+    // Merge with the barriers that remain
+    if (!liveness.pendingAt(barrier).isIntersected(ahead)) {
+      barrier->erase();
+      liveness.barrierRemoved(block);
+      continue;
+    }
+    // Hoist to the blocks entering the loop
+    SmallVector<Block *> entries;
+    Block *header = getLoopEntries(barrier, domInfo, entries);
+    if (!header)
+      continue;
+    SmallVector<Block *> region;
+    for (Block &other : *header->getParent())
+      if (domInfo.dominates(header, &other))
+        region.push_back(&other);
+    SmallVector<Block *> changed(region);
+    changed.append(entries.begin(), entries.end());
+    BarrierLiveness::Snapshot snapshot = liveness.savePending(changed);
+    SmallVector<Operation *> hoisted;
+    for (Block *entry : entries) {
+      builder.setInsertionPoint(entry->getTerminator());
+      hoisted.push_back(
+          builder.create<gpu::BarrierOp>(barrier->getLoc()).getOperation());
+    }
+    liveness.recomputePending(header, region, entries);
+    // The hoisted barriers only remove hazards; the ones ahead of the barrier
+    // are still valid, if conservative.
+    if (!liveness.pendingAt(barrier).isIntersected(ahead)) {
+      barrier->erase();
+      liveness.barrierRemoved(block);
+      insertedBarriers.append(hoisted.begin(), hoisted.end());
+      continue;
+    }
+    for (Operation *op : hoisted)
+      op->erase();
+    liveness.restorePending(snapshot);
+  }
+  insertedBarriers.clear();
+}
+
+Block *MembarAnalysis::getLoopEntries(Operation *barrier,
+                                      DominanceInfo &domInfo,
+                                      SmallVector<Block *> &entries) {
+  Block *header = barrier->getBlock();
+  llvm::SmallPtrSet<Block *, 4> visited{header};
+  while (Block *pred = header->getSinglePredecessor()) {
+    if (!visited.insert(pred).second)
+      return nullptr;
+    header = pred;
+  }
+  bool hasBackEdge = false;
+  for (Block *pred : header->getPredecessors()) {
+    if (domInfo.dominates(header, pred)) {
+      hasBackEdge = true;
+      continue;
+    }
+    // The barrier must not run on paths that bypass the loop
+    if (pred->getNumSuccessors() != 1)
+      return nullptr;
+    entries.push_back(pred);
+  }
+  return hasBackEdge && !entries.empty() ? header : nullptr;
 }
 
 void MembarAnalysis::visitTerminator(Operation *op,
@@ -97,7 +342,7 @@ void MembarAnalysis::visitTerminator(Operation *op,
   llvm_unreachable("Unknown terminator encountered in membar analysis");
 }
 
-void MembarAnalysis::insertBarrier(Operation *op, OpBuilder *builder) {
+Operation *MembarAnalysis::insertBarrier(Operation *op, OpBuilder *builder) {
   OpBuilder::InsertionGuard g(*builder);
   auto barrierOp = builder->create<gpu::BarrierOp>(op->getLoc());
   if (auto optionalAgentId = getWSAgentId(op)) {
@@ -112,34 +357,52 @@ void MembarAnalysis::insertBarrier(Operation *op, OpBuilder *builder) {
     barrierOp->setAttr("bar_id", builder->getI64IntegerAttr(barId));
     barrierOp->setAttr("num_threads", builder->getI64IntegerAttr(numThreads));
   }
+  return barrierOp;
 }
 
-void MembarAnalysis::update(Operation *op, BlockInfo *blockInfo,
+bool MembarAnalysis::update(Operation *op, BlockInfo *blockInfo,
                             FuncBlockInfoMapT *funcBlockInfoMap,
                             OpBuilder *builder) {
-  if (isa<triton::gpu::ExtractSliceOp, triton::gpu::AllocTensorOp,
-          triton::gpu::DeallocTensorOp, triton::TransOp,
-          triton::nvidia_gpu::AllocMBarrierOp>(op)) {
-    // FIXME(Keren): extract_slice is always alias for now
-    return;
-  }
+  if (isSharedMemoryView(op))
+    return true;
 
   if (isa<gpu::BarrierOp>(op)) {
     // If the current op is a barrier, we sync previous reads and writes
     blockInfo->sync();
-    return;
+    return true;
   }
 
   if (isa<triton::gpu::AsyncWaitOp, triton::gpu::AsyncBulkWaitOp>(op) &&
       !isa<gpu::BarrierOp>(op->getNextNode())) {
     // If the current op is an async wait and the next op is not a barrier we
     // insert a barrier op and sync
+    if (!builder)
+      return false;
     builder->setInsertionPointAfter(op);
     insertBarrier(op, builder);
     blockInfo->sync();
-    return;
+    return true;
   }
 
+  BlockInfo curBlockInfo = getBlockInfo(op, funcBlockInfoMap);
+  if (blockInfo->isIntersected(curBlockInfo)) {
+    if (!builder)
+      return false;
+    builder->setInsertionPoint(op);
+    auto *barrier = insertBarrier(op, builder);
+    // Named barriers of warp specialized agents are left in place
+    if (barrier->getAttrs().empty())
+      insertedBarriers.push_back(barrier);
+    blockInfo->sync();
+  }
+  // Update the region info, even if barrier is inserted, we have to maintain
+  // the current op's read/write buffers.
+  blockInfo->join(curBlockInfo);
+  return true;
+}
+
+BlockInfo MembarAnalysis::getBlockInfo(Operation *op,
+                                       FuncBlockInfoMapT *funcBlockInfoMap) {
   BlockInfo curBlockInfo;
   if (isa<triton::CallOp>(op)) {
     // Inter-function dependencies
@@ -148,51 +411,43 @@ void MembarAnalysis::update(Operation *op, BlockInfo *blockInfo,
             dyn_cast<FunctionOpInterface>(callOpInterface.resolveCallable())) {
       curBlockInfo = funcBlockInfoMap->lookup(callee);
     }
-  } else {
-    // Intra-function dependencies
-    for (Value value : op->getOperands()) {
-      for (auto bufferId : allocation->getBufferIds(value)) {
-        if (bufferId != Allocation::InvalidBufferId) {
-          if (isa<triton::gpu::InsertSliceAsyncOp,
-                  triton::nvidia_gpu::InsertSliceTMAOp, tensor::InsertSliceOp>(
-                  op)) {
-            // FIXME(Keren): insert_slice and insert_slice_async are always
-            // alias for now
-            curBlockInfo.syncWriteIntervals.insert(
-                allocation->getAllocatedInterval(bufferId));
-          } else {
-            // ConvertLayoutOp: shared memory -> registers
-            curBlockInfo.syncReadIntervals.insert(
-                allocation->getAllocatedInterval(bufferId));
-          }
-        }
-      }
-    }
-    for (Value value : op->getResults()) {
-      // ConvertLayoutOp: registers -> shared memory
-      auto bufferId = allocation->getBufferId(value);
+    return curBlockInfo;
+  }
+  // Intra-function dependencies
+  for (Value value : op->getOperands()) {
+    for (auto bufferId : allocation->getBufferIds(value)) {
       if (bufferId != Allocation::InvalidBufferId) {
-        curBlockInfo.syncWriteIntervals.insert(
-            allocation->getAllocatedInterval(bufferId));
+        if (isa<triton::gpu::InsertSliceAsyncOp,
+                triton::nvidia_gpu::InsertSliceTMAOp, tensor::InsertSliceOp>(
+                op)) {
+          // FIXME(Keren): insert_slice and insert_slice_async are always
+          // alias for now
+          curBlockInfo.syncWriteIntervals.insert(
+              allocation->getAllocatedInterval(bufferId));
+        } else {
+          // ConvertLayoutOp: shared memory -> registers
+          curBlockInfo.syncReadIntervals.insert(
+              allocation->getAllocatedInterval(bufferId));
+        }
       }
     }
-    // Scratch buffer is considered as both shared memory write & read
-    auto bufferId = allocation->getBufferId(op);
+  }
+  for (Value value : op->getResults()) {
+    // ConvertLayoutOp: registers -> shared memory
+    auto bufferId = allocation->getBufferId(value);
     if (bufferId != Allocation::InvalidBufferId) {
       curBlockInfo.syncWriteIntervals.insert(
           allocation->getAllocatedInterval(bufferId));
-      curBlockInfo.syncReadIntervals.insert(
-          allocation->getAllocatedInterval(bufferId));
     }
   }
-
-  if (blockInfo->isIntersected(curBlockInfo)) {
-    builder->setInsertionPoint(op);
-    insertBarrier(op, builder);
-    blockInfo->sync();
+  // Scratch buffer is considered as both shared memory write & read
+  auto bufferId = allocation->getBufferId(op);
+  if (bufferId != Allocation::InvalidBufferId) {
+    curBlockInfo.syncWriteIntervals.insert(
+        allocation->getAllocatedInterval(bufferId));
+    curBlockInfo.syncReadIntervals.insert(
+        allocation->getAllocatedInterval(bufferId));
   }
-  // Update the region info, even if barrier is inserted, we have to maintain
-  // the current op's read/write buffers.
-  blockInfo->join(curBlockInfo);
+  return curBlockInfo;
 }
 } // namespace mlir
@@ -0,0 +1,238 @@
+#include "triton/Analysis/RangeAnalysis.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Interfaces/ControlFlowInterfaces.h"
+#include "mlir/Interfaces/FunctionInterfaces.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonGPU/IR/Dialect.h"
+
+#include <limits>
+
+namespace mlir {
+namespace {
+
+unsigned getBitWidth(Type type) {
+  return ConstantIntRanges::getStorageBitwidth(getElementTypeOrSelf(type));
+}
+
+// Narrows `range` with signed, inclusive bounds given as integer attributes.
+ConstantIntRanges applyHints(const ConstantIntRanges &range, Attribute minAttr,
+                             Attribute maxAttr) {
+  unsigned width = range.smin().getBitWidth();
+  if (width == 0)
+    return range;
+  APInt smin = APInt::getSignedMinValue(width);
+  APInt smax = APInt::getSignedMaxValue(width);
+  if (auto attr = minAttr.dyn_cast_or_null<IntegerAttr>())
+    smin = attr.getValue().sextOrTrunc(width);
+  if (auto attr = maxAttr.dyn_cast_or_null<IntegerAttr>())
+    smax = attr.getValue().sextOrTrunc(width);
+  if (smin.sgt(smax))
+    return range;
+  return range.intersection(ConstantIntRanges::fromSigned(smin, smax));
+}
+
+// CUDA caps the grid at 2^31 - 1 blocks along x and 65535 along y and z.
+int64_t getMaxNumPrograms(unsigned axis) {
+  return axis == 0 ? std::numeric_limits<int32_t>::max() : 65535;
+}
+
+ConstantIntRanges getSignedRange(unsigned width, int64_t min, int64_t max) {
+  return ConstantIntRanges::fromSigned(APInt(width, min, /*isSigned=*/true),
+                                       APInt(width, max, /*isSigned=*/true));
+}
+
+ConstantIntRanges getConstantRange(DenseIntElementsAttr attr) {
+  if (attr.isSplat())
+    return ConstantIntRanges::constant(attr.getSplatValue<APInt>());
+  auto values = attr.getValues<APInt>();
+  APInt umin = *values.begin(), umax = umin, smin = umin, smax = umin;
+  for (const APInt &value : values) {
+    umin = APIntOps::umin(umin, value);
+    umax = APIntOps::umax(umax, value);
+    smin = APIntOps::smin(smin, value);
+    smax = APIntOps::smax(smax, value);
+  }
+  return ConstantIntRanges(umin, umax, smin, smax);
+}
+
+// Ranges of the results of `op`. Results that are not set are unknown.
+void inferResultRanges(Operation *op, ArrayRef<ConstantIntRanges> argRanges,
+                       SetIntRangeFn setResultRange) {
+  if (auto makeRangeOp = dyn_cast<triton::MakeRangeOp>(op)) {
+    setResultRange(makeRangeOp,
+                   getSignedRange(getBitWidth(makeRangeOp.getType()),
+                                  makeRangeOp.getStart(),
+                                  int64_t(makeRangeOp.getEnd()) - 1));
+    return;
+  }
+  if (auto programIdOp = dyn_cast<triton::GetProgramIdOp>(op)) {
+    setResultRange(
+        programIdOp,
+        getSignedRange(getBitWidth(programIdOp.getType()), 0,
+                       getMaxNumPrograms(programIdOp.getAxisAsInt()) - 1));
+    return;
+  }
+  if (auto numProgramsOp = dyn_cast<triton::GetNumProgramsOp>(op)) {
+    setResultRange(numProgramsOp,
+                   getSignedRange(getBitWidth(numProgramsOp.getType()), 1,
+                                  getMaxNumPrograms(numProgramsOp.getAxis())));
+    return;
+  }
+  // Shape manipulations keep the set of element values.
+  if (isa<triton::SplatOp, triton::BroadcastOp, triton::ExpandDimsOp,
+          triton::ReshapeOp, triton::TransOp, triton::gpu::ConvertLayoutOp>(
+          op)) {
+    setResultRange(op->getResult(0), argRanges[0]);
+    return;
+  }
+  if (auto constantOp = dyn_cast<arith::ConstantOp>(op)) {
+    if (auto attr = constantOp.getValue().dyn_cast<DenseIntElementsAttr>()) {
+      setResultRange(constantOp, getConstantRange(attr));
+      return;
+    }
+  }
+  // The upstream cast implementations read the width from the result type,
+  // which is only right for scalars.
+  if (auto extOp = dyn_cast<arith::ExtSIOp>(op)) {
+    unsigned width = getBitWidth(extOp.getType());
+    setResultRange(extOp, ConstantIntRanges::fromSigned(
+                              argRanges[0].smin().sext(width),
+                              argRanges[0].smax().sext(width)));
+    return;
+  }
+  if (auto extOp = dyn_cast<arith::ExtUIOp>(op)) {
+    unsigned width = getBitWidth(extOp.getType());
+    setResultRange(extOp, ConstantIntRanges::fromUnsigned(
+                              argRanges[0].umin().zext(width),
+                              argRanges[0].umax().zext(width)));
+    return;
+  }
+  if (auto truncOp = dyn_cast<arith::TruncIOp>(op)) {
+    unsigned width = getBitWidth(truncOp.getType());
+    const ConstantIntRanges &range = argRanges[0];
+    if (range.smin().isSignedIntN(width) && range.smax().isSignedIntN(width))
+      setResultRange(truncOp, ConstantIntRanges::fromSigned(
+                                  range.smin().trunc(width),
+                                  range.smax().trunc(width)));
+    else if (range.umax().isIntN(width))
+      setResultRange(truncOp, ConstantIntRanges::fromUnsigned(
+                                  range.umin().trunc(width),
+                                  range.umax().trunc(width)));
+    return;
+  }
+  if (isa<arith::IndexCastOp, arith::IndexCastUIOp>(op) &&
+      op->getResult(0).getType().isa<TensorType>())
+    return;
+  if (auto inferrable = dyn_cast<InferIntRangeInterface>(op))
+    inferrable.inferResultRanges(argRanges, setResultRange);
+}
+
+// Whether `value` is passed to a region successor, e.g. yielded to the next
+// iteration of a loop.
+bool isYielded(Value value) {
+  return llvm::any_of(value.getUsers(), [](Operation *user) {
+    return isa<RegionBranchTerminatorOpInterface>(user);
+  });
+}
+
+} // namespace
+
+IntegerRange IntegerRange::getPessimisticValueState(Value value) {
+  auto range = ConstantIntRanges::maxRange(getBitWidth(value.getType()));
+  BlockArgument blockArg = value.dyn_cast<BlockArgument>();
+  if (blockArg && blockArg.getOwner()->isEntryBlock()) {
+    Operation *op = blockArg.getOwner()->getParentOp();
+    if (auto fun = dyn_cast<FunctionOpInterface>(op)) {
+      int argNumber = blockArg.getArgNumber();
+      range = applyHints(range, fun.getArgAttr(argNumber, "tt.min_value"),
+                         fun.getArgAttr(argNumber, "tt.max_value"));
+    }
+  }
+  return IntegerRange(range);
+}
+
+IntegerRange IntegerRange::join(const IntegerRange &lhs,
+                                const IntegerRange &rhs) {
+  if (lhs.isUninitialized())
+    return rhs;
+  if (rhs.isUninitialized())
+    return lhs;
+  return IntegerRange(lhs.getValue().rangeUnion(rhs.getValue()));
+}
+
+void TritonIntegerRangeAnalysis::visitOperation(
+    Operation *op, ArrayRef<const dataflow::Lattice<IntegerRange> *> operands,
+    ArrayRef<dataflow::Lattice<IntegerRange> *> results) {
+  // Wait until every operand has been reached.
+  SmallVector<ConstantIntRanges> argRanges;
+  for (auto *operand : operands) {
+    if (operand->getValue().isUninitialized())
+      return;
+    argRanges.push_back(operand->getValue().getValue());
+  }
+
+  SmallVector<std::optional<ConstantIntRanges>> resultRanges(results.size());
+  inferResultRanges(op, argRanges,
+                    [&](Value value, const ConstantIntRanges &range) {
+                      auto result = value.dyn_cast<OpResult>();
+                      if (result && result.getOwner() == op)
+                        resultRanges[result.getResultNumber()] = range;
+                    });
+
+  for (auto [result, lattice, range] :
+       llvm::zip(op->getResults(), results, resultRanges)) {
+    ConstantIntRanges curr =
+        range ? *range
+              : ConstantIntRanges::maxRange(getBitWidth(result.getType()));
+    // A loop-carried value may grow by one step per iteration of the solver,
+    // so it is widened to the full range once its range changes again.
+    const IntegerRange &old = lattice->getValue();
+    if (isYielded(result) && !old.isUninitialized() &&
+        !(IntegerRange::join(old, IntegerRange(curr)) == old))
+      curr = ConstantIntRanges::maxRange(getBitWidth(result.getType()));
+    // override with hint
+    curr = applyHints(curr, op->getDiscardableAttr("tt.min_value"),
+                      op->getDiscardableAttr("tt.max_value"));
+    propagateIfChanged(lattice, lattice->join(IntegerRange(curr)));
+  }
+}
+
+void TritonIntegerRangeAnalysis::visitNonControlFlowArguments(
+    Operation *op, const RegionSuccessor &successor,
+    ArrayRef<dataflow::Lattice<IntegerRange> *> argLattices,
+    unsigned firstIndex) {
+  auto forOp = dyn_cast<scf::ForOp>(op);
+  if (!forOp) {
+    setAllToEntryStates(argLattices.take_front(firstIndex));
+    setAllToEntryStates(argLattices.drop_front(
+        firstIndex + successor.getSuccessorInputs().size()));
+    return;
+  }
+
+  auto lb = getLatticeElementFor(op, forOp.getLowerBound())->getValue();
+  auto ub = getLatticeElementFor(op, forOp.getUpperBound())->getValue();
+  auto step = getLatticeElementFor(op, forOp.getStep())->getValue();
+  if (lb.isUninitialized() || ub.isUninitialized() || step.isUninitialized())
+    return;
+  // With a positive step the induction variable stays in [lb, ub).
+  if (!step.getValue().smin().isStrictlyPositive())
+    return setAllToEntryStates(argLattices.take_front(1));
+  APInt min = lb.getValue().smin();
+  APInt max = ub.getValue().smax();
+  max = max.sgt(min) ? max - 1 : min;
+  auto *iv = argLattices[0];
+  propagateIfChanged(
+      iv, iv->join(IntegerRange(ConstantIntRanges::fromSigned(min, max))));
+}
+
+std::optional<ConstantIntRanges> getIntegerRange(DataFlowSolver &solver,
+                                                 Value value) {
+  auto *lattice = solver.lookupState<dataflow::Lattice<IntegerRange>>(value);
+  if (!lattice || lattice->getValue().isUninitialized())
+    return std::nullopt;
+  return lattice->getValue().getValue();
+}
+
+} // namespace mlir
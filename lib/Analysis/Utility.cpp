@@ -11,6 +11,7 @@
 #include "triton/Dialect/TritonNvidiaGPU/IR/Dialect.h"
 #include "triton/Tools/Sys/GetEnv.hpp"
 #include <deque>
+#include <limits>
 
 namespace mlir {
 
@@ -290,38 +291,124 @@ unsigned ScanLoweringHelper::getNonAxisNumBlocks() {
   return numBlocks;
 }
 
-bool ScanLoweringHelper::isSupported() {
-  // TODO: Support the following cases:
-  // 1. Scan on non-blocking encodings
-  // 2. Scan with multiple operands
-  if (!isa<triton::gpu::BlockedEncodingAttr>(getEncoding()))
-    return false;
-  if (scanOp.getNumOperands() != 1)
-    return false;
-  return true;
+bool ScanLoweringHelper::isSupported() { return view.has_value(); }
+
+SmallVector<unsigned> ScanLoweringHelper::getScratchOperandOffsets() {
+  unsigned numElements = getScratchNumElementsPerOperand();
+  SmallVector<unsigned> offsets;
+  unsigned offset = 0;
+  for (Type elemTy : getElementTypes()) {
+    unsigned elemBytes = ceil<unsigned>(elemTy.getIntOrFloatBitWidth(), 8);
+    offset = ceil<unsigned>(offset, elemBytes) * elemBytes;
+    offsets.push_back(offset);
+    offset += numElements * elemBytes;
+  }
+  offsets.push_back(offset);
+  return offsets;
 }
 
-unsigned ScanLoweringHelper::getScratchSizeInBytes() {
-  unsigned axisNumWarps = getAxisNumWarpsWithUniqueData();
-  if (axisNumWarps == 1)
-    return 0;
-  auto type = scanOp.getOperand(0).getType().cast<RankedTensorType>();
-  unsigned elementSizeInBytes = type.getElementTypeBitWidth() / 8;
+unsigned ScanLoweringHelper::getScratchNumElementsPerOperand() {
   auto mod = scanOp->getParentOfType<ModuleOp>();
   unsigned numWarps = triton::gpu::TritonGPUDialect::getNumWarps(mod);
   unsigned numNonAxisElementsPerWapr =
       getNonAxisNumThreadsPerWarp() * getNonAxisNumElementsPerThread();
-  unsigned numElements = numWarps * numNonAxisElementsPerWapr *
-                         getAxisNumBlocks() * getNonAxisNumBlocks();
-  return elementSizeInBytes * numElements;
+  return numWarps * numNonAxisElementsPerWapr * getAxisNumBlocks() *
+         getNonAxisNumBlocks();
+}
+
+unsigned ScanLoweringHelper::getScratchSizeInBytes() {
+  if (!isSupported())
+    return 0;
+  unsigned axisNumWarps = getAxisNumWarpsWithUniqueData();
+  if (axisNumWarps == 1)
+    return 0;
+  return getScratchOperandOffsets().back();
 }
 
 triton::gpu::BlockedEncodingAttr ScanLoweringHelper::getEncoding() {
-  return srcEncoding.cast<triton::gpu::BlockedEncodingAttr>();
+  return view->encoding;
 }
 
-llvm::ArrayRef<int64_t> ScanLoweringHelper::getShape() {
-  return scanOp.getOperand(0).getType().cast<RankedTensorType>().getShape();
+llvm::ArrayRef<int64_t> ScanLoweringHelper::getShape() { return view->shape; }
+
+SmallVector<Type> ScanLoweringHelper::getElementTypes() {
+  SmallVector<Type> elemTys;
+  for (Value operand : scanOp.getOperands())
+    elemTys.push_back(
+        operand.getType().cast<RankedTensorType>().getElementType());
+  return elemTys;
+}
+
+std::optional<ScanBlockedView> getScanBlockedView(RankedTensorType type,
+                                                  unsigned axis) {
+  MLIRContext *ctx = type.getContext();
+  Attribute encoding = type.getEncoding();
+  SmallVector<int64_t> shape(type.getShape().begin(), type.getShape().end());
+  if (auto blocked = encoding.dyn_cast<triton::gpu::BlockedEncodingAttr>())
+    return ScanBlockedView{blocked, shape, axis, {}};
+
+  // A slice of a blocked layout holds the elements of its parent with size 1
+  // along the sliced dimensions, each once.
+  if (encoding.isa<triton::gpu::SliceEncodingAttr>()) {
+    SmallVector<bool> isSliced(shape.size(), false);
+    Attribute parent = encoding;
+    while (auto slice = parent.dyn_cast<triton::gpu::SliceEncodingAttr>()) {
+      unsigned dim = slice.getDim();
+      shape.insert(shape.begin() + dim, 1);
+      isSliced.insert(isSliced.begin() + dim, true);
+      if (axis >= dim)
+        ++axis;
+      parent = slice.getParent();
+    }
+    auto blocked = parent.dyn_cast<triton::gpu::BlockedEncodingAttr>();
+    if (!blocked)
+      return std::nullopt;
+    SmallVector<unsigned> sizePerThread = blocked.getSizePerThread();
+    for (unsigned d = 0; d < shape.size(); ++d)
+      if (isSliced[d])
+        sizePerThread[d] = 1;
+    auto view = triton::gpu::BlockedEncodingAttr::get(
+        ctx, sizePerThread, blocked.getThreadsPerWarp(),
+        blocked.getWarpsPerCTA(), blocked.getOrder(), blocked.getCTALayout());
+    return ScanBlockedView{view, shape, axis, {}};
+  }
+
+  // Each thread of an Ampere MMA layout holds 2 consecutive columns of rows
+  // `r` and `r + 8` of every 16x8 tile of its warp. The rows of a thread are
+  // split by the rows of the other lanes.
+  auto mma = encoding.dyn_cast<triton::gpu::NvidiaMmaEncodingAttr>();
+  if (!mma || !mma.isAmpere() || shape.size() != 2 ||
+      triton::gpu::getNumCTAs(mma) != 1 || shape[0] % 16 != 0 ||
+      shape[1] % 8 != 0)
+    return std::nullopt;
+  auto warpsPerCTA = mma.getWarpsPerCTA();
+  if (axis == 1) {
+    // Split the rows in blocks of 8 rows, one per lane: the columns are then
+    // in the same registers as in a 3D blocked layout.
+    auto CTALayout =
+        triton::gpu::CTALayoutAttr::get(ctx, {1, 1, 1}, {1, 1, 1}, {2, 1, 0});
+    auto view = triton::gpu::BlockedEncodingAttr::get(
+        ctx, {2, 1, 2}, {1, 8, 4}, {warpsPerCTA[0], 1, warpsPerCTA[1]},
+        {2, 1, 0}, CTALayout);
+    return ScanBlockedView{view, {shape[0] / 8, 8, shape[1]}, 2, {}};
+  }
+  // With a single warp along the rows, rows `r + 8` of a thread are the next
+  // block of rows of a blocked layout, held in different registers.
+  if (warpsPerCTA[0] != 1)
+    return std::nullopt;
+  auto view = triton::gpu::BlockedEncodingAttr::get(
+      ctx, {1, 2}, {8, 4}, {1, warpsPerCTA[1]}, {1, 0}, mma.getCTALayout());
+  unsigned numRowBlocks = shape[0] / 8;
+  unsigned numColBlocks = ceil<unsigned>(shape[1], 8 * warpsPerCTA[1]);
+  SmallVector<unsigned> srcRegs;
+  for (unsigned rowBlock = 0; rowBlock < numRowBlocks; ++rowBlock)
+    for (unsigned colBlock = 0; colBlock < numColBlocks; ++colBlock)
+      for (unsigned col = 0; col < 2; ++col)
+        srcRegs.push_back(
+            (((rowBlock / 2) * numColBlocks + colBlock) * 2 + rowBlock % 2) *
+                2 +
+            col);
+  return ScanBlockedView{view, shape, 0, srcRegs};
 }
 
 unsigned ScanLoweringHelper::getAxisElementStride() {
@@ -449,6 +536,158 @@ bool isMmaToMmaShortcut(RankedTensorType srcTy, RankedTensorType dstTy) {
   return isMmaToMmaShortcut(srcTy.getEncoding(), dstTy.getEncoding());
 }
 
+namespace {
+
+SmallVector<unsigned> delinearize(unsigned linear, ArrayRef<unsigned> shape,
+                                  ArrayRef<unsigned> order) {
+  SmallVector<unsigned> multiDim(shape.size());
+  for (unsigned d : order) {
+    multiDim[d] = linear % shape[d];
+    linear /= shape[d];
+  }
+  return multiDim;
+}
+
+unsigned linearize(ArrayRef<unsigned> multiDim, ArrayRef<unsigned> shape,
+                   ArrayRef<unsigned> order) {
+  unsigned linear = 0;
+  for (unsigned d : llvm::reverse(order))
+    linear = linear * shape[d] + multiDim[d];
+  return linear;
+}
+
+} // namespace
+
+SmallVector<SmallVector<unsigned>>
+getBlockedRegisterOffsets(triton::gpu::BlockedEncodingAttr layout,
+                          ArrayRef<int64_t> shape) {
+  auto sizePerThread = layout.getSizePerThread();
+  auto order = layout.getOrder();
+  auto shapePerCTATile = triton::gpu::getShapePerCTATile(layout);
+  unsigned rank = shape.size();
+  SmallVector<unsigned> tilesPerDim(rank);
+  for (unsigned d = 0; d < rank; ++d)
+    tilesPerDim[d] = ceil<unsigned>(shape[d], shapePerCTATile[d]);
+  unsigned sizePerTile = product<unsigned>(sizePerThread);
+  unsigned numRegs = product<unsigned>(tilesPerDim) * sizePerTile;
+  SmallVector<SmallVector<unsigned>> offsets(numRegs);
+  for (unsigned reg = 0; reg < numRegs; ++reg) {
+    auto tileId = delinearize(reg / sizePerTile, tilesPerDim, order);
+    auto elemId = delinearize(reg % sizePerTile, sizePerThread, order);
+    for (unsigned d = 0; d < rank; ++d)
+      offsets[reg].push_back(tileId[d] * shapePerCTATile[d] + elemId[d]);
+  }
+  return offsets;
+}
+
+SmallVector<unsigned>
+getBlockedThreadBase(triton::gpu::BlockedEncodingAttr layout,
+                     ArrayRef<int64_t> shape, unsigned warp, unsigned lane) {
+  auto sizePerThread = layout.getSizePerThread();
+  auto threadsPerWarp = layout.getThreadsPerWarp();
+  auto warpsPerCTA = layout.getWarpsPerCTA();
+  auto order = layout.getOrder();
+  auto warpId = delinearize(warp, warpsPerCTA, order);
+  auto laneId = delinearize(lane, threadsPerWarp, order);
+  SmallVector<unsigned> base(shape.size());
+  for (unsigned d = 0; d < shape.size(); ++d) {
+    unsigned maxWarps =
+        ceil<unsigned>(shape[d], sizePerThread[d] * threadsPerWarp[d]);
+    unsigned maxThreads = ceil<unsigned>(shape[d], sizePerThread[d]);
+    base[d] = sizePerThread[d] * (laneId[d] % maxThreads +
+                                  warpId[d] % maxWarps * threadsPerWarp[d]);
+  }
+  return base;
+}
+
+std::optional<CvtLayoutWithinWarp>
+getCvtLayoutWithinWarp(RankedTensorType srcTy, RankedTensorType dstTy) {
+  auto srcLayout =
+      srcTy.getEncoding().dyn_cast<triton::gpu::BlockedEncodingAttr>();
+  auto dstLayout =
+      dstTy.getEncoding().dyn_cast<triton::gpu::BlockedEncodingAttr>();
+  // Trivial conversions are folded away before lowering.
+  if (!srcLayout || !dstLayout || srcLayout == dstLayout)
+    return std::nullopt;
+  if (triton::gpu::getNumCTAs(srcLayout) != 1 ||
+      triton::gpu::getNumCTAs(dstLayout) != 1)
+    return std::nullopt;
+  const unsigned warpSize = 32;
+  auto srcThreadsPerWarp = srcLayout.getThreadsPerWarp();
+  if (product<unsigned>(srcThreadsPerWarp) != warpSize ||
+      product<unsigned>(dstLayout.getThreadsPerWarp()) != warpSize)
+    return std::nullopt;
+  // Registers that repeat elements beyond the end of the tensor would need
+  // the same wrapping as the shared memory path.
+  auto shape = srcTy.getShape();
+  unsigned rank = shape.size();
+  auto srcSizePerThread = srcLayout.getSizePerThread();
+  for (unsigned d = 0; d < rank; ++d)
+    if (srcSizePerThread[d] > shape[d] ||
+        dstLayout.getSizePerThread()[d] > shape[d])
+      return std::nullopt;
+
+  unsigned numWarps = product<unsigned>(srcLayout.getWarpsPerCTA());
+  SmallVector<unsigned> tensorShape(shape.begin(), shape.end());
+  auto tensorOrder = srcLayout.getOrder();
+  auto srcOffsets = getBlockedRegisterOffsets(srcLayout, shape);
+  auto dstOffsets = getBlockedRegisterOffsets(dstLayout, shape);
+
+  // Source register holding each element, for every thread.
+  SmallVector<DenseMap<unsigned, unsigned>> srcRegOf(numWarps * warpSize);
+  for (unsigned thread = 0; thread < numWarps * warpSize; ++thread) {
+    auto base = getBlockedThreadBase(srcLayout, shape, thread / warpSize,
+                                     thread % warpSize);
+    for (auto [reg, offset] : llvm::enumerate(srcOffsets)) {
+      SmallVector<unsigned> coord(rank);
+      for (unsigned d = 0; d < rank; ++d)
+        coord[d] = base[d] + offset[d];
+      srcRegOf[thread].try_emplace(linearize(coord, tensorShape, tensorOrder),
+                                   reg);
+    }
+  }
+
+  // A destination register can only be filled by one shuffle (or move) if
+  // it reads the same source register in every thread.
+  const unsigned unset = std::numeric_limits<unsigned>::max();
+  SmallVector<unsigned> threadRegs(dstOffsets.size(), unset);
+  SmallVector<unsigned> warpRegs(dstOffsets.size(), unset);
+  bool intraThread = true;
+  bool intraWarp = true;
+  auto update = [&](unsigned &srcReg, unsigned thread, unsigned elem) {
+    auto it = srcRegOf[thread].find(elem);
+    if (it == srcRegOf[thread].end())
+      return false;
+    if (srcReg == unset)
+      srcReg = it->second;
+    return srcReg == it->second;
+  };
+  for (unsigned thread = 0; thread < numWarps * warpSize; ++thread) {
+    unsigned warp = thread / warpSize;
+    auto base = getBlockedThreadBase(dstLayout, shape, warp, thread % warpSize);
+    for (auto [reg, offset] : llvm::enumerate(dstOffsets)) {
+      SmallVector<unsigned> coord(rank);
+      SmallVector<unsigned> srcLaneId(rank);
+      for (unsigned d = 0; d < rank; ++d) {
+        coord[d] = base[d] + offset[d];
+        srcLaneId[d] =
+            coord[d] / srcSizePerThread[d] % srcThreadsPerWarp[d];
+      }
+      unsigned elem = linearize(coord, tensorShape, tensorOrder);
+      unsigned srcLane =
+          linearize(srcLaneId, srcThreadsPerWarp, srcLayout.getOrder());
+      intraThread = intraThread && update(threadRegs[reg], thread, elem);
+      intraWarp = intraWarp &&
+                  update(warpRegs[reg], warp * warpSize + srcLane, elem);
+      if (!intraThread && !intraWarp)
+        return std::nullopt;
+    }
+  }
+  if (intraThread)
+    return CvtLayoutWithinWarp{true, threadRegs};
+  return CvtLayoutWithinWarp{false, warpRegs};
+}
+
 // For MMAV3 dotOperand layout matches mma operand for f16 and bf16 cases.
 bool matchMmaV3AndDotOperandLayout(RankedTensorType srcTy,
                                    RankedTensorType dstTy) {
@@ -528,6 +528,59 @@ private:
     return success();
   }
 
+  // blocked -> blocked, when every thread reads its elements from its own
+  // registers or from other lanes of its warp.
+  LogicalResult
+  lowerDistributedWithinWarp(triton::gpu::ConvertLayoutOp op,
+                             OpAdaptor adaptor,
+                             ConversionPatternRewriter &rewriter,
+                             const CvtLayoutWithinWarp &plan) const {
+    auto loc = op.getLoc();
+    auto srcTy = op.getSrc().getType().cast<RankedTensorType>();
+    auto dstTy = op.getResult().getType().cast<RankedTensorType>();
+    auto vals =
+        getTypeConverter()->unpackLLElements(loc, adaptor.getSrc(), rewriter);
+    unsigned outElems = plan.srcRegs.size();
+    SmallVector<Value> outVals(outElems);
+    if (plan.intraThread) {
+      for (unsigned i = 0; i < outElems; ++i)
+        outVals[i] = vals[plan.srcRegs[i]];
+    } else {
+      auto srcLayout = srcTy.getEncoding().cast<BlockedEncodingAttr>();
+      auto srcSizePerThread = srcLayout.getSizePerThread();
+      auto srcThreadsPerWarp = srcLayout.getThreadsPerWarp();
+      auto dstIndices = emitIndices(loc, rewriter, dstTy.getEncoding(), dstTy,
+                                    /*withCTAOffset*/ false);
+      unsigned rank = dstTy.getRank();
+      for (unsigned i = 0; i < outElems; ++i) {
+        // Lane of the source layout that holds this element.
+        SmallVector<Value> srcLaneId(rank);
+        for (unsigned d = 0; d < rank; ++d)
+          srcLaneId[d] =
+              urem(udiv(dstIndices[i][d], i32_val(srcSizePerThread[d])),
+                   i32_val(srcThreadsPerWarp[d]));
+        Value srcLane = linearize(rewriter, loc, srcLaneId, srcThreadsPerWarp,
+                                  srcLayout.getOrder());
+        Value val = vals[plan.srcRegs[i]];
+        Type valTy = val.getType();
+        if (valTy.isa<LLVM::LLVMPointerType>())
+          val = ptrtoint(i64_ty, val);
+        else if (valTy.isInteger(1))
+          val = zext(i32_ty, val);
+        val = shflIdxSync(loc, rewriter, val, srcLane);
+        if (valTy.isa<LLVM::LLVMPointerType>())
+          val = inttoptr(valTy, val);
+        else if (valTy.isInteger(1))
+          val = trunc(i1_ty, val);
+        outVals[i] = val;
+      }
+    }
+    Value result =
+        getTypeConverter()->packLLElements(loc, outVals, rewriter, dstTy);
+    rewriter.replaceOp(op, result);
+    return success();
+  }
+
   // blocked/mma -> blocked/mma.
   // Data padding in shared memory to avoid bank conflict.
   LogicalResult
@@ -544,6 +597,8 @@ private:
 
     if (shouldUseDistSmem(srcLayout, dstLayout))
       return lowerDistToDistWithDistSmem(op, adaptor, rewriter);
+    if (auto withinWarp = getCvtLayoutWithinWarp(srcTy, dstTy))
+      return lowerDistributedWithinWarp(op, adaptor, rewriter, *withinWarp);
     Value smemBase = getSharedMemoryBase(loc, rewriter, op.getOperation());
     auto elemPtrTy = ptr_ty(rewriter.getContext(), 3);
     smemBase = bitcast(smemBase, elemPtrTy);
@@ -11,15 +11,16 @@ using ::mlir::LLVM::shflIdxSync;
 using ::mlir::LLVM::shflUpSync;
 using ::mlir::LLVM::storeShared;
 
-// apply combine region to a and b and return the result. If a or b is null,
+// apply combine region to a and b and return the result. If a or b is empty,
 // return the other operand.
-static Value accumulate(ConversionPatternRewriter &rewriter, Region &combineOp,
-                        Value a, Value b) {
-  if (!a) {
-    return b;
+static SmallVector<Value> accumulate(ConversionPatternRewriter &rewriter,
+                                     Region &combineOp, ValueRange a,
+                                     ValueRange b) {
+  if (a.empty()) {
+    return SmallVector<Value>(b.begin(), b.end());
   }
-  if (!b) {
-    return a;
+  if (b.empty()) {
+    return SmallVector<Value>(a.begin(), a.end());
   }
   // Create a new copy of the reduce block, and inline it
   Block *currentBlock = rewriter.getBlock();
@@ -27,27 +28,56 @@ static Value accumulate(ConversionPatternRewriter &rewriter, Region &combineOp,
   rewriter.cloneRegionBefore(combineOp, &parent.front());
   auto &newScan = parent.front();
   auto returnOp = dyn_cast<triton::ScanReturnOp>(newScan.getTerminator());
-  llvm::SmallVector<Value> combineArgs = {a, b};
+  llvm::SmallVector<Value> combineArgs(a.begin(), a.end());
+  combineArgs.append(b.begin(), b.end());
   rewriter.inlineBlockBefore(&newScan, &*rewriter.getInsertionPoint(),
                              combineArgs);
   auto results = returnOp.getResult();
-  Value acc = results[0];
+  SmallVector<Value> acc(results.begin(), results.end());
   // Delete the terminator, which is no longer used
   rewriter.eraseOp(returnOp);
   return acc;
 }
 
+static SmallVector<Value> selectOperands(ConversionPatternRewriter &rewriter,
+                                         Location loc, Value mask,
+                                         ValueRange a, ValueRange b) {
+  SmallVector<Value> values;
+  for (unsigned i = 0; i < a.size(); ++i)
+    values.push_back(select(mask, a[i], b[i]));
+  return values;
+}
+
+static SmallVector<Value> shuffleUp(ConversionPatternRewriter &rewriter,
+                                    Location loc, ValueRange values,
+                                    unsigned delta) {
+  SmallVector<Value> shuffled;
+  for (Value value : values)
+    shuffled.push_back(shflUpSync(loc, rewriter, value, delta));
+  return shuffled;
+}
+
+static SmallVector<Value> shuffleIdx(ConversionPatternRewriter &rewriter,
+                                     Location loc, ValueRange values,
+                                     Value lane) {
+  SmallVector<Value> shuffled;
+  for (Value value : values)
+    shuffled.push_back(shflIdxSync(loc, rewriter, value, lane));
+  return shuffled;
+}
+
 // Scan a contiguous elements within a thread and update `srcValues` in place.
-static void scanThreadContiguousElements(SmallVector<Value> &srcValues,
-                                         ConversionPatternRewriter &rewriter,
-                                         ScanLoweringHelper &helper) {
+static void
+scanThreadContiguousElements(SmallVector<SmallVector<Value>> &srcValues,
+                             ConversionPatternRewriter &rewriter,
+                             ScanLoweringHelper &helper) {
   // Depending on layout contiguous elements along axis dim may not be
   // contiguous in srcValues. Keep track of what elements belong to the same
   // chunk of contiguous elements.
   unsigned scanElementsPerThreads = helper.getAxisNumElementsPerThread();
   unsigned numChunks = srcValues.size() / scanElementsPerThreads;
   unsigned stride = helper.getAxisElementStride();
-  SmallVector<Value> accs(numChunks);
+  SmallVector<SmallVector<Value>> accs(numChunks);
   for (unsigned srcIndex = 0; srcIndex < srcValues.size(); srcIndex++) {
     unsigned accIndex = (srcIndex % stride) +
                         ((srcIndex / stride) / scanElementsPerThreads) * stride;
@@ -60,7 +90,7 @@ static void scanThreadContiguousElements(SmallVector<Value> &srcValues,
 
 // Apply a scan across threads of the warp for the last element of each
 // contiguous group of elements.
-static void warpScan(SmallVector<Value> &srcValues,
+static void warpScan(SmallVector<SmallVector<Value>> &srcValues,
                      ConversionPatternRewriter &rewriter,
                      ScanLoweringHelper &helper, Value laneIdAxis) {
   Location loc = helper.getLoc();
@@ -74,12 +104,13 @@ static void warpScan(SmallVector<Value> &srcValues,
     if (elementIdx != scanElementsPerThreads - 1)
       continue;
     // Reduce within warps.
-    Value acc = srcValues[srcIndex];
+    SmallVector<Value> acc = srcValues[srcIndex];
     for (unsigned i = 1; i <= (scanDim) / 2; i = i << 1) {
-      Value shfl = shflUpSync(loc, rewriter, acc, i * threadStride);
-      Value tempAcc = accumulate(rewriter, helper.getCombineOp(), shfl, acc);
+      SmallVector<Value> shfl = shuffleUp(rewriter, loc, acc, i * threadStride);
+      SmallVector<Value> tempAcc =
+          accumulate(rewriter, helper.getCombineOp(), shfl, acc);
       Value mask = icmp_slt(laneIdAxis, i32_val(i));
-      acc = select(mask, acc, tempAcc);
+      acc = selectOperands(rewriter, loc, mask, acc, tempAcc);
     }
     srcValues[srcIndex] = acc;
   }
@@ -91,10 +122,11 @@ static void warpScan(SmallVector<Value> &srcValues,
 //          -----------------------------------------------------------------
 // chunk 0: | acc[0] warp 0 | acc[1] warp 0 | acc[0] warp 1 | acc[1] warp 1 |
 // chunk 1: | acc[0] warp 0 | acc[1] warp 0 | acc[0] warp 1 | acc[1] warp 1 |
-static void storeWarpAccumulator(SmallVector<Value> &srcValues,
+// Each operand has its own such buffer, starting at `smemBases[i]`.
+static void storeWarpAccumulator(SmallVector<SmallVector<Value>> &srcValues,
                                  ConversionPatternRewriter &rewriter,
                                  ScanLoweringHelper &helper, Value laneId,
-                                 Value warpId, Value baseSharedMemPtr,
+                                 Value warpId, ArrayRef<Value> smemBases,
                                  Value parallelLaneId) {
   Location loc = helper.getLoc();
   unsigned scanElementsPerThreads = helper.getAxisNumElementsPerThread();
@@ -108,13 +140,15 @@ static void storeWarpAccumulator(SmallVector<Value> &srcValues,
     // Only consider the last element of each contiguous chunk of elements.
     if (elementIdx != scanElementsPerThreads - 1)
       continue;
-    Value lastElement = srcValues[srcIndex];
     Value mask = icmp_eq(laneId, i32_val(scanDim - 1));
     Value index = add(parallelLaneId, mul(warpId, i32_val(numParallelLane)));
     index = add(index, i32_val(chunkId * numParallelLane * axisNumWarps));
-    Value writePtr = gep(baseSharedMemPtr.getType(), lastElement.getType(),
-                         baseSharedMemPtr, index);
-    storeShared(rewriter, loc, writePtr, lastElement, mask);
+    for (unsigned i = 0; i < smemBases.size(); ++i) {
+      Value lastElement = srcValues[srcIndex][i];
+      Value writePtr = gep(smemBases[i].getType(), lastElement.getType(),
+                           smemBases[i], index);
+      storeShared(rewriter, loc, writePtr, lastElement, mask);
+    }
     chunkId++;
   }
 }
@@ -124,11 +158,11 @@ static void storeWarpAccumulator(SmallVector<Value> &srcValues,
 // with the right elements. Within a given contiguous element chunk we update
 // all the elements by accumulating the value from the last element of the
 // reduced value from the previous lane.
-static void AddPartialReduce(SmallVector<Value> &srcValues,
+static void AddPartialReduce(SmallVector<SmallVector<Value>> &srcValues,
                              ConversionPatternRewriter &rewriter,
-                             ScanLoweringHelper &helper, Value sharedMemoryPtr,
-                             Value warpId, Value laneIdAxis,
-                             Value parallelLaneId) {
+                             ScanLoweringHelper &helper,
+                             ArrayRef<Value> smemBases, Value warpId,
+                             Value laneIdAxis, Value parallelLaneId) {
   Location loc = helper.getLoc();
   unsigned numParallelLane = helper.getNonAxisNumThreadsPerCTA();
   unsigned scanElementsPerThreads = helper.getAxisNumElementsPerThread();
@@ -140,8 +174,8 @@ static void AddPartialReduce(SmallVector<Value> &srcValues,
   Value maskFirstLane = icmp_eq(laneIdAxis, i32_val(0));
   Value maskFirstThread = and_(maskFirstWarp, maskFirstLane);
   struct Accumulator {
-    Value acc;
-    Value maskedAcc;
+    SmallVector<Value> acc;
+    SmallVector<Value> maskedAcc;
   };
   unsigned numScanBlocks = helper.getAxisNumBlocks();
   unsigned numParallelBlocks = helper.getNonAxisNumBlocks();
@@ -171,10 +205,13 @@ static void AddPartialReduce(SmallVector<Value> &srcValues,
     for (unsigned i = 0; i < axisNumWarps; ++i) {
       Value index = add(parallelLaneId, i32_val(numParallelLane *
                                                 (i + chunkId * axisNumWarps)));
-      Value ptr = gep(sharedMemoryPtr.getType(), srcValues[srcIndex].getType(),
-                      sharedMemoryPtr, index);
-      Value partialReduce = load(srcValues[srcIndex].getType(), ptr);
-      if (!accumulator.acc) {
+      SmallVector<Value> partialReduce;
+      for (unsigned j = 0; j < smemBases.size(); ++j) {
+        Type elemTy = srcValues[srcIndex][j].getType();
+        Value ptr = gep(smemBases[j].getType(), elemTy, smemBases[j], index);
+        partialReduce.push_back(load(elemTy, ptr));
+      }
+      if (accumulator.acc.empty()) {
         accumulator.acc = partialReduce;
         accumulator.maskedAcc = partialReduce;
         continue;
@@ -182,29 +219,33 @@ static void AddPartialReduce(SmallVector<Value> &srcValues,
       accumulator.acc = accumulate(rewriter, helper.getCombineOp(),
                                    accumulator.acc, partialReduce);
       Value mask = icmp_slt(warpId, i32_val(i + 1));
-      accumulator.maskedAcc =
-          select(mask, accumulator.maskedAcc, accumulator.acc);
+      accumulator.maskedAcc = selectOperands(
+          rewriter, loc, mask, accumulator.maskedAcc, accumulator.acc);
     }
-    Value temp = accumulate(rewriter, helper.getCombineOp(),
-                            accumulator.maskedAcc, srcValues[srcIndex]);
+    SmallVector<Value> temp = accumulate(rewriter, helper.getCombineOp(),
+                                         accumulator.maskedAcc,
+                                         srcValues[srcIndex]);
     if (axisBlockId == 0) {
       // For the first warp and first chunk we don't have anything to
       // accumulate.
-      temp = select(maskFirstWarp, srcValues[srcIndex], temp);
+      temp = selectOperands(rewriter, loc, maskFirstWarp, srcValues[srcIndex],
+                            temp);
     }
     srcValues[srcIndex] = temp;
     // Update the rest of the contiguous elements.
-    Value lastElement =
-        shflUpSync(loc, rewriter, srcValues[srcIndex], threadStride);
-    lastElement = select(maskFirstLane, accumulator.maskedAcc, lastElement);
+    SmallVector<Value> lastElement =
+        shuffleUp(rewriter, loc, srcValues[srcIndex], threadStride);
+    lastElement = selectOperands(rewriter, loc, maskFirstLane,
+                                 accumulator.maskedAcc, lastElement);
     for (unsigned i = 1; i < scanElementsPerThreads; ++i) {
-      Value laneValue = srcValues[srcIndex - i * elementStride];
+      SmallVector<Value> laneValue = srcValues[srcIndex - i * elementStride];
       laneValue =
           accumulate(rewriter, helper.getCombineOp(), lastElement, laneValue);
       if (axisBlockId == 0) {
         // For the first warp and first chunk we don't have anything to
         // accumulate.
-        laneValue = select(maskFirstThread,
+        laneValue =
+            selectOperands(rewriter, loc, maskFirstThread,
                            srcValues[srcIndex - i * elementStride], laneValue);
       }
       srcValues[srcIndex - i * elementStride] = laneValue;
@@ -216,7 +257,7 @@ static void AddPartialReduce(SmallVector<Value> &srcValues,
   }
 }
 
-static void AddPartialReduceOneWarp(SmallVector<Value> &srcValues,
+static void AddPartialReduceOneWarp(SmallVector<SmallVector<Value>> &srcValues,
                                     ConversionPatternRewriter &rewriter,
                                     ScanLoweringHelper &helper, Value warpId,
                                     Value laneIdAxis, Value laneIdLast) {
@@ -236,8 +277,8 @@ static void AddPartialReduceOneWarp(SmallVector<Value> &srcValues,
   assert(numScanBlocks * numParallelBlocks * parallelElementsPerThread *
              scanElementsPerThreads ==
          srcValues.size());
-  SmallVector<Value> accumulators(numParallelBlocks *
-                                  parallelElementsPerThread);
+  SmallVector<SmallVector<Value>> accumulators(numParallelBlocks *
+                                               parallelElementsPerThread);
   unsigned chunkId = 0;
   unsigned blockStride = helper.getAxisBlockStride();
   for (unsigned srcIndex = 0; srcIndex < srcValues.size(); srcIndex++) {
@@ -251,7 +292,7 @@ static void AddPartialReduceOneWarp(SmallVector<Value> &srcValues,
         ((blockId / blockStride) / numScanBlocks) * blockStride;
     unsigned accumulatorIndex = chunkId % parallelElementsPerThread +
                                 parallelBlockId * parallelElementsPerThread;
-    Value &accumulator = accumulators[accumulatorIndex];
+    SmallVector<Value> &accumulator = accumulators[accumulatorIndex];
     unsigned axisBlockId = (blockId / blockStride) % numScanBlocks;
     if (axisBlockId == 0) // First chunk and first block
       accumulator = srcValues[srcIndex];
@@ -259,24 +300,25 @@ static void AddPartialReduceOneWarp(SmallVector<Value> &srcValues,
       srcValues[srcIndex] = accumulate(rewriter, helper.getCombineOp(),
                                        accumulator, srcValues[srcIndex]);
     // Update the rest of the contiguous elements.
-    Value lastElement = srcValues[srcIndex];
+    SmallVector<Value> lastElement = srcValues[srcIndex];
     if (scanDim > 1) {
-      lastElement =
-          shflUpSync(loc, rewriter, srcValues[srcIndex], threadStride);
-      lastElement = select(maskFirstLane, accumulator, lastElement);
+      lastElement = shuffleUp(rewriter, loc, srcValues[srcIndex], threadStride);
+      lastElement = selectOperands(rewriter, loc, maskFirstLane, accumulator,
+                                   lastElement);
       if (numScanBlocks > 1)
         // Update accumulator with the value from the last lane.
         accumulator =
-            shflIdxSync(loc, rewriter, srcValues[srcIndex], laneIdLast);
+            shuffleIdx(rewriter, loc, srcValues[srcIndex], laneIdLast);
     }
     for (unsigned i = 1; i < scanElementsPerThreads; ++i) {
-      Value laneValue = srcValues[srcIndex - i * elementStride];
+      SmallVector<Value> laneValue = srcValues[srcIndex - i * elementStride];
       laneValue =
           accumulate(rewriter, helper.getCombineOp(), lastElement, laneValue);
       if (axisBlockId == 0)
         // For the first warp and first chunk we don't have anything to
         // accumulate.
-        laneValue = select(maskFirstThread,
+        laneValue =
+            selectOperands(rewriter, loc, maskFirstThread,
                            srcValues[srcIndex - i * elementStride], laneValue);
       srcValues[srcIndex - i * elementStride] = laneValue;
     }
@@ -397,12 +439,20 @@ ScanOpConversion::emitFastScan(triton::ScanOp op, triton::ScanOpAdaptor adaptor,
 
   auto [laneIdAxis, warpIdAxis, flatIdParallel] =
       getDelinearizedIds(rewriter, helper, laneId, warpId);
-  auto input = adaptor.getOperands()[0];
-  auto type = op.getOperand(0).getType().cast<RankedTensorType>();
   auto axisNumWarps = helper.getAxisNumWarpsWithUniqueData();
   warpIdAxis = urem(warpIdAxis, i32_val(axisNumWarps));
-  SmallVector<Value> srcValues =
-      getTypeConverter()->unpackLLElements(loc, input, rewriter);
+  // Unpack the registers of each operand and put them in the order of the
+  // blocked view of the layout.
+  auto operands = adaptor.getOperands();
+  ArrayRef<unsigned> srcRegs = helper.getSrcRegs();
+  SmallVector<SmallVector<Value>> srcValues;
+  for (unsigned i = 0; i < operands.size(); ++i) {
+    auto values =
+        getTypeConverter()->unpackLLElements(loc, operands[i], rewriter);
+    srcValues.resize(values.size());
+    for (unsigned j = 0; j < values.size(); ++j)
+      srcValues[j].push_back(values[srcRegs.empty() ? j : srcRegs[j]]);
+  }
 
   // Scan contigous elements in a thread and update `srcValues`.
   scanThreadContiguousElements(srcValues, rewriter, helper);
@@ -416,14 +466,19 @@ ScanOpConversion::emitFastScan(triton::ScanOp op, triton::ScanOpAdaptor adaptor,
     Type elemPtrTys = LLVM::LLVMPointerType::get(rewriter.getContext(), 3);
     Value baseSharedMemPtr = bitcast(
         getSharedMemoryBase(loc, rewriter, op.getOperation()), elemPtrTys);
+    SmallVector<unsigned> offsets = helper.getScratchOperandOffsets();
+    SmallVector<Value> smemBases;
+    for (unsigned i = 0; i < operands.size(); ++i)
+      smemBases.push_back(
+          gep(elemPtrTys, i8_ty, baseSharedMemPtr, i32_val(offsets[i])));
     // Store the partial reducing for each warp into shared memory.
     storeWarpAccumulator(srcValues, rewriter, helper, laneIdAxis, warpIdAxis,
-                         baseSharedMemPtr, flatIdParallel);
+                         smemBases, flatIdParallel);
     barrier();
     // Read back the partial reduction of each warp and accumulate them based on
     // warpId. Then update each chunk of contiguous elements by adding the
     // accumulated value from the previous lane.
-    AddPartialReduce(srcValues, rewriter, helper, baseSharedMemPtr, warpIdAxis,
+    AddPartialReduce(srcValues, rewriter, helper, smemBases, warpIdAxis,
                      laneIdAxis, flatIdParallel);
   } else if (srcValues.size() > 1) {
     // Fast path for the case where there is only one warp with unique data on
@@ -438,8 +493,14 @@ ScanOpConversion::emitFastScan(triton::ScanOp op, triton::ScanOpAdaptor adaptor,
                             laneIdLast);
   } // else axisNumWarps == 1 and srcValues.size() == 1, nothing to do.
 
-  Value results = getTypeConverter()->packLLElements(loc, srcValues, rewriter,
-                                                     input.getType());
+  SmallVector<Value> results;
+  for (unsigned i = 0; i < operands.size(); ++i) {
+    SmallVector<Value> resultVals(srcValues.size());
+    for (unsigned j = 0; j < srcValues.size(); ++j)
+      resultVals[srcRegs.empty() ? j : srcRegs[j]] = srcValues[j][i];
+    results.push_back(getTypeConverter()->packLLElements(
+        loc, resultVals, rewriter, operands[i].getType()));
+  }
   rewriter.replaceOp(op, results);
   return success();
 }
@@ -0,0 +1,66 @@
+#include "mlir/Analysis/DataFlowFramework.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Analysis/RangeAnalysis.h"
+#include "triton/Analysis/Utility.h"
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/Triton/Transforms/Passes.h"
+
+#include <memory>
+
+namespace mlir {
+#define GEN_PASS_DEF_TRITONFOLDRANGECHECKS
+#include "triton/Dialect/Triton/Transforms/Passes.h.inc"
+} // namespace mlir
+
+using namespace mlir;
+
+namespace {
+
+// cmpi(a, b) => constant, when the ranges of a and b decide the predicate for
+// every element. Masks built from such comparisons are then removed by the
+// canonicalizer, which in turn lets loads and stores be vectorized without
+// the mask capping their alignment.
+class FoldRangeChecksPass
+    : public mlir::impl::TritonFoldRangeChecksBase<FoldRangeChecksPass> {
+public:
+  void runOnOperation() override {
+    ModuleOp m = getOperation();
+    m.walk([&](triton::FuncOp funcOp) {
+      std::unique_ptr<DataFlowSolver> solver = createDataFlowSolver();
+      solver->load<TritonIntegerRangeAnalysis>();
+      if (failed(solver->initializeAndRun(funcOp)))
+        return signalPassFailure();
+
+      SmallVector<arith::CmpIOp> cmpOps;
+      funcOp.walk([&](arith::CmpIOp cmpOp) { cmpOps.push_back(cmpOp); });
+      for (arith::CmpIOp cmpOp : cmpOps) {
+        std::optional<ConstantIntRanges> range =
+            getIntegerRange(*solver, cmpOp.getResult());
+        if (!range)
+          continue;
+        std::optional<APInt> value = range->getConstantValue();
+        if (!value)
+          continue;
+        OpBuilder builder(cmpOp);
+        Type type = cmpOp.getType();
+        Attribute attr = builder.getBoolAttr(value->getBoolValue());
+        if (auto tensorTy = type.dyn_cast<RankedTensorType>())
+          attr = DenseElementsAttr::get(tensorTy, attr);
+        auto constant = builder.create<arith::ConstantOp>(
+            cmpOp.getLoc(), type, attr.cast<TypedAttr>());
+        cmpOp.replaceAllUsesWith(constant.getResult());
+        cmpOp.erase();
+      }
+    });
+  }
+};
+
+} // namespace
+
+std::unique_ptr<mlir::Pass> mlir::triton::createFoldRangeChecksPass() {
+  return std::make_unique<FoldRangeChecksPass>();
+}
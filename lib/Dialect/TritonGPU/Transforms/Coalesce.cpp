@@ -57,27 +57,42 @@ static Value getMemAccessPtr(Operation *op) {
   return nullptr;
 }
 
-// TODO(Keren): integrate it into AxisInfoAnalysis
-static AxisInfo getAxisInfoForTensorPointer(const Value &val) {
-  auto valType = val.getType();
-  // TODO(Chenggang): encoding for tensor pointers is meaningless, remove
-  // these later while merging into the GitHub main
-  auto ptrType = valType.cast<PointerType>();
-  auto tensorTy = ptrType.getPointeeType().cast<RankedTensorType>();
-  auto makeTensorPtr = getMakeTensorPtrOp(val);
-  auto order = makeTensorPtr.getOrder();
-  auto tileShape = triton::gpu::getShapePerCTA(tensorTy);
-  size_t rank = order.size();
-  auto elemSizeInBytes = tensorTy.getElementType().getIntOrFloatBitWidth() / 8;
-  SmallVector<int64_t> contiguity(rank, 1);
-  SmallVector<int64_t> divisibility(rank, 1);
-  SmallVector<int64_t> constancy(rank, 1);
-  // The contiguity in `order[0]` is `tileShape[order[0]]`
-  // The divisibility in `order[0]` is 16
-  // TODO[goostavz]: confirm the legality of it
-  contiguity[order[0]] = tileShape[order[0]];
-  divisibility[order[0]] = 16 * 8 / elemSizeInBytes;
-  return AxisInfo(contiguity, divisibility, constancy);
+// Return true if `ptr` is a tensor of pointers or a tensor pointer.
+static bool isMemAccessPtr(Value ptr) {
+  if (auto tensorType = ptr.getType().dyn_cast<RankedTensorType>())
+    return tensorType.getElementType().isa<PointerType>();
+  if (auto ptrType = ptr.getType().dyn_cast<PointerType>())
+    return ptrType.getPointeeType().isa<RankedTensorType>();
+  return false;
+}
+
+// Axis info of the addresses accessed through `ptr`, a tensor of pointers or
+// a tensor pointer.
+static AxisInfo getPtrAxisInfo(ModuleAxisInfoAnalysis &axisInfoAnalysis,
+                               Value ptr) {
+  if (ptr.getType().isa<PointerType>())
+    return axisInfoAnalysis.getTensorPointerAxisInfo(ptr);
+  return *axisInfoAnalysis.getAxisInfo(ptr);
+}
+
+// Dimensions of `ptr` from the most to the least contiguous one.
+static SmallVector<unsigned>
+getPtrOrder(ModuleAxisInfoAnalysis &axisInfoAnalysis, Value ptr) {
+  if (ptr.getType().isa<PointerType>()) {
+    auto makeTensorPtr = getMakeTensorPtrOp(ptr);
+    return SmallVector<unsigned>(makeTensorPtr.getOrder().begin(),
+                                 makeTensorPtr.getOrder().end());
+  }
+  auto contiguity = axisInfoAnalysis.getAxisInfo(ptr)->getContiguity();
+  LLVM_DEBUG({
+    DBGS() << "contiguity is: ";
+    for (const auto &O : contiguity) {
+      llvm::dbgs() << O << " ";
+    }
+    llvm::dbgs() << "\n";
+  });
+  auto order = argSort(contiguity);
+  return SmallVector<unsigned>(order.begin(), order.end());
 }
 
 struct CoalescePass : public TritonGPUCoalesceBase<CoalescePass> {
@@ -89,24 +104,8 @@ struct CoalescePass : public TritonGPUCoalesceBase<CoalescePass> {
     auto refTensorType = getTensorType(ptr);
 
     // Get the contiguity order of `ptr`
-    SmallVector<unsigned> order;
     LDBG("op is: " << *op);
-    if (ptr.getType().isa<PointerType>()) {
-      auto makeTensorPtr = getMakeTensorPtrOp(ptr);
-      std::copy(makeTensorPtr.getOrder().begin(),
-                makeTensorPtr.getOrder().end(), std::back_inserter(order));
-    } else {
-      // Normal cases
-      auto contiguity = axisInfoAnalysis.getAxisInfo(ptr)->getContiguity();
-      order = argSort(contiguity);
-      LLVM_DEBUG({
-        DBGS() << "contiguity is: ";
-        for (const auto &O : contiguity) {
-          llvm::dbgs() << O << " ";
-        }
-        llvm::dbgs() << "\n";
-      });
-    }
+    SmallVector<unsigned> order = getPtrOrder(axisInfoAnalysis, ptr);
     LLVM_DEBUG({
       DBGS() << "order is: ";
       for (const auto &O : order) {
@@ -116,31 +115,24 @@ struct CoalescePass : public TritonGPUCoalesceBase<CoalescePass> {
     });
 
     auto matchesShape = [&refTensorType](const Value &val) {
-      if (val.getType() == refTensorType) {
-        return true;
-      }
-
-      auto rttType = val.getType().dyn_cast<RankedTensorType>();
-      return rttType ? rttType.getShape() == refTensorType.getShape() : false;
+      return getTensorType(val).getShape() == refTensorType.getShape();
     };
 
-    // The desired divisibility is the maximum divisibility
-    // among all dependent pointers who have the same order as
-    // `ptr`.
-    // We only do it for normal tensors of pointers, not tensor pointers.
+    // The desired divisibility is the maximum divisibility among all the
+    // memory accesses connected to `op` through their index computations or
+    // their values that have the same shape and order, whether they go through
+    // tensors of pointers or tensor pointers. All the loads of such a group get
+    // the same layout, so that no conversion is needed between them.
     llvm::SmallSetVector<Operation *, 32> memAccessesSameOrder;
     memAccessesSameOrder.insert(op);
-    if (ptr.getDefiningOp()) {
-      for (Operation *use : mlir::multiRootGetSlice(op)) {
-        Value val = getMemAccessPtr(use);
-        if (!val || !matchesShape(val) || memAccessesSameOrder.contains(use))
-          continue;
-        auto currOrder =
-            argSort(axisInfoAnalysis.getAxisInfo(val)->getContiguity());
-        if (order == currOrder) {
-          LDBG("multi-root-slice: insert to memAccessesSameOrder " << *use);
-          memAccessesSameOrder.insert(use);
-        }
+    for (Operation *use : mlir::multiRootGetSlice(op)) {
+      Value val = getMemAccessPtr(use);
+      if (!val || !isMemAccessPtr(val) || !matchesShape(val) ||
+          memAccessesSameOrder.contains(use))
+        continue;
+      if (order == getPtrOrder(axisInfoAnalysis, val)) {
+        LDBG("multi-root-slice: insert to memAccessesSameOrder " << *use);
+        memAccessesSameOrder.insert(use);
       }
     }
 
@@ -167,13 +159,7 @@ struct CoalescePass : public TritonGPUCoalesceBase<CoalescePass> {
 
     auto getNumElementPerThread = [&](Operation *op) {
       Value val = getMemAccessPtr(op);
-      AxisInfo valInfo;
-      if (val.getType().isa<PointerType>()) {
-        valInfo = getAxisInfoForTensorPointer(val);
-      } else {
-        assert(val.getType().isa<RankedTensorType>());
-        valInfo = *axisInfoAnalysis.getAxisInfo(val);
-      }
+      AxisInfo valInfo = getPtrAxisInfo(axisInfoAnalysis, val);
       unsigned elemNumBits = getElementBitWidth(val);
       unsigned elemNumBytes = std::max(elemNumBits / 8, 1u);
       unsigned maxMultipleBytes = valInfo.getDivisibility(order[0]);
@@ -204,7 +190,6 @@ struct CoalescePass : public TritonGPUCoalesceBase<CoalescePass> {
       // in the memory write at the warp level, resulting in worse performance.
       // For loads, we can expect that the gaps won't matter due to the L1
       // cache.
-      unsigned elemNumBits = getElementBitWidth(ptr);
       perThread = std::min<int>(perThread, getNumElementPerThread(op));
     }
     SmallVector<unsigned, 4> sizePerThread(refTensorType.getRank(), 1);
@@ -275,15 +260,8 @@ struct CoalescePass : public TritonGPUCoalesceBase<CoalescePass> {
     llvm::MapVector<Operation *, Attribute> layoutMap;
     moduleOp.walk([&](Operation *curr) {
       Value ptr = getMemAccessPtr(curr);
-      if (!ptr)
-        return;
       // We only convert `tensor<tt.ptr<>>` or `tt.ptr<tensor<>>` load/store
-      bool isPtrTensor = false, isTensorPointer = false;
-      if (auto tensorType = ptr.getType().dyn_cast<RankedTensorType>())
-        isPtrTensor = tensorType.getElementType().isa<PointerType>();
-      if (auto ptrType = ptr.getType().dyn_cast<PointerType>())
-        isTensorPointer = ptrType.getPointeeType().isa<RankedTensorType>();
-      if (!isPtrTensor && !isTensorPointer)
+      if (!ptr || !isMemAccessPtr(ptr))
         return;
       auto mod = curr->getParentOfType<ModuleOp>();
       int numWarps = triton::gpu::TritonGPUDialect::getNumWarps(mod);
@@ -5,12 +5,15 @@
 #include "mlir/IR/TypeUtilities.h"
 #include "mlir/Interfaces/SideEffectInterfaces.h"
 #include "triton/Analysis/AxisInfo.h"
+#include "triton/Analysis/BankConflicts.h"
 #include "triton/Analysis/Utility.h"
 #include "triton/Dialect/TritonGPU/IR/Dialect.h"
 #include "triton/Dialect/TritonGPU/Transforms/Passes.h"
 #include "triton/Dialect/TritonGPU/Transforms/Utility.h"
 #include "llvm/Support/Debug.h"
 
+#include <limits>
+
 #define int_attr(num) builder.getI64IntegerAttr(num)
 
 using namespace mlir;
@@ -33,8 +36,31 @@ static void appendToYield(scf::ForOp forOp, ArrayRef<Value> newOperands) {
   yieldOp->erase();
 }
 
-static void createAsyncCopy(scf::ForOp &forOp, tt::LoadOp loadOp, Value alloc,
-                            Value insertIdx, Value extractIdx) {
+/// Extract the buffer at `index` from a multi-buffered allocation.
+static ttg::ExtractSliceOp createExtractSlice(OpBuilder &builder, Location loc,
+                                             Value buffers,
+                                             RankedTensorType allocType,
+                                             Value index) {
+  ArrayRef<int64_t> shape = allocType.getShape().drop_front();
+  RankedTensorType sliceType = RankedTensorType::get(
+      shape, allocType.getElementType(), allocType.getEncoding());
+  SmallVector<OpFoldResult> offsets = {index};
+  SmallVector<OpFoldResult> sizes = {int_attr(1)};
+  SmallVector<OpFoldResult> strides = {int_attr(1)};
+  for (int64_t dim : shape) {
+    offsets.push_back(int_attr(0));
+    sizes.push_back(int_attr(dim));
+    strides.push_back(int_attr(1));
+  }
+  return builder.create<ttg::ExtractSliceOp>(loc, sliceType, buffers, offsets,
+                                             sizes, strides);
+}
+
+// The create* functions below return the operations starting the async load.
+static SmallVector<Operation *> createAsyncCopy(scf::ForOp &forOp,
+                                                tt::LoadOp loadOp, Value alloc,
+                                                Value insertIdx,
+                                                Value extractIdx) {
   OpBuilder builder(forOp);
   // Replace the load with insert/extract slice.
   builder.setInsertionPoint(loadOp);
@@ -47,15 +73,8 @@ static void createAsyncCopy(scf::ForOp &forOp, tt::LoadOp loadOp, Value alloc,
 
   // Extract part.
   auto allocType = alloc.getType().cast<RankedTensorType>();
-  RankedTensorType sliceType = RankedTensorType::get(
-      {allocType.getShape()[1], allocType.getShape()[2]},
-      allocType.getElementType(), allocType.getEncoding());
-  auto extract = builder.create<ttg::ExtractSliceOp>(
-      loc, sliceType, insertOp.getResult(),
-      SmallVector<OpFoldResult>{extractIdx, int_attr(0), int_attr(0)},
-      SmallVector<OpFoldResult>{int_attr(1), int_attr(sliceType.getShape()[0]),
-                                int_attr(sliceType.getShape()[1])},
-      SmallVector<OpFoldResult>{int_attr(1), int_attr(1), int_attr(1)});
+  auto extract = createExtractSlice(builder, loc, insertOp.getResult(),
+                                    allocType, extractIdx);
   auto newCvt = builder.create<ttg::ConvertLayoutOp>(
       loadOp->getLoc(), loadOp.getType(), extract.getResult());
   loadOp->replaceAllUsesWith(newCvt->getResults());
@@ -63,10 +82,13 @@ static void createAsyncCopy(scf::ForOp &forOp, tt::LoadOp loadOp, Value alloc,
 
   // Fix up the yield op.
   appendToYield(forOp, {insertOp});
+  return {insertOp, commmit};
 }
 
-static void createTMALoad(scf::ForOp &forOp, tt::LoadOp loadOp, Value alloc,
-                          Value insertIdx, Value extractIdx, Value phase) {
+static SmallVector<Operation *> createTMALoad(scf::ForOp &forOp,
+                                              tt::LoadOp loadOp, Value alloc,
+                                              Value insertIdx, Value extractIdx,
+                                              Value phase) {
   OpBuilder builder(forOp);
   Location loc = loadOp.getLoc();
   auto CTALayout = ttg::CTALayoutAttr::get(loadOp.getContext(),
@@ -99,9 +121,10 @@ static void createTMALoad(scf::ForOp &forOp, tt::LoadOp loadOp, Value alloc,
   unsigned elems = std::accumulate(shapePerSlice.begin(), shapePerSlice.end(),
                                    1, std::multiplies{});
   elems *= (elemTy.getIntOrFloatBitWidth() / 8);
-  builder.create<ttng::MBarrierArriveOp>(loc, barrier, pred,
-                                         /*remoteCtaId*/ nullptr,
-                                         /*trackAsyncOp*/ false, elems);
+  auto arrive = builder.create<ttng::MBarrierArriveOp>(
+      loc, barrier, pred,
+      /*remoteCtaId*/ nullptr,
+      /*trackAsyncOp*/ false, elems);
   auto allocType = alloc.getType().cast<RankedTensorType>();
   auto insertOp = builder.create<ttng::InsertSliceTMAOp>(
       loc, allocType, loadOp.getPtr(), alloc,
@@ -109,15 +132,8 @@ static void createTMALoad(scf::ForOp &forOp, tt::LoadOp loadOp, Value alloc,
       loadOp.getCache(), loadOp.getEvict(), loadOp.getIsVolatile(),
       /*axis*/ 0);
 
-  RankedTensorType sliceType = RankedTensorType::get(
-      {allocType.getShape()[1], allocType.getShape()[2]},
-      allocType.getElementType(), allocType.getEncoding());
-  auto extract = builder.create<mlir::triton::gpu::ExtractSliceOp>(
-      loc, sliceType, insertOp.getResult(),
-      SmallVector<OpFoldResult>{extractIdx, int_attr(0), int_attr(0)},
-      SmallVector<OpFoldResult>{int_attr(1), int_attr(sliceType.getShape()[0]),
-                                int_attr(sliceType.getShape()[1])},
-      SmallVector<OpFoldResult>{int_attr(1), int_attr(1), int_attr(1)});
+  auto extract = createExtractSlice(builder, loc, insertOp.getResult(),
+                                    allocType, extractIdx);
 
   Value barrierWait = builder.create<ttng::ExtractMBarrierOp>(
       loc, mBarTy, barrierArray, extractIdx);
@@ -130,28 +146,101 @@ static void createTMALoad(scf::ForOp &forOp, tt::LoadOp loadOp, Value alloc,
 
   // Fix up the yield op.
   appendToYield(forOp, {insertOp});
+  return {arrive, insertOp};
 }
 
 /// Create an async load equivalent to the given load.
-static void createAsyncLoad(scf::ForOp &forOp, tt::LoadOp loadOp, Value alloc,
-                            Value insertIdx, Value extractIdx, Value phase) {
-  if (isLoadFromTensorPtr(loadOp)) {
-    createTMALoad(forOp, loadOp, alloc, insertIdx, extractIdx, phase);
-  } else {
-    createAsyncCopy(forOp, loadOp, alloc, insertIdx, extractIdx);
-  }
+static SmallVector<Operation *> createAsyncLoad(scf::ForOp &forOp,
+                                                tt::LoadOp loadOp, Value alloc,
+                                                Value insertIdx,
+                                                Value extractIdx, Value phase) {
+  if (isLoadFromTensorPtr(loadOp))
+    return createTMALoad(forOp, loadOp, alloc, insertIdx, extractIdx, phase);
+  return createAsyncCopy(forOp, loadOp, alloc, insertIdx, extractIdx);
 }
 
 namespace {
-struct LoadDotOperand {
-  LoadDotOperand(tt::LoadOp load,
-                 ttg::DotOperandEncodingAttr dotOperandEncoding,
+// A load to convert into an async load. Loads feeding a dot get a shared
+// encoding that suits the dot operand; other loads are staged through an
+// unswizzled buffer and converted back to their original layout.
+struct LoadToPipeline {
+  enum class Kind { DotOperand, MMAv3Operand, Data };
+
+  LoadToPipeline(tt::LoadOp load, Kind kind,
+                 ttg::DotOperandEncodingAttr dotOperandEncoding = nullptr,
                  bool needTrans = false)
-      : load(load), dotOperandEncoding(dotOperandEncoding),
+      : load(load), kind(kind), dotOperandEncoding(dotOperandEncoding),
         needTrans(needTrans) {}
   tt::LoadOp load;
+  Kind kind;
   ttg::DotOperandEncodingAttr dotOperandEncoding;
   bool needTrans;
+  // Number of stages of the pipeline for this load.
+  int numStages = 0;
+};
+
+// Dependencies between the operations of a loop body. Values used in nested
+// regions count as operands of the enclosing operation. A dependency through
+// loop-carried values has the number of iterations it spans as distance.
+class LoopDepGraph {
+public:
+  struct Dep {
+    Operation *op;
+    unsigned distance;
+  };
+
+  explicit LoopDepGraph(scf::ForOp forOp) {
+    Block *body = forOp.getBody();
+    Operation *yieldOp = body->getTerminator();
+    for (Operation &op : body->without_terminator()) {
+      SmallVector<Dep> &opDeps = deps[&op];
+      op.walk([&](Operation *nested) {
+        for (Value operand : nested->getOperands()) {
+          Value v = operand;
+          unsigned distance = 0;
+          while (auto arg = v.dyn_cast<BlockArgument>()) {
+            if (arg.getOwner() != body || arg.getArgNumber() == 0 ||
+                distance > body->getNumArguments())
+              break;
+            v = yieldOp->getOperand(arg.getArgNumber() - 1);
+            ++distance;
+          }
+          Operation *defOp = v.getDefiningOp();
+          if (!defOp)
+            continue;
+          Operation *ancestor = body->findAncestorOpInBlock(*defOp);
+          if (ancestor && ancestor != &op)
+            opDeps.push_back({ancestor, distance});
+        }
+      });
+    }
+  }
+
+  ArrayRef<Dep> getDeps(Operation *op) const {
+    auto it = deps.find(op);
+    if (it == deps.end())
+      return {};
+    return it->second;
+  }
+
+  // Add `op` and the operations it transitively depends on to `ops`. Only
+  // follow dependencies spanning at most `maxDistance` iterations, and stop
+  // at operations in `filter`.
+  void addProducers(Operation *op, DenseSet<Operation *> &ops,
+                    unsigned maxDistance,
+                    const DenseSet<Operation *> *filter = nullptr) const {
+    if (filter && filter->count(op))
+      return;
+    if (!ops.insert(op).second)
+      return;
+    for (const Dep &dep : getDeps(op)) {
+      if (dep.distance <= maxDistance)
+        addProducers(dep.op, ops, maxDistance, filter);
+    }
+  }
+
+private:
+  DenseMap<Operation *, SmallVector<Dep>> deps;
 };
 } // namespace
 
@@ -192,7 +281,7 @@ allTransitiveUsesHaveDotEncoding(Value val, bool &needTrans) {
 }
 
 // Return the transitive use of the load which is a dot operand.
-static std::optional<LoadDotOperand> loadDotOperand(tt::LoadOp loadOp,
+static std::optional<LoadToPipeline> loadDotOperand(tt::LoadOp loadOp,
                                                     bool &hasMMAV3) {
   bool isCandidate = false;
   if (loadOp.getResult().hasOneUse()) {
@@ -215,7 +304,7 @@ static std::optional<LoadDotOperand> loadDotOperand(tt::LoadOp loadOp,
             // TODO: remove this constraint once the LoadOp supports transpose
             // fusion
             hasMMAV3 = true;
-            return LoadDotOperand(loadOp, nullptr);
+            return LoadToPipeline(loadOp, LoadToPipeline::Kind::MMAv3Operand);
           }
         }
       }
@@ -226,27 +315,81 @@ static std::optional<LoadDotOperand> loadDotOperand(tt::LoadOp loadOp,
       allTransitiveUsesHaveDotEncoding(loadOp.getResult(), needTrans);
   if (!attr)
     return std::nullopt;
-  return LoadDotOperand(loadOp, attr, needTrans);
+  return LoadToPipeline(loadOp, LoadToPipeline::Kind::DotOperand, attr,
+                        needTrans);
+}
+
+// Return true if the result of the load can be staged through shared memory
+// without feeding a dot. The round trip through shared memory is only
+// lowered for 2D blocked layouts.
+static bool canPipelineDataLoad(tt::LoadOp loadOp) {
+  if (isLoadFromTensorPtr(loadOp))
+    return false;
+  auto ty = loadOp.getType().dyn_cast<RankedTensorType>();
+  return ty && ty.getRank() == 2 &&
+         ty.getEncoding().isa<ttg::BlockedEncodingAttr>();
+}
+
+// Return true if staging a load that doesn't feed a dot through shared memory
+// is expected to beat a blocking load. `vec` is the number of contiguous and
+// aligned elements the load can access at once.
+static bool isDataLoadProfitable(tt::LoadOp loadOp, unsigned vec,
+                                 int computeCapability) {
+  auto ty = loadOp.getType().cast<RankedTensorType>();
+  Attribute encoding = ty.getEncoding();
+  unsigned sizePerThread =
+      ttg::getSizePerThread(encoding)[ttg::getOrder(encoding)[0]];
+  unsigned bitWidth =
+      std::min(vec, sizePerThread) * ty.getElementTypeBitWidth();
+  // Copies the target can't do asynchronously are decomposed back into a
+  // blocking load and a shared memory store, which is strictly worse than the
+  // original load.
+  if (!ttg::InsertSliceAsyncOp::getEligibleLoadByteWidth(computeCapability)
+           .contains(std::min(bitWidth, 128u) / 8))
+    return false;
+  // Narrower copies take several cp.async per thread for what one vectorized
+  // load would fetch, and go through L1; the extra shared memory read then
+  // costs more than the latency it hides.
+  return bitWidth >= 128;
 }
 
 /// Collect loads to pipeline. Return success if we can pipeline this loop
-static void collectOpsToPipeline(scf::ForOp forOp,
-                                 SmallVectorImpl<LoadDotOperand> &ops,
+static void collectOpsToPipeline(scf::ForOp forOp, int numStages,
+                                 int computeCapability,
+                                 int64_t sharedMemoryBudget,
+                                 SmallVectorImpl<LoadToPipeline> &ops,
                                  bool &hasMMAV3) {
   ModuleOp moduleOp = forOp->getParentOfType<ModuleOp>();
   ModuleAxisInfoAnalysis axisInfoAnalysis(moduleOp);
 
+  // Loads whose result is needed to compute the operands of a load, in the
+  // same or in a later iteration, must stay synchronous unless they feed a
+  // dot: they are scheduled next to the loads that depend on them.
+  LoopDepGraph graph(forOp);
+  DenseSet<Operation *> loadOperandDeps;
+  for (tt::LoadOp loadOp : forOp.getBody()->getOps<tt::LoadOp>()) {
+    for (const LoopDepGraph::Dep &dep : graph.getDeps(loadOp))
+      graph.addProducers(dep.op, loadOperandDeps,
+                         std::numeric_limits<unsigned>::max());
+  }
+  // Staging buffers cost occupancy, which loops without dots rely on to hide
+  // latency as well. Stop staging loads that don't feed a dot once one stage
+  // of them would take more than a quarter of the shared memory.
+  int64_t dataStageBudget = sharedMemoryBudget / 4;
+  int64_t dataStageSize = 0;
+
   // We cannot use forOp.walk(...) here because we only want to visit the
   // operations in the loop body block. Nested blocks are handled separately.
   for (Operation &op : forOp) {
     if (auto loadOp = dyn_cast<tt::LoadOp>(&op)) {
       bool candidate = false;
+      unsigned vec = 1;
       if (isLoadFromTensorPtr(loadOp)) {
         // Map to TMA load.
         candidate = true;
       } else {
         auto ptr = loadOp.getPtr();
-        unsigned vec = axisInfoAnalysis.getPtrContiguity(ptr);
+        vec = axisInfoAnalysis.getPtrContiguity(ptr);
         if (auto mask = loadOp.getMask())
           vec =
               std::min<unsigned>(vec, axisInfoAnalysis.getMaskAlignment(mask));
@@ -267,34 +410,62 @@ static void collectOpsToPipeline(scf::ForOp forOp,
       }
       if (!candidate)
         continue;
-      std::optional<LoadDotOperand> loadWithDotOperand =
+      int loadStages = getNumStages(loadOp, numStages);
+      if (loadStages < 2)
+        continue;
+      std::optional<LoadToPipeline> loadToPipeline =
           loadDotOperand(loadOp, hasMMAV3);
-      if (!loadWithDotOperand.has_value())
+      if (!loadToPipeline.has_value() && canPipelineDataLoad(loadOp) &&
+          !loadOperandDeps.count(loadOp) &&
+          isDataLoadProfitable(loadOp, vec, computeCapability)) {
+        auto ty = loadOp.getType().cast<RankedTensorType>();
+        int64_t size = ShapedType::getNumElements(ttg::getShapePerCTA(ty)) *
+                       ty.getElementTypeBitWidth() / 8;
+        if (dataStageSize + size <= dataStageBudget) {
+          dataStageSize += size;
+          loadToPipeline = LoadToPipeline(loadOp, LoadToPipeline::Kind::Data);
+        }
+      }
+      if (!loadToPipeline.has_value())
         continue;
-      ops.push_back(loadWithDotOperand.value());
+      loadToPipeline->numStages = loadStages;
+      ops.push_back(loadToPipeline.value());
     }
   }
 }
 
 // Create an allocation that can old distance number of loadOp shapes.
-static Value createAlloc(scf::ForOp &forOp, tt::LoadOp loadOp,
-                         ttg::DotOperandEncodingAttr dotOpEnc,
-                         unsigned distance, bool needTrans) {
+static Value createAlloc(scf::ForOp &forOp, const LoadToPipeline &load,
+                         unsigned distance) {
   OpBuilder builder(forOp);
+  tt::LoadOp loadOp = load.load;
   auto ty = loadOp.getType().cast<RankedTensorType>();
   Attribute sharedEnc;
   auto CTALayout = ttg::getCTALayout(ty.getEncoding());
-  if (dotOpEnc) {
+  switch (load.kind) {
+  case LoadToPipeline::Kind::DotOperand: {
     unsigned bitWidth = ty.getElementType().getIntOrFloatBitWidth();
     // set needTrans to avoid unnecessary conversion between shared encodings.
     sharedEnc = ttg::SharedEncodingAttr::get(
-        ty.getContext(), dotOpEnc, ty.getShape(),
-        ttg::getOrder(ty.getEncoding()), CTALayout, bitWidth, needTrans);
-  } else {
-    // MMAv3
+        ty.getContext(), load.dotOperandEncoding, ty.getShape(),
+        ttg::getOrder(ty.getEncoding()), CTALayout, bitWidth, load.needTrans);
+    break;
+  }
+  case LoadToPipeline::Kind::MMAv3Operand:
     sharedEnc = ttg::SharedEncodingAttr::get(ty.getContext(), ty.getShape(),
                                              ttg::getOrder(ty.getEncoding()),
                                              CTALayout, ty.getElementType());
+    break;
+  case LoadToPipeline::Kind::Data: {
+    // The buffer is written and read back in the same layout, only swizzle it
+    // when the accesses of that layout conflict.
+    auto blocked = ty.getEncoding().cast<ttg::BlockedEncodingAttr>();
+    auto order = blocked.getOrder();
+    unsigned vec = std::min<unsigned>(blocked.getSizePerThread()[order[0]],
+                                      128 / ty.getElementTypeBitWidth());
+    sharedEnc = getMinBankConflictSharedEncoding(ty, order, vec);
+    break;
+  }
   }
   SmallVector<int64_t> bufferShape(ty.getShape().begin(), ty.getShape().end());
   bufferShape.insert(bufferShape.begin(), distance);
@@ -306,36 +477,57 @@ static Value createAlloc(scf::ForOp &forOp, tt::LoadOp loadOp,
 }
 
 // Convert load ops into their asyn version and apply multi-buffering based on
-// the number of stages.
-static SmallVector<Value> createAsynOps(scf::ForOp &forOp,
-                                        ArrayRef<LoadDotOperand> loads,
-                                        int numStages, bool hasMMAV3) {
+// the number of stages of each load. Record in `startStages` the stage in
+// which the operations starting each async load are scheduled.
+static SmallVector<Value>
+createAsynOps(scf::ForOp &forOp, ArrayRef<LoadToPipeline> loads, int numStages,
+              bool hasMMAV3, DenseMap<Operation *, unsigned> &startStages) {
   struct AsyncLoad {
-    AsyncLoad(tt::LoadOp loadOp, Value alloc) : loadOp(loadOp), alloc(alloc) {}
+    AsyncLoad(tt::LoadOp loadOp, Value alloc, unsigned counters,
+              unsigned stage)
+        : loadOp(loadOp), alloc(alloc), counters(counters), stage(stage) {}
     tt::LoadOp loadOp;
     Value alloc;
+    unsigned counters;
+    unsigned stage;
+  };
+  // Loads with the same number of buffers share their insert and extract
+  // indices.
+  struct BufferCounters {
+    BufferCounters(int numBuffers) : numBuffers(numBuffers) {}
+    int numBuffers;
+    bool needsMbarrierPhase = false;
+    Value insertIdx;
+    Value extractIdx;
+    Value phase;
   };
-  int numBuffers = numStages - 1;
-  // For MMAv3 we need an extra buffer as this is assumed in the wgmma
-  // pipelining post-processing.
-  // TODO: Improve modeling of wgmma pipelining.
-  if (hasMMAV3)
-    numBuffers++;
   SmallVector<AsyncLoad> asyncLoads;
+  SmallVector<BufferCounters> counters;
   SmallVector<Value> allocs;
   SmallVector<Value> newOperands;
-  bool needsMbarrierPhase = false;
   bool needsAsyncWait = false;
-  for (const LoadDotOperand &loadOperand : loads) {
+  for (const LoadToPipeline &loadOperand : loads) {
     tt::LoadOp loadOp = loadOperand.load;
-    Value alloc = createAlloc(forOp, loadOp, loadOperand.dotOperandEncoding,
-                              numBuffers, loadOperand.needTrans);
+    int numBuffers = loadOperand.numStages - 1;
+    // For MMAv3 we need an extra buffer as this is assumed in the wgmma
+    // pipelining post-processing.
+    // TODO: Improve modeling of wgmma pipelining.
+    if (hasMMAV3)
+      numBuffers++;
+    auto it = llvm::find_if(counters, [&](const BufferCounters &c) {
+      return c.numBuffers == numBuffers;
+    });
+    unsigned counterIdx = std::distance(counters.begin(), it);
+    if (it == counters.end())
+      counters.emplace_back(numBuffers);
+    Value alloc = createAlloc(forOp, loadOperand, numBuffers);
     assert(alloc && "Failed to create alloc for the async load.");
     newOperands.push_back(alloc);
     allocs.push_back(alloc);
-    asyncLoads.emplace_back(loadOp, alloc);
+    asyncLoads.emplace_back(loadOp, alloc, counterIdx,
+                            numStages - loadOperand.numStages);
     if (isLoadFromTensorPtr(loadOp))
-      needsMbarrierPhase = true;
+      counters[counterIdx].needsMbarrierPhase = true;
     else
       needsAsyncWait = true;
   }
@@ -346,16 +538,14 @@ static SmallVector<Value> createAsynOps(scf::ForOp &forOp,
   Value minusOne = builder.create<arith::ConstantIntOp>(loc, -1, 32);
   Value zero = builder.create<arith::ConstantIntOp>(loc, 0, 32);
   Value one = builder.create<arith::ConstantIntOp>(loc, 1, 32);
-  Value insertIdx = minusOne;
-  Value extractIdx = minusOne;
-  Value numBuffersVal =
-      builder.create<arith::ConstantIntOp>(loc, numBuffers, 32);
-  newOperands.push_back(insertIdx);
-  newOperands.push_back(extractIdx);
-  Value phase;
-  if (needsMbarrierPhase) {
-    phase = builder.create<arith::ConstantIntOp>(loc, 0, 1);
-    newOperands.push_back(phase);
+  SmallVector<Value> numBuffersVals;
+  for (BufferCounters &c : counters) {
+    numBuffersVals.push_back(
+        builder.create<arith::ConstantIntOp>(loc, c.numBuffers, 32));
+    newOperands.push_back(minusOne);
+    newOperands.push_back(minusOne);
+    if (c.needsMbarrierPhase)
+      newOperands.push_back(builder.create<arith::ConstantIntOp>(loc, 0, 1));
   }
   unsigned newOperandIndex = forOp.getBody()->getNumArguments();
   // Patch the loop to add the new loop carried dependencies.
@@ -366,37 +556,43 @@ static SmallVector<Value> createAsynOps(scf::ForOp &forOp,
   for (int i = 0; i < asyncLoads.size(); i++) {
     asyncLoads[i].alloc = newForOp.getBody()->getArgument(newOperandIndex + i);
   }
-  insertIdx =
-      newForOp.getBody()->getArgument(newOperandIndex + asyncLoads.size());
-  extractIdx =
-      newForOp.getBody()->getArgument(newOperandIndex + asyncLoads.size() + 1);
 
   // Create two counters for the insert and extract indices to avoid creating
   // long liverange.
   builder.setInsertionPoint(asyncLoads.front().loadOp);
-  insertIdx = builder.create<arith::AddIOp>(loc, insertIdx, one);
-  Value cndIns = builder.create<arith::CmpIOp>(loc, arith::CmpIPredicate::slt,
-                                               insertIdx, numBuffersVal);
-  insertIdx = builder.create<arith::SelectOp>(loc, cndIns, insertIdx, zero);
+  unsigned argIdx = newOperandIndex + asyncLoads.size();
+  SmallVector<Value> newYieldOperands;
+  for (auto [c, numBuffersVal] : llvm::zip(counters, numBuffersVals)) {
+    Value insertIdx = newForOp.getBody()->getArgument(argIdx++);
+    Value extractIdx = newForOp.getBody()->getArgument(argIdx++);
+    insertIdx = builder.create<arith::AddIOp>(loc, insertIdx, one);
+    Value cndIns = builder.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::slt, insertIdx, numBuffersVal);
+    c.insertIdx = builder.create<arith::SelectOp>(loc, cndIns, insertIdx, zero);
 
-  extractIdx = builder.create<arith::AddIOp>(loc, extractIdx, one);
-  Value cndExt = builder.create<arith::CmpIOp>(loc, arith::CmpIPredicate::slt,
-                                               extractIdx, numBuffersVal);
-  extractIdx = builder.create<arith::SelectOp>(loc, cndExt, extractIdx, zero);
+    extractIdx = builder.create<arith::AddIOp>(loc, extractIdx, one);
+    Value cndExt = builder.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::slt, extractIdx, numBuffersVal);
+    c.extractIdx =
+        builder.create<arith::SelectOp>(loc, cndExt, extractIdx, zero);
+    newYieldOperands.push_back(c.insertIdx);
+    newYieldOperands.push_back(c.extractIdx);
 
-  if (needsMbarrierPhase) {
-    phase = newForOp.getBody()->getArgument(newOperandIndex +
-                                            asyncLoads.size() + 2);
-    Value oneI1 = builder.create<arith::ConstantIntOp>(loc, 1, 1);
-    Value nextPhase = builder.create<arith::XOrIOp>(loc, phase, oneI1);
-    phase = builder.create<arith::SelectOp>(loc, cndExt, phase, nextPhase);
+    if (c.needsMbarrierPhase) {
+      Value phase = newForOp.getBody()->getArgument(argIdx++);
+      Value oneI1 = builder.create<arith::ConstantIntOp>(loc, 1, 1);
+      Value nextPhase = builder.create<arith::XOrIOp>(loc, phase, oneI1);
+      c.phase = builder.create<arith::SelectOp>(loc, cndExt, phase, nextPhase);
+      newYieldOperands.push_back(c.phase);
+    }
   }
 
-  bool firstLoad = true;
   for (AsyncLoad &asyncLoad : asyncLoads) {
-    createAsyncLoad(forOp, asyncLoad.loadOp, asyncLoad.alloc, insertIdx,
-                    extractIdx, phase);
-    firstLoad = false;
+    const BufferCounters &c = counters[asyncLoad.counters];
+    for (Operation *op :
+         createAsyncLoad(forOp, asyncLoad.loadOp, asyncLoad.alloc, c.insertIdx,
+                         c.extractIdx, c.phase))
+      startStages[op] = asyncLoad.stage;
   }
   // Insert a waitOp after the first async copy. This does make the assumption
   // that the wait will be scheduled in a different stage that all the async
@@ -409,9 +605,6 @@ static SmallVector<Value> createAsynOps(scf::ForOp &forOp,
       break;
     }
   }
-  SmallVector<Value> newYieldOperands = {insertIdx, extractIdx};
-  if (needsMbarrierPhase)
-    newYieldOperands.push_back(phase);
   // Patch the yield with the updated counters.
   appendToYield(forOp, newYieldOperands);
 
@@ -489,147 +682,237 @@ static void setWaitNum(Operation *op,
   }
 }
 
-/// Helper to recursively add dependencies to the same stage.
-static void addDep(Operation *op, DenseSet<Operation *> &deps,
-                   bool includeArg = true,
-                   DenseSet<Operation *> *filter = nullptr) {
-  if (filter && filter->count(op))
-    return;
-  if (!deps.insert(op).second)
-    return;
-  for (Value operand : op->getOperands()) {
-    Value v = operand;
-    llvm::SmallDenseSet<Value> seen;
-    while (auto arg = v.dyn_cast<BlockArgument>()) {
-      if (!includeArg)
-        break;
-      if (!seen.insert(v).second)
-        break;
-      if (arg.getArgNumber() > 0 && arg.getOwner() == op->getBlock()) {
-        auto yieldOp = op->getBlock()->getTerminator();
-        v = yieldOp->getOperand(arg.getArgNumber() - 1);
-        continue;
-      }
-      break;
-    }
-    Operation *defOp = v.getDefiningOp();
-    if (defOp && defOp->getBlock() == op->getBlock()) {
-      addDep(defOp, deps, includeArg, filter);
-    }
-  }
+// Operations starting an async load.
+static bool isAsyncLoadStart(Operation *op) {
+  return isa<ttg::InsertSliceAsyncOp, ttg::AsyncCommitGroupOp,
+             ttng::MBarrierArriveOp, ttng::InsertSliceTMAOp>(op);
 }
 
-// Add operations to the shedule with the given stage based on the filter
-// function.
-static void addOps(scf::ForOp forOp, int stage,
-                   std::vector<std::pair<Operation *, unsigned>> &schedule,
-                   std::function<bool(Operation *)> filter) {
-  for (Operation &op : forOp.getBody()->without_terminator()) {
-    if (!filter(&op))
-      continue;
-    schedule.emplace_back(&op, stage);
+// Operations reading the result of an async load, which can be issued ahead
+// of the consumers so that they play well with the prefetch pass.
+static bool isAsyncLoadEnd(Operation *op) {
+  return isa<ttg::ExtractSliceOp, ttg::AsyncWaitOp>(op);
+}
+
+// Check that the schedule can be expanded: a value must be produced before it
+// is used, in an earlier stage or earlier in the same stage, once its latency
+// in stages has elapsed. A value carried over from the previous iteration may
+// come from one stage later.
+static bool
+verifySchedule(const LoopDepGraph &graph,
+               ArrayRef<std::pair<Operation *, unsigned>> schedule,
+               const DenseMap<Operation *, unsigned> &latencies) {
+  DenseMap<Operation *, std::pair<unsigned, unsigned>> positions;
+  for (unsigned index = 0; index < schedule.size(); ++index)
+    positions[schedule[index].first] = {schedule[index].second, index};
+  for (unsigned index = 0; index < schedule.size(); ++index) {
+    auto [op, stage] = schedule[index];
+    for (const LoopDepGraph::Dep &dep : graph.getDeps(op)) {
+      auto [defStage, defIndex] = positions.lookup(dep.op);
+      if (dep.distance > 1 || defStage > stage + dep.distance)
+        return false;
+      if (dep.distance != 0)
+        continue;
+      if (stage < defStage + latencies.lookup(dep.op))
+        return false;
+      if (stage == defStage && defIndex > index)
+        return false;
+    }
   }
+  return true;
 }
 
-// create the schedule for a matmul loop. This is ad hoc based on how we know
-// matmul loops should be pipelined and is not a generic scheduler.
+// Create the schedule of the loop. Each async load starts in the stage given
+// by `startStages` and the operations computing its operands are scheduled as
+// soon as possible with it. A load with `n` buffers has to be consumed `n - 1`
+// stages after it starts so that a buffer is free for the next load: all the
+// results are read in stage `numStages - 2`. Everything else is scheduled as
+// late as possible in the last stage.
+// Return an empty schedule if the dependencies of the loop cannot be honoured.
 static std::vector<std::pair<Operation *, unsigned>>
-createSchedule(scf::ForOp forOp, int numStages, bool prefetchExtract) {
-  SmallVector<Operation *> insertOps;
-  SmallVector<Operation *> extractOps;
-  // Find the insert/extract ops that will go respectively in stage 0 and stage
-  // `numStages - 2`. All the other operations will go in stage `numStages - 1`.
+createSchedule(scf::ForOp forOp, int numStages, bool prefetchExtract,
+               const DenseMap<Operation *, unsigned> &startStages) {
+  LoopDepGraph graph(forOp);
+  SmallVector<Operation *> startOps;
+  SmallVector<Operation *> endOps;
   for (Operation &op : forOp.getBody()->without_terminator()) {
-    if (isa<ttg::InsertSliceAsyncOp, ttg::AsyncCommitGroupOp,
-            ttng::MBarrierArriveOp, ttng::InsertSliceTMAOp>(op))
-      insertOps.emplace_back(&op);
-    if (prefetchExtract) {
-      if (isa<ttg::ExtractSliceOp, ttg::AsyncWaitOp>(op))
-        extractOps.emplace_back(&op);
-    }
+    if (isAsyncLoadStart(&op))
+      startOps.push_back(&op);
+    if (prefetchExtract && isAsyncLoadEnd(&op))
+      endOps.push_back(&op);
   }
-  DenseSet<Operation *> insertAndDeps;
-  for (Operation *op : insertOps) {
-    addDep(op, insertAndDeps, false);
+  // Producers shared by several loads go with the earliest one.
+  llvm::stable_sort(startOps, [&](Operation *a, Operation *b) {
+    return startStages.lookup(a) < startStages.lookup(b);
+  });
+  DenseMap<Operation *, unsigned> stages;
+  DenseSet<Operation *> startAndDeps;
+  for (Operation *op : startOps) {
+    DenseSet<Operation *> deps;
+    graph.addProducers(op, deps, /*maxDistance=*/0, &startAndDeps);
+    for (Operation *dep : deps)
+      stages[dep] = startStages.lookup(op);
+    startAndDeps.insert(deps.begin(), deps.end());
   }
 
   // Find depenencies with distance of 1.
-  SmallVector<Operation *> distanceOneUsers;
-  for (Operation *op : insertAndDeps) {
-    for (Value operand : op->getOperands()) {
-      if (auto arg = operand.dyn_cast<BlockArgument>()) {
-        if (arg.getArgNumber() > 0 && arg.getOwner() == op->getBlock()) {
-          auto yieldOp = op->getBlock()->getTerminator();
-          Value v = yieldOp->getOperand(arg.getArgNumber() - 1);
-          Operation *defOp = v.getDefiningOp();
-          if (defOp && insertAndDeps.count(defOp) == 0) {
-            distanceOneUsers.push_back(defOp);
-          }
-        }
-      }
+  SmallVector<Operation *> distanceOneDeps;
+  for (Operation *op : startAndDeps) {
+    for (const LoopDepGraph::Dep &dep : graph.getDeps(op)) {
+      if (dep.distance == 1 && !startAndDeps.count(dep.op))
+        distanceOneDeps.push_back(dep.op);
     }
   }
   // Schedule loads with a distance of 1 in stage 0
-  for (Operation *op : distanceOneUsers) {
-    if (isa<tt::LoadOp>(op)) {
-      addDep(op, insertAndDeps, true);
-    }
+  for (Operation *op : distanceOneDeps) {
+    if (!isa<tt::LoadOp>(op))
+      continue;
+    DenseSet<Operation *> deps;
+    graph.addProducers(op, deps, std::numeric_limits<unsigned>::max());
+    for (Operation *dep : deps)
+      stages[dep] = 0;
+    startAndDeps.insert(deps.begin(), deps.end());
   }
   // For the rest of the ops we can move then into stage 1 so that they can be
   // closer to their uses.
-  DenseSet<Operation *> stage1deps;
-  for (Operation *op : distanceOneUsers) {
-    if (!isa<tt::LoadOp>(op)) {
-      addDep(op, stage1deps, true, &insertAndDeps);
-    }
+  DenseSet<Operation *> stage1Deps;
+  for (Operation *op : distanceOneDeps) {
+    if (!isa<tt::LoadOp>(op))
+      graph.addProducers(op, stage1Deps, std::numeric_limits<unsigned>::max(),
+                         &startAndDeps);
   }
 
-  DenseSet<Operation *> extractAndDeps;
-  for (Operation *op : extractOps) {
-    addDep(op, extractAndDeps, true, &insertAndDeps);
-  }
-  std::vector<std::pair<Operation *, unsigned>> schedule;
-  // Schedule stage `numStage - 1` first.
-  addOps(forOp, numStages - 1, schedule, [&](Operation *op) {
-    return insertAndDeps.count(op) == 0 && stage1deps.count(op) == 0 &&
-           extractAndDeps.count(op) == 0;
-  });
+  DenseSet<Operation *> scheduled(startAndDeps.begin(), startAndDeps.end());
+  scheduled.insert(stage1Deps.begin(), stage1Deps.end());
+  DenseSet<Operation *> endAndDeps;
+  for (Operation *op : endOps)
+    graph.addProducers(op, endAndDeps, std::numeric_limits<unsigned>::max(),
+                       &scheduled);
+  unsigned readyStage = numStages - 2;
+  DenseMap<Operation *, unsigned> latencies;
+  for (Operation *op : startOps)
+    latencies[op] = readyStage - stages[op];
 
-  // Schedule some dependencies with distance of 1 into stage 1 to reduce
-  // pressure.
-  addOps(forOp, 1, schedule,
-         [&](Operation *op) { return stage1deps.count(op); });
+  // Each cluster is emitted in program order, the clusters in the order below
+  // make up the order of the kernel loop.
+  enum Cluster { Last, DistanceOne, Start, End };
+  auto getCluster = [&](Operation *op) {
+    if (startAndDeps.count(op))
+      return Start;
+    if (stage1Deps.count(op))
+      return DistanceOne;
+    if (endAndDeps.count(op))
+      return End;
+    return Last;
+  };
+  const unsigned clusterStages[] = {unsigned(numStages - 1), 1, 0, readyStage};
+  std::vector<std::pair<Operation *, unsigned>> schedule;
+  for (Cluster cluster : {Last, DistanceOne, Start, End}) {
+    for (Operation &op : forOp.getBody()->without_terminator()) {
+      if (getCluster(&op) != cluster)
+        continue;
+      unsigned stage = cluster == Start ? stages[&op] : clusterStages[cluster];
+      schedule.emplace_back(&op, stage);
+    }
+  }
+  if (!verifySchedule(graph, schedule, latencies))
+    return {};
+  return schedule;
+}
 
-  // Then Schedule stage 0.
-  addOps(forOp, 0, schedule,
-         [&](Operation *op) { return insertAndDeps.count(op); });
+int mlir::triton::getNumStages(Operation *op, int defaultNumStages) {
+  if (auto attr = op->getAttrOfType<IntegerAttr>(kNumStagesAttrName))
+    return attr.getInt();
+  return defaultNumStages;
+}
 
-  // Finally schedule the extract ops in stage `numStage - 2` so that they get
-  // pre-fetched and play well with pretech pass.
-  addOps(forOp, numStages - 2, schedule,
-         [&](Operation *op) { return extractAndDeps.count(op); });
-  return schedule;
+mlir::triton::PipelineBufferSize
+mlir::triton::getPipelineBufferSize(scf::ForOp forOp, int computeCapability,
+                                    int64_t sharedMemoryBudget) {
+  // Any depth of at least two stages selects the same loads.
+  SmallVector<LoadToPipeline> loads;
+  bool hasMMAV3 = false;
+  collectOpsToPipeline(forOp, /*numStages=*/2, computeCapability,
+                       sharedMemoryBudget, loads, hasMMAV3);
+  PipelineBufferSize size;
+  for (const LoadToPipeline &load : loads) {
+    auto ty = load.load.getType().cast<RankedTensorType>();
+    int64_t numElements = ShapedType::getNumElements(ttg::getShapePerCTA(ty));
+    int64_t bufferSize = numElements * ty.getElementTypeBitWidth() / 8;
+    // Matches the number of buffers allocated in createAsynOps.
+    int64_t extraBuffers = hasMMAV3 ? 0 : -1;
+    if (load.load->hasAttr(kNumStagesAttrName)) {
+      size.fixed += (load.numStages + extraBuffers) * bufferSize;
+    } else {
+      size.perStage += bufferSize;
+      size.fixed += extraBuffers * bufferSize;
+    }
+  }
+  return size;
 }
 
 bool mlir::triton::preProcessLoopAndGetSchedule(
-    scf::ForOp &forOp, int numStages, mlir::triton::PipeliningOption &options) {
+    scf::ForOp &forOp, int numStages, int computeCapability,
+    int64_t sharedMemoryBudget, mlir::triton::PipeliningOption &options) {
   // 1. First collect "interesting" operations with a stage where to schedule
   // them. This gives a coarse scheduling for the loop.
-  SmallVector<LoadDotOperand> loads;
+  SmallVector<LoadToPipeline> loads;
   bool hasMMAV3 = false;
-  collectOpsToPipeline(forOp, loads, hasMMAV3);
+  collectOpsToPipeline(forOp, numStages, computeCapability, sharedMemoryBudget,
+                       loads, hasMMAV3);
   if (loads.empty())
     return false;
-  bool hasAsynCp = llvm::any_of(loads, [](LoadDotOperand &load) {
+  bool hasAsynCp = llvm::any_of(loads, [](LoadToPipeline &load) {
     return !isLoadFromTensorPtr(load.load);
   });
-  // 2. Convert the loads into async loads and create the allocs.
-  SmallVector<Value> allocs = createAsynOps(forOp, loads, numStages, hasMMAV3);
+  // Loads may ask for a deeper pipeline than the loop.
+  for (const LoadToPipeline &load : loads)
+    numStages = std::max(numStages, load.numStages);
+  // 2. Convert the loads into async loads and create the allocs. This is done
+  // on a copy of the loop, inserted right before it, so that the loop can be
+  // left untouched if it cannot be scheduled.
+  Operation *prevOp = forOp->getPrevNode();
+  OpBuilder builder(forOp);
+  IRMapping mapping;
+  auto newForOp = cast<scf::ForOp>(builder.clone(*forOp, mapping));
+  for (LoadToPipeline &load : loads)
+    load.load =
+        mapping.lookup(load.load.getResult()).getDefiningOp<tt::LoadOp>();
+  DenseMap<Operation *, unsigned> startStages;
+  SmallVector<Value> allocs =
+      createAsynOps(newForOp, loads, numStages, hasMMAV3, startStages);
 
   // 3. Create the final schedule for the kernel loop. This will dictate the
   // stages and order of operations to the pipeline expander.
-  std::vector<std::pair<Operation *, unsigned>> schedule =
-      createSchedule(forOp, numStages, /*prefetchExtract=*/!hasMMAV3);
+  std::vector<std::pair<Operation *, unsigned>> schedule = createSchedule(
+      newForOp, numStages, /*prefetchExtract=*/!hasMMAV3, startStages);
+
+  // Loops whose dependencies the expander cannot honour are not pipelined.
+  // The async loads would only add waits and buffers to them, so drop the copy
+  // and everything created for it.
+  if (schedule.empty()) {
+    Block::iterator begin = prevOp ? std::next(prevOp->getIterator())
+                                   : forOp->getBlock()->begin();
+    SmallVector<Operation *> created;
+    for (Operation &op : llvm::make_range(begin, forOp->getIterator()))
+      created.push_back(&op);
+    for (Operation *op : llvm::reverse(created))
+      op->erase();
+    return false;
+  }
+  forOp->replaceAllUsesWith(
+      newForOp->getResults().take_front(forOp->getNumResults()));
+  forOp.erase();
+  forOp = newForOp;
+
+  if (hasAsynCp) {
+    // Insert a wait 0 after the loop
+    builder.setInsertionPointAfter(forOp);
+    builder.create<ttg::AsyncWaitOp>(forOp.getLoc(), 0);
+    // Explicitly deallocate allocated tensors after the wait op
+    for (auto alloc : allocs)
+      builder.create<ttg::DeallocTensorOp>(forOp.getLoc(), alloc);
+  }
 
   // 4. Fill out the pipeline options.
   options.getScheduleFn =
@@ -640,23 +923,25 @@ bool mlir::triton::preProcessLoopAndGetSchedule(
   options.peelEpilogue = false;
   options.predicateFn = predicateOp;
   options.supportDynamicLoops = true;
-  unsigned numLoadsInStage = (numStages - 2) * loads.size();
+  // The wait leaves in flight the loads issued after the last one it waits
+  // for. Of the loads of an iteration, the shallowest ones are issued last,
+  // `minStages - 2` stages before the wait.
+  int minStages = numStages;
+  unsigned lastShallowLoad = 0;
+  for (unsigned i = 0; i < loads.size(); ++i) {
+    if (loads[i].numStages <= minStages) {
+      minStages = loads[i].numStages;
+      lastShallowLoad = i;
+    }
+  }
+  unsigned numLoadsInStage = (minStages - 2) * loads.size() +
+                             (loads.size() - 1 - lastShallowLoad);
   options.annotateFn =
       [numLoadsInStage](Operation *op,
                         mlir::triton::PipeliningOption::PipelinerPart part,
                         unsigned iteration) {
         return setWaitNum(op, part, iteration, numLoadsInStage);
       };
-
-  if (hasAsynCp) {
-    // Insert a wait 0 after the loop
-    OpBuilder builder(forOp);
-    builder.setInsertionPointAfter(forOp);
-    builder.create<ttg::AsyncWaitOp>(forOp.getLoc(), 0);
-    // Explicitly deallocate allocated tensors after the wait op
-    for (auto alloc : allocs)
-      builder.create<ttg::DeallocTensorOp>(forOp.getLoc(), alloc);
-  }
   return true;
 }
 
@@ -10,10 +10,45 @@
 namespace mlir {
 namespace triton {
 
+/// Attribute setting the number of pipeline stages of a `scf.for`, or of a
+/// `tt.load` within a pipelined loop. A load can ask for a deeper pipeline
+/// than its loop; a value below 2 disables pipelining.
+static constexpr char kNumStagesAttrName[] = "tt.num_stages";
+
+/// Return the number of stages requested by the `tt.num_stages` attribute of
+/// `op`, or `defaultNumStages` if it has none.
+int getNumStages(Operation *op, int defaultNumStages);
+
+/// Return an estimate of the shared memory a CTA can use on the given
+/// architecture, in bytes, for when the device's limit is not known.
+int64_t getSharedMemoryBudget(int computeCapability);
+
+/// Size in bytes of the shared memory buffers created to pipeline a loop, as
+/// a function of the loop's number of stages.
+struct PipelineBufferSize {
+  /// Bytes added by each stage of the loop.
+  int64_t perStage = 0;
+  /// Bytes that don't depend on the loop's stages, e.g. the buffers of loads
+  /// with their own `tt.num_stages`.
+  int64_t fixed = 0;
+
+  int64_t get(int numStages) const { return perStage * numStages + fixed; }
+};
+
+/// Return the size of the shared memory buffers created to pipeline the loop,
+/// `sharedMemoryBudget` being the shared memory a CTA can use. The loads to
+/// pipeline don't depend on the number of stages, so this is computed once
+/// for all the depths the loop may be pipelined with.
+PipelineBufferSize getPipelineBufferSize(scf::ForOp forOp,
+                                         int computeCapability,
+                                         int64_t sharedMemoryBudget);
+
 /// This fill out the pipelining options including schedule and annotations for
 /// wait ops. This also does pre-processing by converting some of the loads into
 /// async loads so that the IR is ready to be pipelined.
 bool preProcessLoopAndGetSchedule(scf::ForOp &forOp, int numStages,
+                                  int computeCapability,
+                                  int64_t sharedMemoryBudget,
                                   mlir::triton::PipeliningOption &options);
 
 /// This does post-processing on the pipelined loop to try to pipeline wgmma
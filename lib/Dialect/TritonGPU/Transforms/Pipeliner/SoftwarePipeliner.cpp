@@ -5,6 +5,7 @@
 #include "mlir/IR/TypeUtilities.h"
 #include "mlir/Interfaces/SideEffectInterfaces.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "triton/Analysis/Allocation.h"
 #include "triton/Analysis/AxisInfo.h"
 #include "triton/Analysis/Utility.h"
 #include "triton/Dialect/TritonGPU/IR/Dialect.h"
@@ -53,13 +54,15 @@ bool preCondition(scf::ForOp forOp) {
   return true;
 }
 
-static void pipelineLoop(scf::ForOp forOp, int numStages) {
+static void pipelineLoop(scf::ForOp forOp, int numStages,
+                         int computeCapability, int64_t sharedMemoryBudget) {
   mlir::triton::PipeliningOption options;
   if (!preCondition(forOp))
     return;
 
   bool foundSchedule = false;
-  foundSchedule = preProcessLoopAndGetSchedule(forOp, numStages, options);
+  foundSchedule = preProcessLoopAndGetSchedule(
+      forOp, numStages, computeCapability, sharedMemoryBudget, options);
 
   // TODO: add more pipelines strategy.
   if (!foundSchedule)
@@ -74,24 +77,98 @@ static void pipelineLoop(scf::ForOp forOp, int numStages) {
     mlir::triton::asyncLaunchDots(newForOp.value());
 }
 
+int64_t mlir::triton::getSharedMemoryBudget(int computeCapability) {
+  switch (computeCapability) {
+  case 70:
+  case 72:
+    return 96 * 1024;
+  case 75:
+    return 64 * 1024;
+  case 80:
+  case 87:
+    return 163 * 1024;
+  case 86:
+  case 89:
+    return 99 * 1024;
+  case 90:
+    return 227 * 1024;
+  default:
+    return 48 * 1024;
+  }
+}
+
+// The allocation cannot size conversions to dot operands of FMA dots until
+// they are decomposed.
+static bool canComputeAllocation(ModuleOp mod) {
+  return !mod.walk([](triton::gpu::ConvertLayoutOp cvt) {
+               auto ty = cvt.getType().cast<RankedTensorType>();
+               auto dotEnc = ty.getEncoding()
+                                 .dyn_cast<triton::gpu::DotOperandEncodingAttr>();
+               if (dotEnc &&
+                   dotEnc.getParent().isa<triton::gpu::BlockedEncodingAttr>())
+                 return WalkResult::interrupt();
+               return WalkResult::advance();
+             })
+              .wasInterrupted();
+}
+
 namespace {
 struct PipelinePass : public TritonGPUPipelineBase<PipelinePass> {
   PipelinePass() = default;
-  PipelinePass(int numStages, int numWarps, int numCTAs,
-               int computeCapability) {
+  PipelinePass(int numStages, int numWarps, int numCTAs, int computeCapability,
+               bool autoNumStages, int maxSharedMem) {
     this->numStages = numStages;
     this->numWarps = numWarps;
     this->numCTAs = numCTAs;
     this->computeCapability = computeCapability;
+    this->autoNumStages = autoNumStages;
+    this->maxSharedMem = maxSharedMem;
+  }
+
+  // Return the shared memory a CTA can use: the device's limit when the
+  // caller knows it, an estimate from the compute capability otherwise.
+  int64_t getSharedMemoryBudget() {
+    if (maxSharedMem > 0)
+      return maxSharedMem;
+    return mlir::triton::getSharedMemoryBudget(computeCapability);
+  }
+
+  // Return the deepest pipeline, up to `maxNumStages`, whose buffers fit in
+  // the budget next to the `used` bytes the module already allocates.
+  int getNumStagesFittingSharedMemory(scf::ForOp forOp, int maxNumStages,
+                                      int64_t used, int64_t budget) {
+    mlir::triton::PipelineBufferSize size =
+        mlir::triton::getPipelineBufferSize(forOp, computeCapability, budget);
+    for (int stages = maxNumStages; stages > 1; --stages) {
+      if (used + size.get(stages) <= budget)
+        return stages;
+    }
+    return 1;
   }
 
   void runOnOperation() override {
-    if (this->numStages <= 1)
-      return;
+    ModuleOp mod = getOperation();
+    int64_t budget = getSharedMemoryBudget();
+    // The allocation is computed once, before any loop is pipelined: buffers
+    // of different loops are not live at the same time.
+    std::optional<int64_t> used;
     SmallVector<scf::ForOp> loops;
-    getOperation()->walk([&](scf::ForOp forOp) { loops.push_back(forOp); });
+    mod->walk([&](scf::ForOp forOp) { loops.push_back(forOp); });
     for (scf::ForOp forOp : loops) {
-      pipelineLoop(forOp, numStages);
+      // A `tt.num_stages` attribute on the loop takes precedence over the
+      // pass options.
+      int loopNumStages = mlir::triton::getNumStages(forOp, numStages);
+      if (loopNumStages > 1 && autoNumStages &&
+          !forOp->hasAttr(mlir::triton::kNumStagesAttrName)) {
+        if (!used && canComputeAllocation(mod))
+          used = ModuleAllocation(mod).getSharedMemorySize();
+        if (used)
+          loopNumStages = getNumStagesFittingSharedMemory(forOp, loopNumStages,
+                                                          *used, budget);
+      }
+      if (loopNumStages <= 1)
+        continue;
+      pipelineLoop(forOp, loopNumStages, computeCapability, budget);
     }
   }
 };
@@ -99,7 +176,9 @@ struct PipelinePass : public TritonGPUPipelineBase<PipelinePass> {
 
 std::unique_ptr<Pass>
 mlir::triton::gpu::createPipelinePass(int numStages, int numWarps, int numCTAs,
-                                      int computeCapability) {
+                                      int computeCapability,
+                                      bool autoNumStages, int maxSharedMem) {
   return std::make_unique<PipelinePass>(numStages, numWarps, numCTAs,
-                                        computeCapability);
+                                        computeCapability, autoNumStages,
+                                        maxSharedMem);
 }
@@ -12,13 +12,19 @@
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 #include "mlir/Transforms/Passes.h"
 #include "mlir/Transforms/RegionUtils.h"
+#include "triton/Analysis/Allocation.h"
 #include "triton/Analysis/Utility.h"
 #include "triton/Dialect/TritonGPU/IR/Dialect.h"
 #include "triton/Dialect/TritonGPU/Transforms/Passes.h"
 #include "triton/Dialect/TritonGPU/Transforms/TritonGPUConversion.h"
 #include "triton/Dialect/TritonGPU/Transforms/Utility.h"
+#include "llvm/Support/Debug.h"
 #include <memory>
 
+#define DEBUG_TYPE "tritongpu-remove-layout-conversions"
+#define DBGS() (llvm::dbgs() << "[" DEBUG_TYPE "]: ")
+#define LDBG(X) LLVM_DEBUG(DBGS() << X << "\n")
+
 using namespace mlir;
 namespace {
 using triton::DotOp;
@@ -75,6 +81,93 @@ public:
   }
 };
 
+// Estimated cost of a set of layout conversions, following how
+// ConvertLayoutOp is lowered.
+struct ConvertCost {
+  // A barrier stalls every warp of the CTA, weigh it as 1KB of shared memory
+  // traffic.
+  static constexpr int64_t kBarrierCost = 1024;
+
+  int64_t numConverts = 0;
+  // Bytes written to and read back from shared memory.
+  int64_t smemBytes = 0;
+  // Largest scratch buffer needed by one of the conversions.
+  int64_t scratchBytes = 0;
+  int64_t numBarriers = 0;
+
+  int64_t total() const { return smemBytes + numBarriers * kBarrierCost; }
+
+  bool operator<(const ConvertCost &other) const {
+    return std::make_tuple(total(), scratchBytes, numConverts) <
+           std::make_tuple(other.total(), other.scratchBytes,
+                           other.numConverts);
+  }
+
+  ConvertCost &operator+=(const ConvertCost &other) {
+    numConverts += other.numConverts;
+    smemBytes += other.smemBytes;
+    scratchBytes = std::max(scratchBytes, other.scratchBytes);
+    numBarriers += other.numBarriers;
+    return *this;
+  }
+
+  void print(raw_ostream &os) const {
+    os << "total = " << total() << " (converts = " << numConverts
+       << ", smem bytes = " << smemBytes << ", scratch bytes = " << scratchBytes
+       << ", barriers = " << numBarriers << ")";
+  }
+};
+
+raw_ostream &operator<<(raw_ostream &os, const ConvertCost &cost) {
+  cost.print(os);
+  return os;
+}
+
+// The cost of converting a tensor of type `type` from `srcEncoding` to
+// `dstEncoding`. Conversions going through shared memory store and load the
+// whole tensor, one repetition of the scratch buffer at a time with a barrier
+// before and after each store.
+ConvertCost getConvertCost(RankedTensorType type, Attribute srcEncoding,
+                           Attribute dstEncoding) {
+  ConvertCost cost;
+  if (srcEncoding == dstEncoding)
+    return cost;
+  cost.numConverts = 1;
+  auto srcTy = RankedTensorType::get(type.getShape(), type.getElementType(),
+                                     srcEncoding);
+  auto dstTy = RankedTensorType::get(type.getShape(), type.getElementType(),
+                                     dstEncoding);
+  if (getCvtLayoutWithinWarp(srcTy, dstTy))
+    return cost;
+  int64_t elemBytes = type.getElementType().isa<triton::PointerType>()
+                          ? 8
+                          : std::max<int>(8, type.getElementTypeBitWidth()) / 8;
+  int64_t numElems = product<int64_t>(triton::gpu::getShapePerCTA(srcTy));
+  // Dot operands of blocked layouts have no tile shape, assume a single
+  // repetition.
+  auto isBlockedDotOperand = [](Attribute encoding) {
+    auto dotOperand = encoding.dyn_cast<DotOperandEncodingAttr>();
+    return dotOperand && !dotOperand.getParent().isa<NvidiaMmaEncodingAttr>();
+  };
+  if (isBlockedDotOperand(srcEncoding) || isBlockedDotOperand(dstEncoding)) {
+    cost.smemBytes = 2 * numElems * elemBytes;
+    cost.numBarriers = 2;
+    return cost;
+  }
+  auto repShape = triton::getRepShapeForCvtLayout(srcTy, dstTy);
+  if (repShape.empty())
+    return cost;
+  unsigned inVec = 0;
+  unsigned outVec = 0;
+  auto paddedRepShape =
+      triton::getScratchConfigForCvtLayout(srcTy, dstTy, inVec, outVec);
+  int64_t numRepElems = product<unsigned>(repShape);
+  cost.smemBytes = 2 * numElems * elemBytes;
+  cost.scratchBytes = product<unsigned>(paddedRepShape) * elemBytes;
+  cost.numBarriers = 2 * ceil<int64_t>(numElems, numRepElems);
+  return cost;
+}
+
 // The current algorithm works by analyzing the IR and doing a one-shot rewrite
 // based on the analysis. The algorithm is as follows.
 //
@@ -115,6 +208,13 @@ public:
                    SmallVector<Value> &changed, Operation *op);
   // Resolve cases where a value has multiple layouts associated to it.
   void resolveConflicts();
+  // Estimate the conversions needed around `value` if it gets `encoding`,
+  // given the layouts currently associated to its producers and users.
+  ConvertCost getCost(Value value, Attribute encoding);
+  // Return the encodings `value` may end up with.
+  SmallVector<Attribute> getCandidateEncodings(Value value);
+  // Return the encodings the owner of `use` may consume its operand in.
+  SmallVector<Attribute> getUseEncodings(OpOperand &use);
   // Rewrite the IR for the full module.
   void rewrite();
   // Rewrite the IR for a region.
@@ -307,25 +407,149 @@ void LayoutPropagation::propagateLayout() {
   }
 }
 
+static bool reduceToScalar(Operation *op) {
+  // For reductions returning a scalar we can change the src encoding without
+  // affecting the output.
+  return isa<triton::ReduceOp>(op) &&
+         !op->getResultTypes()[0].isa<RankedTensorType>();
+}
+
+// The encoding picked before costs were taken into account: prefer blocked
+// layouts for memory accesses and MMA layouts otherwise. Used to break ties.
+static Attribute getPreferredEncoding(Operation *op,
+                                      ArrayRef<Attribute> encodings) {
+  bool isLoadOrStore =
+      op && isa<triton::LoadOp, triton::StoreOp, triton::AtomicRMWOp,
+                triton::AtomicCASOp>(op);
+  for (Attribute e : encodings) {
+    if ((isLoadOrStore && e.isa<triton::gpu::BlockedEncodingAttr>()) ||
+        (!isLoadOrStore && e.isa<triton::gpu::NvidiaMmaEncodingAttr>()))
+      return e;
+  }
+  return encodings.front();
+}
+
+SmallVector<Attribute> LayoutPropagation::getCandidateEncodings(Value value) {
+  auto it = layouts.find(value);
+  if (it != layouts.end())
+    return SmallVector<Attribute>(it->second.encodings.begin(),
+                                  it->second.encodings.end());
+  return {value.getType().cast<RankedTensorType>().getEncoding()};
+}
+
+SmallVector<Attribute> LayoutPropagation::getUseEncodings(OpOperand &use) {
+  Operation *user = use.getOwner();
+  unsigned operandNumber = use.getOperandNumber();
+  // Control flow ops forward the operand to a value that is rewritten with
+  // its own encoding.
+  Value tied;
+  if (auto forOp = dyn_cast<scf::ForOp>(user)) {
+    if (operandNumber >= forOp.getNumControlOperands())
+      tied = forOp.getTiedLoopRegionIterArg(&use);
+  } else if (auto whileOp = dyn_cast<scf::WhileOp>(user)) {
+    tied = whileOp.getBeforeArguments()[operandNumber];
+  } else if (auto yieldOp = dyn_cast<scf::YieldOp>(user)) {
+    Operation *parent = yieldOp->getParentOp();
+    if (isa<scf::ForOp, scf::IfOp>(parent))
+      tied = parent->getResult(operandNumber);
+    else if (auto whileOp = dyn_cast<scf::WhileOp>(parent))
+      tied = whileOp.getBeforeArguments()[operandNumber];
+  } else if (auto conditionOp = dyn_cast<scf::ConditionOp>(user)) {
+    if (operandNumber > 0)
+      tied = conditionOp->getParentOfType<scf::WhileOp>()
+                 .getAfterArguments()[operandNumber - 1];
+  }
+  if (tied)
+    return getCandidateEncodings(tied);
+  if (reduceToScalar(user))
+    return {};
+  // Ops rewritten by the propagation consume the operand in the encoding
+  // matching their result, others keep the original one.
+  if (user->getNumResults() > 0 && layouts.count(user->getResult(0)) &&
+      !isLayoutAnchor(user)) {
+    SmallVector<Attribute> encodings;
+    for (Attribute encoding : layouts[user->getResult(0)].encodings)
+      if (auto srcEncoding = inferSrcEncoding(user, encoding))
+        encodings.push_back(*srcEncoding);
+    return encodings;
+  }
+  return {use.get().getType().cast<RankedTensorType>().getEncoding()};
+}
+
+// The cheapest conversion of a tensor of type `type` between any of `from`
+// and any of `to`.
+static ConvertCost getMinConvertCost(RankedTensorType type,
+                                     ArrayRef<Attribute> from,
+                                     ArrayRef<Attribute> to) {
+  std::optional<ConvertCost> best;
+  for (Attribute src : from) {
+    for (Attribute dst : to) {
+      ConvertCost cost = getConvertCost(type, src, dst);
+      if (!best || cost < *best)
+        best = cost;
+    }
+  }
+  return best.value_or(ConvertCost());
+}
+
+ConvertCost LayoutPropagation::getCost(Value value, Attribute encoding) {
+  ConvertCost cost;
+  auto type = value.getType().cast<RankedTensorType>();
+  // Conversions of the operands. Values defined by control flow ops are
+  // accounted for at the yields and initial values feeding them.
+  Operation *def = value.getDefiningOp();
+  if (auto convertOp = dyn_cast_or_null<triton::gpu::ConvertLayoutOp>(def)) {
+    cost += getMinConvertCost(
+        convertOp.getOperand().getType().cast<RankedTensorType>(),
+        getCandidateEncodings(convertOp.getOperand()), {encoding});
+  } else if (def && !isa<scf::ForOp, scf::WhileOp, scf::IfOp>(def) &&
+             !canFoldIntoConversion(def, encoding)) {
+    std::optional<Attribute> srcEncoding = inferSrcEncoding(def, encoding);
+    for (Value operand : def->getOperands()) {
+      auto operandType = operand.getType().dyn_cast<RankedTensorType>();
+      if (!operandType || !srcEncoding)
+        continue;
+      cost += getMinConvertCost(operandType, getCandidateEncodings(operand),
+                                {*srcEncoding});
+    }
+  }
+  // Conversions of the value for its users.
+  for (OpOperand &use : value.getUses())
+    cost += getMinConvertCost(type, {encoding}, getUseEncodings(use));
+  return cost;
+}
+
 void LayoutPropagation::resolveConflicts() {
   for (auto &it : layouts) {
     Operation *op = it.first.getDefiningOp();
     LayoutInfo &info = it.second;
     if (info.encodings.size() <= 1)
       continue;
-    // Hacky resolve, prefer block encoding.
-    // TODO: add a proper heuristic.
-    int maxSizePerThread = 1;
-    Attribute encoding = *info.encodings.begin();
-    bool isLoadOrStore =
-        op && isa<triton::LoadOp, triton::StoreOp, triton::AtomicRMWOp,
-                  triton::AtomicCASOp>(op);
-    for (Attribute e : info.encodings) {
-      if ((isLoadOrStore && e.isa<triton::gpu::BlockedEncodingAttr>()) ||
-          (!isLoadOrStore && e.isa<triton::gpu::NvidiaMmaEncodingAttr>())) {
-        encoding = e;
-        break;
+    SmallVector<Attribute> encodings(info.encodings.begin(),
+                                     info.encodings.end());
+    Attribute encoding = getPreferredEncoding(op, encodings);
+    // Anchors keep their own layout.
+    if (!op || !isLayoutAnchor(op)) {
+      LLVM_DEBUG({
+        DBGS() << "resolving conflict for ";
+        OpPrintingFlags flags;
+        flags.skipRegions();
+        it.first.print(llvm::dbgs(), flags);
+        llvm::dbgs() << "\n";
+      });
+      ConvertCost bestCost = getCost(it.first, encoding);
+      LDBG("  " << encoding << ": " << bestCost << " (preferred)");
+      for (Attribute e : encodings) {
+        if (e == encoding)
+          continue;
+        ConvertCost cost = getCost(it.first, e);
+        LDBG("  " << e << ": " << cost);
+        if (cost < bestCost) {
+          bestCost = cost;
+          encoding = e;
+        }
       }
+      LDBG("  picked " << encoding);
     }
     info.encodings.clear();
     info.encodings.insert(encoding);
@@ -349,13 +573,6 @@ void LayoutPropagation::dump() {
 
 void LayoutPropagation::rewrite() { rewriteRegion(funcOp->getRegion(0)); }
 
-static bool reduceToScalar(Operation *op) {
-  // For reductions returning a scalar we can change the src encoding without
-  // affecting the output.
-  return isa<triton::ReduceOp>(op) &&
-         !op->getResultTypes()[0].isa<RankedTensorType>();
-}
-
 void LayoutPropagation::rewriteRegion(Region &region) {
   SmallVector<Region *> queue = {&region};
   while (!queue.empty()) {
@@ -0,0 +1,103 @@
+#include "mlir/Pass/Pass.h"
+#include "triton/Analysis/BankConflicts.h"
+#include "triton/Dialect/TritonGPU/IR/Dialect.h"
+#include "triton/Dialect/TritonGPU/Transforms/Passes.h"
+
+#define GEN_PASS_CLASSES
+#include "triton/Dialect/TritonGPU/Transforms/Passes.h.inc"
+
+using namespace mlir;
+namespace tt = mlir::triton;
+namespace ttg = mlir::triton::gpu;
+
+namespace {
+
+void reportBankConflicts(Operation *op, StringRef access, unsigned degree) {
+  if (degree > 1)
+    op->emitRemark() << "shared memory " << access << " has " << degree
+                     << "-way bank conflicts";
+}
+
+// Conversions between a blocked layout and shared memory access
+// min(vec, sizePerThread) elements at a time.
+void reportSharedAccess(Operation *op, StringRef access,
+                        RankedTensorType distributedTy,
+                        ttg::SharedEncodingAttr sharedEnc, unsigned vec) {
+  if (std::optional<unsigned> degree =
+          getBlockedAccessBankConflicts(distributedTy, sharedEnc, vec))
+    reportBankConflicts(op, access, *degree);
+}
+
+void reportConvertLayout(ttg::ConvertLayoutOp cvt) {
+  auto srcTy = cvt.getSrc().getType().cast<RankedTensorType>();
+  auto dstTy = cvt.getType().cast<RankedTensorType>();
+  auto srcShared = srcTy.getEncoding().dyn_cast<ttg::SharedEncodingAttr>();
+  auto dstShared = dstTy.getEncoding().dyn_cast<ttg::SharedEncodingAttr>();
+  if (dstShared) {
+    reportSharedAccess(cvt, "store", srcTy, dstShared, dstShared.getVec());
+    return;
+  }
+  if (srcShared) {
+    auto dotEnc = dstTy.getEncoding().dyn_cast<ttg::DotOperandEncodingAttr>();
+    if (!dotEnc) {
+      reportSharedAccess(cvt, "load", dstTy, srcShared, srcShared.getVec());
+      return;
+    }
+    // Ampere dot operands are loaded with ldmatrix, which reads 16 bytes of 8
+    // rows at a time. It is not used for transposed operands of more than 16
+    // bits.
+    auto mmaEnc = dotEnc.getParent().dyn_cast<ttg::NvidiaMmaEncodingAttr>();
+    if (!mmaEnc || !mmaEnc.isAmpere() || srcTy.getRank() != 2 ||
+        srcShared.getHasLeadingOffset())
+      return;
+    unsigned bitWidth = srcTy.getElementTypeBitWidth();
+    unsigned kOrder = dotEnc.getOpIdx() == 0 ? 1 : 0;
+    if (bitWidth != 16 && srcShared.getOrder()[0] != kOrder)
+      return;
+    reportBankConflicts(cvt, "load",
+                        getLdmatrixBankConflicts(
+                            srcShared, ttg::getShapePerCTA(srcTy), bitWidth));
+    return;
+  }
+  if (auto degrees = getConvertLayoutBankConflicts(cvt)) {
+    reportBankConflicts(cvt, "store", degrees->first);
+    reportBankConflicts(cvt, "load", degrees->second);
+  }
+}
+
+// cp.async copies up to 16 bytes per thread, assuming the pointers are
+// contiguous.
+void reportInsertSliceAsync(ttg::InsertSliceAsyncOp insert) {
+  auto srcTy = insert.getSrc().getType().cast<RankedTensorType>();
+  auto dstTy = insert.getType().cast<RankedTensorType>();
+  auto sharedEnc = dstTy.getEncoding().dyn_cast<ttg::SharedEncodingAttr>();
+  if (!sharedEnc)
+    return;
+  auto elemTy = srcTy.getElementType().cast<tt::PointerType>().getPointeeType();
+  auto dataTy =
+      RankedTensorType::get(srcTy.getShape(), elemTy, srcTy.getEncoding());
+  unsigned vec = 128 / std::max<unsigned>(elemTy.getIntOrFloatBitWidth(), 8);
+  if (sharedEnc.getVec() > 1)
+    vec = std::min(vec, sharedEnc.getVec());
+  reportSharedAccess(insert, "store", dataTy, sharedEnc, vec);
+}
+
+class TritonGPUReportBankConflictsPass
+    : public TritonGPUReportBankConflictsBase<
+          TritonGPUReportBankConflictsPass> {
+public:
+  void runOnOperation() override {
+    getOperation()->walk([](Operation *op) {
+      if (auto cvt = dyn_cast<ttg::ConvertLayoutOp>(op))
+        reportConvertLayout(cvt);
+      else if (auto insert = dyn_cast<ttg::InsertSliceAsyncOp>(op))
+        reportInsertSliceAsync(insert);
+    });
+  }
+};
+
+} // namespace
+
+std::unique_ptr<Pass> mlir::triton::gpu::createReportBankConflictsPass() {
+  return std::make_unique<TritonGPUReportBankConflictsPass>();
+}
@@ -319,7 +319,20 @@ inferSrcEncoding(triton::ExperimentalInterleaveOp op, Attribute encoding) {
       enc.getOrder(), enc.getCTALayout());
 }
 
+// Scans keep the layout of their operands, as long as the lowering supports it.
+static std::optional<Attribute> inferScanEncoding(triton::ScanOp op,
+                                                  Attribute encoding) {
+  auto type = op.getOperand(0).getType().cast<RankedTensorType>();
+  auto newType = RankedTensorType::get(type.getShape(), type.getElementType(),
+                                       encoding);
+  if (!getScanBlockedView(newType, op.getAxis()))
+    return std::nullopt;
+  return encoding;
+}
+
 std::optional<Attribute> inferSrcEncoding(Operation *op, Attribute encoding) {
+  if (auto scanOp = dyn_cast<triton::ScanOp>(op))
+    return inferScanEncoding(scanOp, encoding);
   if (auto reduceOp = dyn_cast<triton::ReduceOp>(op))
     return inferSrcEncoding(reduceOp, encoding);
   if (auto expand = dyn_cast<triton::ExpandDimsOp>(op))
@@ -332,6 +345,8 @@ std::optional<Attribute> inferSrcEncoding(Operation *op, Attribute encoding) {
 }
 
 std::optional<Attribute> inferDstEncoding(Operation *op, Attribute encoding) {
+  if (auto scanOp = dyn_cast<triton::ScanOp>(op))
+    return inferScanEncoding(scanOp, encoding);
   if (auto reduceOp = dyn_cast<triton::ReduceOp>(op))
     return inferDstEncoding(reduceOp, encoding);
   if (auto expand = dyn_cast<triton::ExpandDimsOp>(op))
@@ -1,44 +1,443 @@
-﻿#include <pybind11/numpy.h>
+﻿#include "triton/Dialect/Triton/IR/Dialect.h"
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
 namespace py = pybind11;
+using mlir::triton::RMWOp;
+
+namespace {
+
+using ContiguousArray = py::array_t<uint64_t, py::array::c_style |
+                                                  py::array::forcecast>;
+using MaskArray = py::array_t<bool, py::array::c_style | py::array::forcecast>;
+
+// Runs at least this long are copied with a single memcpy.
+constexpr size_t kMinBulkCopy = 4;
+
+// Returns the number of elements starting at `i` that are unmasked and whose
+// pointers advance by exactly `itemsize` bytes, i.e. that can be copied from
+// or to a single contiguous chunk of memory.
+size_t getContiguousRun(const uint64_t *ptrs, const bool *masks, size_t i,
+                        size_t numel, size_t itemsize) {
+  if (!masks[i])
+    return 0;
+  size_t j = i + 1;
+  while (j < numel && masks[j] && ptrs[j] == ptrs[j - 1] + itemsize)
+    ++j;
+  return j - i;
+}
+
+// Returns the end of the elements starting at `i` that are not part of a
+// contiguous run long enough to be copied in bulk, and sets `run` to the
+// length of the run that follows them.
+size_t getScatteredEnd(const uint64_t *ptrs, const bool *masks, size_t i,
+                       size_t numel, size_t itemsize, size_t &run) {
+  run = 0;
+  while (i < numel) {
+    run = getContiguousRun(ptrs, masks, i, numel, itemsize);
+    if (run >= kMinBulkCopy)
+      break;
+    i += std::max<size_t>(run, 1);
+    run = 0;
+  }
+  return i;
+}
+
+template <typename T>
+void gather(const uint64_t *ptrs, const bool *masks, const T *others, T *ret,
+            size_t numel) {
+  size_t i = 0;
+  while (i < numel) {
+    size_t run;
+    size_t end = getScatteredEnd(ptrs, masks, i, numel, sizeof(T), run);
+    // Select the source address instead of branching on the mask, so the
+    // loop has a single load per element. The pointers need not be aligned
+    // for T, so the element is copied rather than dereferenced.
+    for (; i < end; ++i) {
+      const void *src =
+          masks[i] ? reinterpret_cast<const void *>(ptrs[i]) : others + i;
+      std::memcpy(ret + i, src, sizeof(T));
+    }
+    if (run > 0) {
+      std::memcpy(ret + i, reinterpret_cast<const void *>(ptrs[i]),
+                  run * sizeof(T));
+      i += run;
+    }
+  }
+}
+
+template <typename T>
+void scatter(const uint64_t *ptrs, const bool *masks, const T *values,
+             size_t numel) {
+  size_t i = 0;
+  while (i < numel) {
+    size_t run;
+    size_t end = getScatteredEnd(ptrs, masks, i, numel, sizeof(T), run);
+    for (; i < end; ++i) {
+      if (masks[i])
+        std::memcpy(reinterpret_cast<void *>(ptrs[i]), values + i, sizeof(T));
+    }
+    if (run > 0) {
+      std::memcpy(reinterpret_cast<void *>(ptrs[i]), values + i,
+                  run * sizeof(T));
+      i += run;
+    }
+  }
+}
+
+// Fallback for element sizes without a matching integer type.
+void gatherBytes(const uint64_t *ptrs, const bool *masks, const char *others,
+                 char *ret, size_t numel, size_t itemsize) {
+  for (size_t i = 0; i < numel; ++i) {
+    const void *src = masks[i] ? reinterpret_cast<const void *>(ptrs[i])
+                               : others + i * itemsize;
+    std::memcpy(ret + i * itemsize, src, itemsize);
+  }
+}
+
+void scatterBytes(const uint64_t *ptrs, const bool *masks, const char *values,
+                  size_t numel, size_t itemsize) {
+  for (size_t i = 0; i < numel; ++i) {
+    if (masks[i])
+      std::memcpy(reinterpret_cast<void *>(ptrs[i]), values + i * itemsize,
+                  itemsize);
+  }
+}
+
+// Calls `fn` with a null pointer to the unsigned integer type that is
+// `itemsize` bytes wide, or returns false if there is none.
+template <typename FnT> bool dispatchItemSize(size_t itemsize, FnT &&fn) {
+  switch (itemsize) {
+  case 1:
+    fn(static_cast<uint8_t *>(nullptr));
+    return true;
+  case 2:
+    fn(static_cast<uint16_t *>(nullptr));
+    return true;
+  case 4:
+    fn(static_cast<uint32_t *>(nullptr));
+    return true;
+  case 8:
+    fn(static_cast<uint64_t *>(nullptr));
+    return true;
+  default:
+    return false;
+  }
+}
+
+// IEEE half precision value. Arithmetic and comparisons are done in single
+// precision, which is exact enough that rounding the result back to half
+// precision gives the correctly rounded half precision result.
+struct Half {
+  uint16_t bits;
+
+  Half() = default;
+  Half(float value) : bits(fromFloat(value)) {}
+  operator float() const { return toFloat(bits); }
+
+  static float toFloat(uint16_t h) {
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t bits;
+    if (exp == 0x1f) {
+      bits = sign | 0x7f800000 | (mant << 13);
+    } else if (exp != 0) {
+      bits = sign | ((exp + 112) << 23) | (mant << 13);
+    } else if (mant == 0) {
+      bits = sign;
+    } else {
+      // Subnormal: normalize the mantissa.
+      exp = 113;
+      while (!(mant & 0x400)) {
+        mant <<= 1;
+        --exp;
+      }
+      bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  // Rounds to nearest, ties to even.
+  static uint16_t fromFloat(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t abs = bits & 0x7fffffff;
+    if (abs > 0x7f800000)
+      return sign | 0x7e00;
+    // 65520 is halfway between the largest half and the next power of two.
+    if (abs >= 0x477ff000)
+      return sign | 0x7c00;
+    if (abs < 0x38800000) {
+      // Below the smallest normal half, the encoding is the value in units of
+      // 2^-24.
+      float absValue;
+      std::memcpy(&absValue, &abs, sizeof(absValue));
+      return sign | static_cast<uint16_t>(std::nearbyint(absValue * 0x1p24f));
+    }
+    uint32_t mant = abs & 0x7fffff;
+    uint32_t h = (((abs >> 23) - 112) << 10) | (mant >> 13);
+    uint32_t rem = mant & 0x1fff;
+    if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+      ++h;
+    return sign | h;
+  }
+};
+static_assert(sizeof(Half) == 2 && std::is_trivially_copyable_v<Half>);
+
+// Calls `fn` with a null pointer to the C++ type matching a numpy integer or
+// floating point dtype, or returns false if there is none.
+template <typename FnT> bool dispatchDType(py::dtype dtype, FnT &&fn) {
+  switch (dtype.kind()) {
+  case 'i':
+    switch (dtype.itemsize()) {
+    case 1:
+      fn(static_cast<int8_t *>(nullptr));
+      return true;
+    case 2:
+      fn(static_cast<int16_t *>(nullptr));
+      return true;
+    case 4:
+      fn(static_cast<int32_t *>(nullptr));
+      return true;
+    case 8:
+      fn(static_cast<int64_t *>(nullptr));
+      return true;
+    }
+    return false;
+  case 'u':
+    return dispatchItemSize(dtype.itemsize(), std::forward<FnT>(fn));
+  case 'f':
+    switch (dtype.itemsize()) {
+    case 2:
+      fn(static_cast<Half *>(nullptr));
+      return true;
+    case 4:
+      fn(static_cast<float *>(nullptr));
+      return true;
+    case 8:
+      fn(static_cast<double *>(nullptr));
+      return true;
+    }
+    return false;
+  default:
+    return false;
+  }
+}
+
+// Atomics go through the GCC builtins, whose generic forms also accept
+// floating point types. The interpreter runs programs on host threads, so
+// memory semantics and scope are always acquire-release and system-wide.
+constexpr int kAtomicOrder = __ATOMIC_ACQ_REL;
+
+// Atomically replaces `*ptr` with `fn(*ptr)` and returns the previous value.
+template <typename T, typename FnT> T atomicUpdate(T *ptr, FnT &&fn) {
+  T old;
+  __atomic_load(ptr, &old, __ATOMIC_RELAXED);
+  T desired;
+  do {
+    desired = fn(old);
+  } while (!__atomic_compare_exchange(ptr, &old, &desired, /*weak=*/true,
+                                      kAtomicOrder, __ATOMIC_RELAXED));
+  return old;
+}
+
+// Applies `op` to `*ptr` and `val` and returns the previous value. Integer
+// MAX/MIN compare as signed and UMAX/UMIN as unsigned, whatever the
+// signedness of `T`.
+template <typename T> T atomicRMW(RMWOp op, T *ptr, T val) {
+  if constexpr (std::is_integral_v<T>) {
+    using SignedT = std::make_signed_t<T>;
+    using UnsignedT = std::make_unsigned_t<T>;
+    switch (op) {
+    case RMWOp::ADD:
+      return __atomic_fetch_add(ptr, val, kAtomicOrder);
+    case RMWOp::AND:
+      return __atomic_fetch_and(ptr, val, kAtomicOrder);
+    case RMWOp::OR:
+      return __atomic_fetch_or(ptr, val, kAtomicOrder);
+    case RMWOp::XOR:
+      return __atomic_fetch_xor(ptr, val, kAtomicOrder);
+    case RMWOp::XCHG:
+      return __atomic_exchange_n(ptr, val, kAtomicOrder);
+    case RMWOp::MAX:
+      return atomicUpdate(ptr, [&](T old) {
+        return static_cast<SignedT>(old) < static_cast<SignedT>(val) ? val
+                                                                     : old;
+      });
+    case RMWOp::MIN:
+      return atomicUpdate(ptr, [&](T old) {
+        return static_cast<SignedT>(val) < static_cast<SignedT>(old) ? val
+                                                                     : old;
+      });
+    case RMWOp::UMAX:
+      return atomicUpdate(ptr, [&](T old) {
+        return static_cast<UnsignedT>(old) < static_cast<UnsignedT>(val) ? val
+                                                                         : old;
+      });
+    case RMWOp::UMIN:
+      return atomicUpdate(ptr, [&](T old) {
+        return static_cast<UnsignedT>(val) < static_cast<UnsignedT>(old) ? val
+                                                                         : old;
+      });
+    default:
+      break;
+    }
+  } else {
+    switch (op) {
+    case RMWOp::FADD:
+      return atomicUpdate(ptr, [&](T old) { return old + val; });
+    case RMWOp::XCHG: {
+      T old;
+      __atomic_exchange(ptr, &val, &old, kAtomicOrder);
+      return old;
+    }
+    case RMWOp::MAX:
+      return atomicUpdate(ptr, [&](T old) { return std::max(old, val); });
+    case RMWOp::MIN:
+      return atomicUpdate(ptr, [&](T old) { return std::min(old, val); });
+    default:
+      break;
+    }
+  }
+  throw py::value_error("atomic_rmw: unsupported operation for this type");
+}
+
+} // namespace
 
 void init_triton_interpreter(py::module &&m) {
   using ret = py::return_value_policy;
 
   m.def("load",
-        [](py::array_t<uint64_t> ptrs, py::array_t<bool> masks, py::array other,
+        [](ContiguousArray ptrs, MaskArray masks, py::array other,
            py::dtype ret_dtype) -> py::array {
-          int numel = ptrs.size();
+          size_t numel = ptrs.size();
           auto shape =
               std::vector<ptrdiff_t>(ptrs.shape(), ptrs.shape() + ptrs.ndim());
-          py::array ret(ret_dtype, py::array::ShapeContainer{numel});
-          py::array_t<uint64_t> reshaped_ptrs = ptrs.reshape({numel});
-          py::array_t<bool> reshaped_masks = masks.reshape({numel});
-          py::array reshaped_others = other.reshape({numel});
-          for (size_t i = 0; i < ptrs.size(); ++i) {
-            if (reshaped_masks.at(i))
-              memcpy(ret.mutable_data(i),
-                     reinterpret_cast<void *>(reshaped_ptrs.at(i)),
-                     ret_dtype.itemsize());
-            else
-              memcpy(ret.mutable_data(i), reshaped_others.data(i),
-                     ret_dtype.itemsize());
+          py::array ret(ret_dtype, shape);
+          py::array others = py::array::ensure(other, py::array::c_style);
+          if (!others.dtype().equal(ret_dtype))
+            others = others.attr("astype")(ret_dtype);
+          if (masks.size() != numel || others.size() != numel)
+            throw py::value_error("load: pointers, masks and others must have "
+                                  "the same number of elements");
+          size_t itemsize = ret_dtype.itemsize();
+          const uint64_t *ptrsData = ptrs.data();
+          const bool *masksData = masks.data();
+          const char *othersData = static_cast<const char *>(others.data());
+          char *retData = static_cast<char *>(ret.mutable_data());
+          {
+            py::gil_scoped_release release;
+            bool dispatched = dispatchItemSize(itemsize, [&](auto *typeTag) {
+              using T = std::remove_pointer_t<decltype(typeTag)>;
+              gather(ptrsData, masksData,
+                     reinterpret_cast<const T *>(othersData),
+                     reinterpret_cast<T *>(retData), numel);
+            });
+            if (!dispatched)
+              gatherBytes(ptrsData, masksData, othersData, retData, numel,
+                          itemsize);
           }
-          return ret.reshape(shape);
+          return ret;
         });
 
-  m.def("store", [](py::array_t<uint64_t> ptrs, py::array values,
-                    py::array_t<bool> mask) {
-    int numel = ptrs.size();
-    py::array_t<uint64_t> reshaped_ptrs = ptrs.reshape({numel});
-    py::array_t<int8_t> reshaped_masks = mask.reshape({numel});
-    py::array reshaped_values = values.reshape({numel});
-    for (size_t i = 0; i < ptrs.size(); ++i) {
-      if (reshaped_masks.at(i)) {
-        memcpy(reinterpret_cast<void *>(reshaped_ptrs.mutable_at(i)),
-               reshaped_values.data(i), values.dtype().itemsize());
-      }
-    }
+  m.def("store", [](ContiguousArray ptrs, py::array values, MaskArray mask) {
+    size_t numel = ptrs.size();
+    py::array contiguousValues = py::array::ensure(values, py::array::c_style);
+    if (mask.size() != numel || contiguousValues.size() != numel)
+      throw py::value_error("store: pointers, values and masks must have the "
+                            "same number of elements");
+    size_t itemsize = contiguousValues.dtype().itemsize();
+    const uint64_t *ptrsData = ptrs.data();
+    const bool *masksData = mask.data();
+    const char *valuesData = static_cast<const char *>(contiguousValues.data());
+    py::gil_scoped_release release;
+    bool dispatched = dispatchItemSize(itemsize, [&](auto *typeTag) {
+      using T = std::remove_pointer_t<decltype(typeTag)>;
+      scatter(ptrsData, masksData, reinterpret_cast<const T *>(valuesData),
+              numel);
+    });
+    if (!dispatched)
+      scatterBytes(ptrsData, masksData, valuesData, numel, itemsize);
   });
+  m.def("atomic_rmw",
+        [](RMWOp op, ContiguousArray ptrs, py::array values,
+           MaskArray masks) -> py::array {
+          size_t numel = ptrs.size();
+          py::array vals = py::array::ensure(values, py::array::c_style);
+          if (masks.size() != numel || vals.size() != numel)
+            throw py::value_error("atomic_rmw: pointers, values and masks "
+                                  "must have the same number of elements");
+          auto shape =
+              std::vector<ptrdiff_t>(ptrs.shape(), ptrs.shape() + ptrs.ndim());
+          py::array ret(vals.dtype(), shape);
+          const uint64_t *ptrsData = ptrs.data();
+          const bool *masksData = masks.data();
+          const void *valsData = vals.data();
+          void *retData = ret.mutable_data();
+          bool dispatched = dispatchDType(vals.dtype(), [&](auto *typeTag) {
+            using T = std::remove_pointer_t<decltype(typeTag)>;
+            const T *valsT = static_cast<const T *>(valsData);
+            T *retT = static_cast<T *>(retData);
+            py::gil_scoped_release release;
+            for (size_t i = 0; i < numel; ++i)
+              retT[i] = masksData[i]
+                            ? atomicRMW(op, reinterpret_cast<T *>(ptrsData[i]),
+                                        valsT[i])
+                            : T();
+          });
+          if (!dispatched)
+            throw py::type_error("atomic_rmw: unsupported element type " +
+                                 std::string(py::str(vals.dtype())));
+          return ret;
+        });
+
+  m.def("atomic_cas",
+        [](ContiguousArray ptrs, py::array cmp, py::array val) -> py::array {
+          size_t numel = ptrs.size();
+          py::array vals = py::array::ensure(val, py::array::c_style);
+          py::array cmps = py::array::ensure(cmp, py::array::c_style);
+          if (!cmps.dtype().equal(vals.dtype()))
+            cmps = cmps.attr("astype")(vals.dtype());
+          if (cmps.size() != numel || vals.size() != numel)
+            throw py::value_error("atomic_cas: pointers, comparands and values "
+                                  "must have the same number of elements");
+          auto shape =
+              std::vector<ptrdiff_t>(ptrs.shape(), ptrs.shape() + ptrs.ndim());
+          py::array ret(vals.dtype(), shape);
+          const uint64_t *ptrsData = ptrs.data();
+          const void *cmpsData = cmps.data();
+          const void *valsData = vals.data();
+          void *retData = ret.mutable_data();
+          // Compare-and-swap compares bit patterns, so only the width of the
+          // element matters.
+          bool dispatched =
+              dispatchItemSize(vals.dtype().itemsize(), [&](auto *typeTag) {
+                using T = std::remove_pointer_t<decltype(typeTag)>;
+                const T *cmpsT = static_cast<const T *>(cmpsData);
+                const T *valsT = static_cast<const T *>(valsData);
+                T *retT = static_cast<T *>(retData);
+                py::gil_scoped_release release;
+                for (size_t i = 0; i < numel; ++i) {
+                  T expected = cmpsT[i];
+                  __atomic_compare_exchange_n(
+                      reinterpret_cast<T *>(ptrsData[i]), &expected, valsT[i],
+                      /*weak=*/false, kAtomicOrder, __ATOMIC_ACQUIRE);
+                  retT[i] = expected;
+                }
+              });
+          if (!dispatched)
+            throw py::type_error("atomic_cas: unsupported element type " +
+                                 std::string(py::str(vals.dtype())));
+          return ret;
+        });
 }
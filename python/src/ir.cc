@@ -234,9 +234,15 @@ void init_triton_ir(py::module &&m) {
                int id = arg.getArgNumber();
                std::string attrName = name + "_arg" + std::to_string(id);
                mlir::Block *owner = arg.getOwner();
-               if (owner->isEntryBlock() &&
-                   !mlir::isa<mlir::triton::FuncOp>(owner->getParentOp())) {
+               auto funcOp =
+                   mlir::dyn_cast<mlir::triton::FuncOp>(owner->getParentOp());
+               if (owner->isEntryBlock() && !funcOp) {
                  owner->getParentOp()->setAttr(attrName, attr);
+               } else if (owner->isEntryBlock() &&
+                          attr.isa<mlir::IntegerAttr>()) {
+                 // Function arguments only take scalar hints, such as the
+                 // bounds of tl.assume_range.
+                 funcOp.setArgAttr(id, name, attr);
                }
              }
            })
@@ -551,6 +557,10 @@ void init_triton_ir(py::module &&m) {
            [](TritonOpBuilder &self, int32_t value) {
              return self.getBuilder().getI32IntegerAttr(value);
            })
+      .def("get_int64_attr",
+           [](TritonOpBuilder &self, int64_t value) {
+             return self.getBuilder().getI64IntegerAttr(value);
+           })
       // Use arith.ConstantOp to create constants
       // Constants
       .def("get_int1",
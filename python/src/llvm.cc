@@ -1,7 +1,11 @@
 ﻿#include "mlir/IR/BuiltinOps.h" // mlir::ModuleOp
 #include "mlir/Target/LLVMIR/LLVMTranslationInterface.h"
 #include "mlir/Target/LLVMIR/ModuleTranslation.h"
+#include "llvm/ADT/ScopeExit.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
@@ -17,6 +21,8 @@
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/IPO/AlwaysInliner.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
+#include <mutex>
+#include <shared_mutex>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
@@ -31,36 +37,25 @@ struct BreakStructPhiNodesPass : PassInfoMixin<BreakStructPhiNodesPass> {
 
 using namespace llvm;
 
-std::string translateLLVMIRToASM(llvm::Module &module,
-                                 const std::string &triple,
-                                 const std::string &proc,
-                                 const std::string &features,
-                                 const std::vector<std::string> &flags,
-                                 bool enable_fp_fusion, bool isObject) {
-  using namespace mlir;
-  // options
+namespace {
+
+void setFlags(const std::vector<std::string> &flags) {
   auto options = llvm::cl::getRegisteredOptions();
   for (std::string flag : flags) {
     auto *shortPtr = static_cast<llvm::cl::opt<bool> *>(options[flag]);
     assert(shortPtr);
     shortPtr->setValue(true);
   }
-  // inline everything
-  for (llvm::Function &f : module.functions())
-    if (!f.hasFnAttribute(llvm::Attribute::NoInline))
-      f.addFnAttr(llvm::Attribute::AlwaysInline);
-  // verify and store llvm
-  llvm::legacy::PassManager pm;
-  pm.add(llvm::createAlwaysInlinerLegacyPass());
-  pm.add(llvm::createVerifierPass());
-  pm.run(module);
-  // module->print(llvm::outs(), nullptr);
+}
 
-  // create machine
-  module.setTargetTriple(triple);
+std::unique_ptr<llvm::TargetMachine>
+createTargetMachine(llvm::Module &module, const std::string &proc,
+                    const std::string &features, bool enable_fp_fusion) {
   std::string error;
   auto target =
       llvm::TargetRegistry::lookupTarget(module.getTargetTriple(), error);
+  if (!target)
+    llvm::report_fatal_error("failed to find target: " + error);
   llvm::TargetOptions opt;
   if (enable_fp_fusion)
     opt.AllowFPOpFusion = llvm::FPOpFusion::Fast;
@@ -68,28 +63,130 @@ std::string translateLLVMIRToASM(llvm::Module &module,
   opt.NoInfsFPMath = false;
   opt.NoNaNsFPMath = true;
   opt.TrapUnreachable = true;
-  std::unique_ptr<llvm::TargetMachine> machine{target->createTargetMachine(
+  return std::unique_ptr<llvm::TargetMachine>{target->createTargetMachine(
       module.getTargetTriple(), proc, features, opt, llvm::Reloc::PIC_,
       std::nullopt, llvm::CodeGenOptLevel::Aggressive)};
-  // set data layout
-  module.setDataLayout(machine->createDataLayout());
+}
+
+// Returns true if a function with a body is still called, i.e. the module
+// hasn't been through an inliner yet.
+bool hasCalledFunctions(llvm::Module &module) {
+  return llvm::any_of(module.functions(), [](llvm::Function &f) {
+    return !f.isDeclaration() && !f.use_empty();
+  });
+}
+
+// Emits `module` with `machine`, whose triple and data layout the module must
+// already have.
+std::string emitMachineCode(llvm::Module &module, llvm::TargetMachine &machine,
+                            bool isObject) {
+  // inline everything, unless optimize_module already did
+  llvm::legacy::PassManager pm;
+  if (hasCalledFunctions(module)) {
+    for (llvm::Function &f : module.functions())
+      if (!f.hasFnAttribute(llvm::Attribute::NoInline))
+        f.addFnAttr(llvm::Attribute::AlwaysInline);
+    pm.add(llvm::createAlwaysInlinerLegacyPass());
+  }
+  // verify and store llvm
+  pm.add(llvm::createVerifierPass());
+  pm.run(module);
   // emit machine code
   std::string result;
   {
     llvm::raw_string_ostream stream(result);
     llvm::buffer_ostream pstream(stream);
-    for (llvm::Function &f : module.functions())
-      f.addFnAttr(llvm::Attribute::AlwaysInline);
     llvm::legacy::PassManager pass;
     // emit
     auto fileType = isObject ? llvm::CodeGenFileType::ObjectFile
                              : llvm::CodeGenFileType::AssemblyFile;
-    machine->addPassesToEmitFile(pass, pstream, nullptr, fileType);
+    machine.addPassesToEmitFile(pass, pstream, nullptr, fileType);
     pass.run(module);
   }
   return result;
 }
 
+// Sets the target of `module` and returns the machine to compile it with.
+std::unique_ptr<llvm::TargetMachine>
+setTarget(llvm::Module &module, const std::string &triple,
+          const std::string &proc, const std::string &features,
+          const std::vector<std::string> &flags, bool enable_fp_fusion) {
+  setFlags(flags);
+  module.setTargetTriple(triple);
+  std::unique_ptr<llvm::TargetMachine> machine =
+      createTargetMachine(module, proc, features, enable_fp_fusion);
+  module.setDataLayout(machine->createDataLayout());
+  return machine;
+}
+
+// Guards the global `unroll-threshold` option, see optimize_module.
+std::shared_mutex unrollThresholdMutex;
+
+} // namespace
+
+std::string translateLLVMIRToASM(llvm::Module &module,
+                                 const std::string &triple,
+                                 const std::string &proc,
+                                 const std::string &features,
+                                 const std::vector<std::string> &flags,
+                                 bool enable_fp_fusion, bool isObject) {
+  std::unique_ptr<llvm::TargetMachine> machine =
+      setTarget(module, triple, proc, features, flags, enable_fp_fusion);
+  return emitMachineCode(module, *machine, isObject);
+}
+
+namespace {
+
+// An extern library read once per process, along with the names of the
+// functions it defines.
+struct ExternLib {
+  std::unique_ptr<llvm::MemoryBuffer> buffer;
+  llvm::StringSet<> definedFunctions;
+};
+
+// Returns a module of `lib` in `ctx`. Function bodies of bitcode libraries are
+// only read when the linker asks for them.
+llvm::Expected<std::unique_ptr<llvm::Module>>
+loadExternLib(const ExternLib &lib, llvm::LLVMContext &ctx) {
+  llvm::MemoryBufferRef buffer = lib.buffer->getMemBufferRef();
+  if (llvm::isBitcode(
+          reinterpret_cast<const unsigned char *>(buffer.getBufferStart()),
+          reinterpret_cast<const unsigned char *>(buffer.getBufferEnd())))
+    return llvm::getLazyBitcodeModule(buffer, ctx);
+  llvm::SMDiagnostic err;
+  std::unique_ptr<llvm::Module> mod = llvm::parseIR(buffer, err, ctx);
+  if (!mod)
+    return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                   err.getMessage());
+  return mod;
+}
+
+const ExternLib *getExternLib(const std::string &path) {
+  static std::mutex mutex;
+  static llvm::StringMap<std::unique_ptr<ExternLib>> libs;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = libs.find(path);
+  if (it != libs.end())
+    return it->second.get();
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  if (!buffer)
+    return nullptr;
+  auto lib = std::make_unique<ExternLib>();
+  lib->buffer = std::move(*buffer);
+  llvm::LLVMContext ctx;
+  auto mod = loadExternLib(*lib, ctx);
+  if (!mod) {
+    llvm::consumeError(mod.takeError());
+    return nullptr;
+  }
+  for (llvm::Function &f : (*mod)->functions())
+    if (!f.isDeclaration())
+      lib->definedFunctions.insert(f.getName());
+  return (libs[path] = std::move(lib)).get();
+}
+
+} // namespace
+
 using ret = py::return_value_policy;
 
 void init_triton_llvm(py::module &&m) {
@@ -118,49 +215,110 @@ void init_triton_llvm(py::module &&m) {
   m.attr("OPTIMIZE_Os") = (llvm::OptimizationLevel::Os);
   m.attr("OPTIMIZE_Oz") = (llvm::OptimizationLevel::Oz);
 
-  m.def("to_module", [](mlir::ModuleOp &mod, llvm::LLVMContext &ctx) {
-    return mlir::translateModuleToLLVMIR(mod, ctx);
-  });
+  // A target machine, created once per module by `set_target` and shared by
+  // the optimization and codegen stages.
+  py::class_<llvm::TargetMachine>(m, "target_machine", py::module_local());
+
+  // Sets the triple and data layout of the module, and returns the machine to
+  // hand to optimize_module and translate_to_asm.
+  m.def(
+      "set_target",
+      [](llvm::Module *mod, std::string triple, std::string proc,
+         std::string features, std::vector<std::string> flags,
+         bool enable_fp_fusion) {
+        return setTarget(*mod, triple, proc, features, flags, enable_fp_fusion);
+      },
+      py::arg("mod"), py::arg("triple"), py::arg("proc"),
+      py::arg("features") = "", py::arg("flags") = std::vector<std::string>{},
+      py::arg("enable_fp_fusion") = false);
+
+  // The module keeps its context alive, so that it can be handed over to later
+  // compilation stages on its own.
+  m.def(
+      "to_module",
+      [](mlir::ModuleOp &mod, llvm::LLVMContext &ctx) {
+        return mlir::translateModuleToLLVMIR(mod, ctx);
+      },
+      py::keep_alive<0, 2>());
 
-  m.def("optimize_module", [](llvm::Module *mod,
-                              const llvm::OptimizationLevel &opt) {
-    using namespace llvm;
-    LoopAnalysisManager lam;
-    FunctionAnalysisManager fam;
-    CGSCCAnalysisManager cgam;
-    ModuleAnalysisManager mam;
-    PipelineTuningOptions tuningOptions;
-    tuningOptions.LoopUnrolling = true;
-    tuningOptions.LoopInterleaving = true;
-    tuningOptions.LoopVectorization = true;
-    // TODO: currently we run SLP vectorizer with an empty target machine. This
-    // cause the vectorizer to create larger vector which could be bad.
-    // Disabling it would currently cause regressions as this pass also applies
-    // some scheduling that helps performance in some cases. We should work on
-    // using NVPTX target instead and address the performance regressions with
-    // some scheduling solution.
-    tuningOptions.SLPVectorization = true;
-
-    PassBuilder pb(nullptr /*targetMachine*/, tuningOptions);
-
-    pb.registerModuleAnalyses(mam);
-    pb.registerCGSCCAnalyses(cgam);
-    pb.registerFunctionAnalyses(fam);
-    pb.registerLoopAnalyses(lam);
-    pb.crossRegisterProxies(lam, fam, cgam, mam);
-
-    ModulePassManager mpm;
-    pb.registerVectorizerStartEPCallback(
-        [&](llvm::FunctionPassManager &fpm, llvm::OptimizationLevel level) {
-          // Triton generates large structure of scalars which may pessimise
-          // optimizations, we run a pass to break up phi of struct to make sure
-          // all the struct are removed for the following passes.
-          fpm.addPass(BreakStructPhiNodesPass());
-          fpm.addPass(InstCombinePass());
+  // Runs the LLVM pipeline at level `opt`. When `machine` is set, the pipeline
+  // is tuned for the target translate_to_asm will emit with it: its cost
+  // model drives vectorization and unrolling, and functions are inlined here
+  // so that codegen doesn't need to.
+  m.def(
+      "optimize_module",
+      [](llvm::Module *mod, const llvm::OptimizationLevel &opt,
+         llvm::TargetMachine *machine, int unroll_threshold) {
+        using namespace llvm;
+        if (machine) {
+          for (Function &f : mod->functions())
+            if (!f.hasFnAttribute(Attribute::NoInline))
+              f.addFnAttr(Attribute::AlwaysInline);
+        }
+        // Neither PipelineTuningOptions nor LoopUnrollOptions carry an
+        // unroll threshold: only the global `unroll-threshold` option
+        // overrides the target's default, when it has been given. A run that
+        // sets it holds the lock exclusively until it is reset, so that
+        // concurrent runs never see another run's threshold. -1 keeps the
+        // target's default.
+        std::shared_lock<std::shared_mutex> sharedLock(unrollThresholdMutex,
+                                                       std::defer_lock);
+        std::unique_lock<std::shared_mutex> uniqueLock(unrollThresholdMutex,
+                                                       std::defer_lock);
+        cl::Option *unrollThreshold = nullptr;
+        if (unroll_threshold >= 0) {
+          uniqueLock.lock();
+          unrollThreshold = cl::getRegisteredOptions()["unroll-threshold"];
+          assert(unrollThreshold);
+          unrollThreshold->addOccurrence(0, "unroll-threshold",
+                                         std::to_string(unroll_threshold));
+        } else {
+          sharedLock.lock();
+        }
+        auto resetUnrollThreshold = llvm::make_scope_exit([&]() {
+          if (unrollThreshold)
+            unrollThreshold->reset();
         });
-    mpm.addPass(pb.buildPerModuleDefaultPipeline(opt));
-    mpm.run(*mod, mam);
-  });
+
+        LoopAnalysisManager lam;
+        FunctionAnalysisManager fam;
+        CGSCCAnalysisManager cgam;
+        ModuleAnalysisManager mam;
+        PipelineTuningOptions tuningOptions;
+        tuningOptions.LoopUnrolling = true;
+        // Kernels are scalar per thread: the loop vectorizer and interleaver
+        // find nothing to do on GPU targets.
+        tuningOptions.LoopInterleaving = !machine;
+        tuningOptions.LoopVectorization = !machine;
+        // Without a target machine the SLP vectorizer may create vectors that
+        // are too large, but it also applies some scheduling that helps
+        // performance in some cases.
+        tuningOptions.SLPVectorization = true;
+
+        PassBuilder pb(machine, tuningOptions);
+
+        pb.registerModuleAnalyses(mam);
+        pb.registerCGSCCAnalyses(cgam);
+        pb.registerFunctionAnalyses(fam);
+        pb.registerLoopAnalyses(lam);
+        pb.crossRegisterProxies(lam, fam, cgam, mam);
+
+        ModulePassManager mpm;
+        pb.registerVectorizerStartEPCallback(
+            [&](llvm::FunctionPassManager &fpm,
+                llvm::OptimizationLevel level) {
+              // Triton generates large structure of scalars which may
+              // pessimise optimizations, we run a pass to break up phi of
+              // struct to make sure all the struct are removed for the
+              // following passes.
+              fpm.addPass(BreakStructPhiNodesPass());
+              fpm.addPass(InstCombinePass());
+            });
+        mpm.addPass(pb.buildPerModuleDefaultPipeline(opt));
+        mpm.run(*mod, mam);
+      },
+      py::arg("mod"), py::arg("opt"), py::arg("machine") = nullptr,
+      py::arg("unroll_threshold") = -1);
 
   m.def(
       "translate_to_asm",
@@ -189,17 +347,47 @@ void init_triton_llvm(py::module &&m) {
       },
       ret::take_ownership);
 
+  // Same as above, but works on a module produced by an earlier stage instead
+  // of parsing its text, with the machine `set_target` returned for it. The
+  // module is modified in place.
+  m.def(
+      "translate_to_asm",
+      [](llvm::Module *module, llvm::TargetMachine *machine,
+         bool isObject) -> py::object {
+        std::string obj;
+        {
+          py::gil_scoped_release allow_threads;
+          obj = emitMachineCode(*module, *machine, isObject);
+        }
+        if (isObject)
+          return py::bytes(obj);
+        else
+          return py::str(obj);
+      },
+      ret::take_ownership);
+
   m.def("link_extern_lib", [](llvm::Module *mod, std::string path) {
-    llvm::SMDiagnostic err;
-    auto &ctx = mod->getContext();
-    auto extMod = llvm::parseIRFile(path, err, ctx);
-    if (!extMod) {
+    const ExternLib *lib = getExternLib(path);
+    if (!lib) {
       llvm::errs() << "Failed to load " << path;
       return;
     }
-    extMod->setTargetTriple(mod->getTargetTriple());
-    extMod->setDataLayout(mod->getDataLayout());
-    if (llvm::Linker::linkModules(*mod, std::move(extMod),
+    // Most kernels don't call into every library.
+    if (llvm::none_of(mod->functions(), [&](llvm::Function &f) {
+          return f.isDeclaration() &&
+                 lib->definedFunctions.contains(f.getName());
+        }))
+      return;
+    auto extMod = loadExternLib(*lib, mod->getContext());
+    if (!extMod) {
+      llvm::errs() << "Failed to load " << path << ": "
+                   << llvm::toString(extMod.takeError());
+      return;
+    }
+    (*extMod)->setTargetTriple(mod->getTargetTriple());
+    (*extMod)->setDataLayout(mod->getDataLayout());
+    // Only the functions the kernel calls and their callees are materialized.
+    if (llvm::Linker::linkModules(*mod, std::move(*extMod),
                                   llvm::Linker::Flags::LinkOnlyNeeded)) {
       llvm::errs() << "Failed to link " << path;
       return;
@@ -25,6 +25,7 @@ void init_triton_passes_ttir(py::module &&m) {
   using namespace mlir::triton;
   ADD_PASS_WRAPPER_0("add_combine", createCombineOpsPass);
   ADD_PASS_WRAPPER_0("add_reorder_broadcast", createReorderBroadcastPass);
+  ADD_PASS_WRAPPER_0("add_fold_range_checks", createFoldRangeChecksPass);
   ADD_PASS_WRAPPER_0("add_rewrite_tensor_pointer",
                      createRewriteTensorPointerPass);
   ADD_PASS_WRAPPER_4("add_convert_to_ttgpuir",
@@ -36,7 +37,8 @@ void init_triton_passes_ttgpuir(py::module &&m) {
   ADD_PASS_WRAPPER_0("add_coalesce", createCoalescePass);
   ADD_PASS_WRAPPER_0("add_optimize_thread_locality",
                      createOptimizeThreadLocalityPass);
-  ADD_PASS_WRAPPER_4("add_pipeline", createPipelinePass, int, int, int, int);
+  ADD_PASS_WRAPPER_6("add_pipeline", createPipelinePass, int, int, int, int,
+                     bool, int);
   ADD_PASS_WRAPPER_0("add_prefetch", createPrefetchPass);
   ADD_PASS_WRAPPER_1("add_accelerate_matmul", createAccelerateMatmulPass, int);
   ADD_PASS_WRAPPER_0("add_reorder_instructions", createReorderInstructionsPass);
@@ -162,6 +162,16 @@ class BlockedLayout:
         return f"#{GPU_DIALECT}.blocked<{{sizePerThread={self.sz_per_thread}, threadsPerWarp={self.threads_per_warp}, warpsPerCTA={self.warps_per_cta}, order={self.order}, CTAsPerCGA={self.ctas_per_cga}, CTASplitNum={self.cta_split_num}, CTAOrder={self.cta_order}}}>"
 
 
+class SliceLayout:
+
+    def __init__(self, dim, parent):
+        self.dim = dim
+        self.parent = parent
+
+    def __str__(self):
+        return f"#{GPU_DIALECT}.slice<{{dim = {self.dim}, parent = {self.parent}}}>"
+
+
 class SharedLayout:
 
     def __init__(self, vec, per_phase, max_phase, order, ctas_per_cga, cta_split_num, cta_order):
@@ -1787,7 +1797,7 @@ scan_configs = [(op, type, shape, axis, num_warps)
                 for type in ['int32', 'float32']
                 for axis in [1, 0]
                 for shape in scan2d_shapes
-                for op in ['cumsum', 'cumprod', 'get_first_element']]
+                for op in ['cumsum', 'cumprod', 'get_first_element', 'cummax']]
 negative_config = [('cumsum', 'float32', (32, 32), -1, 4)]
 
 
@@ -1797,6 +1807,13 @@ def get_first_element(a, b):
     return a
 
 
+@triton.jit
+# scan over a value and its index
+def cummax(a_value, a_index, b_value, b_index):
+    mask = a_value > b_value
+    return tl.where(mask, a_value, b_value), tl.where(mask, a_index, b_index)
+
+
 @pytest.mark.parametrize("op, dtype_str, shape, axis, num_warps", scan_configs + negative_config)
 def test_scan2d(op, dtype_str, shape, axis, num_warps, device):
     if is_hip():
@@ -1814,6 +1831,12 @@ def test_scan2d(op, dtype_str, shape, axis, num_warps, device):
 
     if op == 'cumsum' or op == 'cumprod':
         kernel = patch_kernel(kernel, {'GENERATE_TEST_HERE': f'tl.{op}(x, axis={axis})'})
+    elif op == 'cummax':
+        index = 'range_m[:, None]' if axis == 0 else 'range_n[None, :]'
+        kernel = patch_kernel(kernel, {
+            'GENERATE_TEST_HERE':
+            f'tl.associative_scan((x, tl.broadcast_to({index}, x.shape)), axis={axis}, combine_fn={op})[1]'
+        })
     else:
         kernel = patch_kernel(kernel, {'GENERATE_TEST_HERE': f'tl.associative_scan(x, axis={axis}, combine_fn={op})'})
     # input
@@ -1825,6 +1848,8 @@ def test_scan2d(op, dtype_str, shape, axis, num_warps, device):
         numpy_op = {'cumsum': np.cumsum, 'cumprod': np.cumprod}[op]
         z_dtype_str = dtype_str
         z_ref = numpy_op(x, axis=axis).astype(getattr(np, z_dtype_str))
+    elif op == 'cummax':
+        z_ref = np.maximum.accumulate(x, axis=axis)
     else:
         assert op == 'get_first_element'
         z_ref = x
@@ -1837,7 +1862,11 @@ def test_scan2d(op, dtype_str, shape, axis, num_warps, device):
     kernel[(1, )](x_tri, z_tri, BLOCK_M=shape[0], BLOCK_N=shape[1], AXIS=axis, num_warps=num_warps)
     z_tri = to_numpy(z_tri)
     # compare
-    if dtype_str == 'float32':
+    if op == 'cummax':
+        # the scan returns the index of the running maximum
+        z_tri = np.take_along_axis(x, z_tri.astype(np.int64), axis=axis)
+        np.testing.assert_equal(z_ref, z_tri)
+    elif dtype_str == 'float32':
         if op == 'cumprod':
             np.testing.assert_allclose(z_ref, z_tri, rtol=0.01, atol=1e-3)
         else:
@@ -1857,6 +1886,14 @@ scan_layouts = [
     BlockedLayout([4, 1], [4, 8], [1, 4], [1, 0], [1, 1], [1, 1], [0, 1]),
     BlockedLayout([2, 2], [4, 8], [2, 2], [1, 0], [1, 1], [1, 1], [0, 1]),
     BlockedLayout([2, 2], [8, 4], [2, 2], [1, 0], [1, 1], [1, 1], [0, 1]),
+    MmaLayout(version=(2, 0), warps_per_cta=[4, 1], ctas_per_cga=[1, 1], cta_split_num=[1, 1], cta_order=[0, 1],
+              instr_shape=[16, 8]),
+    MmaLayout(version=(2, 0), warps_per_cta=[1, 4], ctas_per_cga=[1, 1], cta_split_num=[1, 1], cta_order=[0, 1],
+              instr_shape=[16, 8]),
+    MmaLayout(version=(2, 0), warps_per_cta=[2, 2], ctas_per_cga=[1, 1], cta_split_num=[1, 1], cta_order=[0, 1],
+              instr_shape=[16, 8]),
+    SliceLayout(dim=1, parent=BlockedLayout([1, 1, 4], [4, 2, 4], [2, 1, 2], [2, 1, 0], [1, 1, 1], [1, 1, 1],
+                                            [0, 1, 2])),
 ]
 
 
@@ -1914,9 +1951,12 @@ def test_locality(op, BLOCK_N, N, num_pid_n):
 def test_scan_layouts(M, N, src_layout, axis, device):
     if is_hip():
         pytest.skip("test_scan_layouts is not supported in HIP")
+    if isinstance(src_layout, MmaLayout) and axis == 0 and src_layout.warps_per_cta[0] > 1:
+        pytest.skip("scan along the rows of an MMA layout with several warps along them is not supported")
 
     ir = f"""
-    #blocked = {src_layout}
+    #blocked = #{GPU_DIALECT}.blocked<{{sizePerThread = [1, 4], threadsPerWarp = [8, 4], warpsPerCTA = [4, 1], order = [1, 0], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [0, 1]}}>
+    #src = {src_layout}
     module attributes {{"triton_gpu.num-warps" = 4 : i32, "triton_gpu.num-ctas" = 1 : i32, "triton_gpu.threads-per-warp" = 32 : i32}} {{
     tt.func public @kernel_0d1d(%arg0: !tt.ptr<i32, 1> {{tt.divisibility = 16 : i32}}, %arg1: !tt.ptr<i32, 1> {{tt.divisibility = 16 : i32}}) {{
       %cst = arith.constant dense<{N}> : tensor<{M}x1xi32, #blocked>
@@ -1931,11 +1971,13 @@ def test_scan_layouts(M, N, src_layout, axis, device):
       %8 = tt.broadcast %6 : (tensor<1x{N}xi32, #blocked>) -> tensor<{M}x{N}xi32, #blocked>
       %9 = tt.addptr %7, %8 : tensor<{M}x{N}x!tt.ptr<i32, 1>, #blocked>, tensor<{M}x{N}xi32, #blocked>
       %10 = tt.load %9 {{cache = 1 : i32, evict = 1 : i32, isVolatile = false}} : tensor<{M}x{N}xi32, #blocked>
-      %11 = "tt.scan"(%10) <{{axis = {axis} : i32}}> ({{
+      %17 = {GPU_DIALECT}.convert_layout %10 : (tensor<{M}x{N}xi32, #blocked>) -> tensor<{M}x{N}xi32, #src>
+      %18 = "tt.scan"(%17) <{{axis = {axis} : i32}}> ({{
       ^bb0(%arg2: i32, %arg3: i32):
         %16 = arith.addi %arg2, %arg3 : i32
         tt.scan.return %16 : i32
-      }}) : (tensor<{M}x{N}xi32, #blocked>) -> tensor<{M}x{N}xi32, #blocked>
+      }}) : (tensor<{M}x{N}xi32, #src>) -> tensor<{M}x{N}xi32, #src>
+      %11 = {GPU_DIALECT}.convert_layout %18 : (tensor<{M}x{N}xi32, #src>) -> tensor<{M}x{N}xi32, #blocked>
       %12 = tt.splat %arg1 : (!tt.ptr<i32, 1>) -> tensor<{M}x1x!tt.ptr<i32, 1>, #blocked>
       %13 = tt.addptr %12, %2 : tensor<{M}x1x!tt.ptr<i32, 1>, #blocked>, tensor<{M}x1xi32, #blocked>
       %14 = tt.broadcast %13 : (tensor<{M}x1x!tt.ptr<i32, 1>, #blocked>) -> tensor<{M}x{N}x!tt.ptr<i32, 1>, #blocked>
@@ -2918,6 +2960,28 @@ def test_vectorization_hints(has_hints, device):
         assert "ld.global.v4.b32" not in ptx
 
 
+@pytest.mark.parametrize("has_hints", [False, True])
+def test_range_hints(has_hints, device):
+    src = torch.arange(1024, device=device, dtype=torch.float32)
+    dst = torch.empty_like(src)
+
+    @triton.jit
+    def _kernel(dst, src, N, BLOCK_SIZE: tl.constexpr, HINT: tl.constexpr):
+        pid = tl.program_id(0)
+        if HINT:
+            # the grid has 4 programs and N covers all of them
+            pid = tl.assume_range(pid, min=0, max=3)
+            N = tl.assume_range(N, min=4 * BLOCK_SIZE)
+        offsets = pid * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        x = tl.load(src + offsets, mask=offsets < N)
+        tl.store(dst + offsets, x, mask=offsets < N)
+
+    pgm = _kernel[(4, )](dst, src, 1024, BLOCK_SIZE=256, HINT=has_hints)
+    torch.testing.assert_close(dst, src)
+    # the masks are folded away when the hints bound the offsets
+    assert ("arith.cmpi" in pgm.asm["ttir"]) != has_hints
+
+
 # ---------------
 # test store
 # ---------------
@@ -79,3 +79,133 @@ def test_prune_configs(with_perf_model: bool):
         assert records['run_perf_model']
     else:
         assert records['run_early_config_prune']
+
+
+def test_precompile_prunes_failing_configs():
+    N = 1024
+    src = torch.empty(N, device='cuda')
+    dst = torch.empty(N, device='cuda')
+
+    # tl.arange needs a power of two, so the second config fails to compile
+    configs = [
+        triton.Config(kwargs={'BLOCK_SIZE': 32}),
+        triton.Config(kwargs={'BLOCK_SIZE': 48}),
+        triton.Config(kwargs={'BLOCK_SIZE': 128})
+    ]
+
+    @triton.autotune(configs=configs, key=['N'], warmup=1, rep=1)
+    @triton.jit
+    def _kernel(dst, src, N, BLOCK_SIZE: tl.constexpr):
+        offsets = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        x = tl.load(src + offsets, mask=offsets < N)
+        tl.store(dst + offsets, x, mask=offsets < N)
+
+    grid = lambda META: (triton.cdiv(N, META['BLOCK_SIZE']), )
+    _kernel[grid](dst, src, N)
+    torch.testing.assert_close(src, dst)
+    assert list(_kernel.compile_errors) == [configs[1]]
+    assert set(_kernel.configs_timings) == {configs[0], configs[2]}
+
+
+def test_precompile_errors_are_per_key():
+    src = torch.empty(1024, device='cuda')
+    dst = torch.empty(1024, device='cuda')
+
+    configs = [triton.Config(kwargs={'BLOCK_SIZE': 32}), triton.Config(kwargs={'BLOCK_SIZE': 128})]
+
+    @triton.autotune(configs=configs, key=['N'], warmup=1, rep=1)
+    @triton.jit
+    def _kernel(dst, src, N: tl.constexpr, BLOCK_SIZE: tl.constexpr):
+        tl.static_assert(N % BLOCK_SIZE == 0)
+        offsets = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offsets, tl.load(src + offsets))
+
+    grid = lambda META: (META['N'] // META['BLOCK_SIZE'], )
+    # BLOCK_SIZE=128 does not divide 96...
+    _kernel[grid](dst, src, N=96)
+    assert list(_kernel.compile_errors) == [configs[1]]
+    assert set(_kernel.configs_timings) == {configs[0]}
+    # ...but is tuned again for a size it divides
+    _kernel[grid](dst, src, N=1024)
+    assert not _kernel.compile_errors
+    assert set(_kernel.configs_timings) == set(configs)
+
+
+def test_precompile_source_is_picklable():
+    import pickle
+    from triton.compiler import TTIRSource, compile
+
+    N = 1024
+    src = torch.empty(N, device='cuda')
+    dst = torch.empty(N, device='cuda')
+
+    @triton.jit
+    def _kernel(dst, src, N, BLOCK_SIZE: tl.constexpr):
+        offsets = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        x = tl.load(src + offsets, mask=offsets < N)
+        tl.store(dst + offsets, x, mask=offsets < N)
+
+    ast_src, target, options = _kernel.compile_args(dst, src, N, BLOCK_SIZE=32)
+    ttir_src = pickle.loads(pickle.dumps(TTIRSource(ast_src, target, options)))
+    # both sources share one cache entry
+    kernel = compile(ttir_src, target=target, options=options)
+    assert compile(ast_src, target=target, options=options) is kernel
+
+
+def test_cache_results(tmp_path, monkeypatch):
+    monkeypatch.setenv("TRITON_CACHE_DIR", str(tmp_path))
+    N = 1024
+    src = torch.empty(N, device='cuda')
+    dst = torch.empty(N, device='cuda')
+
+    configs = [triton.Config(kwargs={'BLOCK_SIZE': 32}), triton.Config(kwargs={'BLOCK_SIZE': 128})]
+
+    @triton.jit
+    def _kernel(dst, src, N, BLOCK_SIZE: tl.constexpr):
+        offsets = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        x = tl.load(src + offsets, mask=offsets < N)
+        tl.store(dst + offsets, x, mask=offsets < N)
+
+    grid = lambda META: (triton.cdiv(N, META['BLOCK_SIZE']), )
+    tuned = triton.autotune(configs=configs, key=['N'], warmup=1, rep=1, cache_results=True)(_kernel)
+    tuned[grid](dst, src, N)
+    assert tuned.bench_time > 0
+    # a fresh autotuner, e.g. in a new process, reuses the stored results
+    reloaded = triton.autotune(configs=configs, key=['N'], warmup=1, rep=1, cache_results=True)(_kernel)
+    reloaded[grid](dst, src, N)
+    assert reloaded.bench_time == 0
+    assert reloaded.best_config is tuned.best_config
+    assert set(reloaded.configs_timings) == set(tuned.configs_timings)
+
+
+def test_cache_results_pruned_configs(tmp_path, monkeypatch):
+    monkeypatch.setenv("TRITON_CACHE_DIR", str(tmp_path))
+    N = 1024
+    src = torch.empty(N, device='cuda')
+    dst = torch.empty(N, device='cuda')
+
+    def early_config_prune(configs, named_args):
+        # new Config objects, which are not in the autotuner's configs
+        return [triton.Config(dict(config.kwargs), num_warps=config.num_warps) for config in configs]
+
+    configs = [triton.Config(kwargs={'BLOCK_SIZE': 32}), triton.Config(kwargs={'BLOCK_SIZE': 128})]
+
+    @triton.jit
+    def _kernel(dst, src, N, BLOCK_SIZE: tl.constexpr):
+        offsets = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        x = tl.load(src + offsets, mask=offsets < N)
+        tl.store(dst + offsets, x, mask=offsets < N)
+
+    def autotune():
+        return triton.autotune(configs=configs, key=['N'], prune_configs_by={'early_config_prune': early_config_prune},
+                               warmup=1, rep=1, cache_results=True)(_kernel)
+
+    grid = lambda META: (triton.cdiv(N, META['BLOCK_SIZE']), )
+    tuned = autotune()
+    tuned[grid](dst, src, N)
+    assert tuned.bench_time > 0
+    reloaded = autotune()
+    reloaded[grid](dst, src, N)
+    assert reloaded.bench_time == 0
+    assert reloaded.best_config.kwargs == tuned.best_config.kwargs
+    assert len(reloaded.configs_timings) == 2
@@ -195,6 +195,63 @@ def test_jit_warmup_cache() -> None:
     assert len(kernel_add.cache[device]) == 1
 
 
+def test_kernel_memory_cache() -> None:
+    from triton.compiler.compiler import kernel_cache
+
+    def make_kernel():
+
+        @triton.jit
+        def kernel_add(a, b, o, N: tl.constexpr):
+            idx = tl.arange(0, N)
+            tl.store(o + idx, tl.load(a + idx) + tl.load(b + idx))
+
+        return kernel_add
+
+    kernel_cache.clear()
+    device = torch.cuda.current_device()
+    first, second = make_kernel(), make_kernel()
+    first.warmup(torch.float32, torch.float32, torch.float32, 32, grid=(1, ))
+    before = kernel_cache.stats()
+    assert before["entries"] == 1
+    assert before["bytes"] > 0
+    second.warmup(torch.float32, torch.float32, torch.float32, 32, grid=(1, ))
+    after = kernel_cache.stats()
+    assert after["hits"] == before["hits"] + 1
+    assert after["entries"] == 1
+    # both functions share the same compiled kernel and launcher
+    bin1, = first.cache[device].values()
+    bin2, = second.cache[device].values()
+    assert bin1 is bin2
+
+
+def test_fingerprint_manifest() -> None:
+    from triton.common.backend import FingerprintManifest
+
+    calls = []
+
+    def compute(path):
+        calls.append(path)
+        with open(path) as f:
+            return f.read()
+
+    with tempfile.TemporaryDirectory() as dir:
+        src = os.path.join(dir, "src.py")
+        manifest_path = os.path.join(dir, "cache", "fingerprints.json")
+        with open(src, "w") as f:
+            f.write("a")
+        manifest = FingerprintManifest(manifest_path)
+        assert manifest.get(src, compute) == "a"
+        manifest.save()
+        # a new process reads the digest back from the manifest
+        assert FingerprintManifest(manifest_path).get(src, compute) == "a"
+        assert len(calls) == 1
+        # and recomputes it once the file changed
+        with open(src, "w") as f:
+            f.write("bb")
+        assert FingerprintManifest(manifest_path).get(src, compute) == "bb"
+        assert len(calls) == 2
+
+
 def test_jit_debug() -> None:
 
     @triton.jit
@@ -0,0 +1,196 @@
+import pytest
+import torch
+
+import triton.language as tl
+from triton.runtime.interpreter import GridExecutor, InterpretedFunction
+
+
+def _program_id_kernel(out_ptr, GRID_Y: tl.constexpr):
+    pid = tl.program_id(0) * GRID_Y + tl.program_id(1)
+    tl.store(out_ptr + pid, pid)
+
+
+def _atomic_kernel(out_ptr):
+    tl.atomic_add(out_ptr, 1)
+
+
+def _calls_atomic_kernel(out_ptr):
+    atomic_kernel(out_ptr)
+
+
+def _first_combine(a, b):
+    return a
+
+
+def _argmax_combine(value1, index1, value2, index2):
+    gt = value1 > value2
+    eq = value1 == value2
+    take1 = gt | (eq & (index1 < index2))
+    return tl.where(take1, value1, value2), tl.where(take1, index1, index2)
+
+
+atomic_kernel = InterpretedFunction(_atomic_kernel)
+first_combine = InterpretedFunction(_first_combine)
+argmax_combine = InterpretedFunction(_argmax_combine)
+
+
+@pytest.mark.parametrize("num_workers", ["1", "4"])
+@pytest.mark.parametrize("batch_size", ["1", "8"])
+def test_grid(num_workers, batch_size, monkeypatch):
+    monkeypatch.setenv("TRITON_INTERPRET_NUM_WORKERS", num_workers)
+    monkeypatch.setenv("TRITON_INTERPRET_BATCH_SIZE", batch_size)
+    kernel = InterpretedFunction(_program_id_kernel)
+    out = torch.full((6 * 5, ), -1, dtype=torch.int32)
+    kernel[(6, 5)](out, GRID_Y=5)
+    assert torch.equal(out, torch.arange(6 * 5, dtype=torch.int32))
+
+
+def test_divergent_programs(monkeypatch):
+    monkeypatch.setenv("TRITON_INTERPRET_BATCH_SIZE", "4")
+
+    def kernel(out_ptr):
+        pid = tl.program_id(0)
+        acc = 0
+        for i in range(pid):
+            acc += i
+        tl.store(out_ptr + pid, tl.load(out_ptr + pid) + acc)
+
+    # programs are rerun one by one when their loop bounds differ, which must
+    # not apply the read-modify-write twice
+    out = torch.ones((8, ), dtype=torch.int32)
+    InterpretedFunction(kernel)[(8, )](out)
+    pid = torch.arange(8, dtype=torch.int32)
+    assert torch.equal(out, 1 + pid * (pid - 1) // 2)
+
+
+@pytest.mark.parametrize("batch_size", ["1", "4"])
+def test_divergent_branches(batch_size, monkeypatch):
+    monkeypatch.setenv("TRITON_INTERPRET_BATCH_SIZE", batch_size)
+
+    def kernel(out_ptr):
+        pid = tl.program_id(0)
+        if pid % 2 == 0:
+            val = pid
+        else:
+            val = -pid
+        i = 0
+        while i < pid:
+            val += 100
+            i += 1
+        tl.store(out_ptr + pid, val)
+
+    out = torch.zeros((8, ), dtype=torch.int32)
+    InterpretedFunction(kernel)[(8, )](out)
+    pid = torch.arange(8, dtype=torch.int32)
+    assert torch.equal(out, torch.where(pid % 2 == 0, pid, -pid) + 100 * pid)
+
+
+@pytest.mark.parametrize("dtype", [torch.int8, torch.float16, torch.float32, torch.int64])
+@pytest.mark.parametrize("offset", [0, 1])
+def test_masked_strided_access(dtype, offset):
+
+    def kernel(buf_ptr, ref_ptr, out_ptr, contiguous_ptr, N: tl.constexpr, OFFSET: tl.constexpr):
+        # the elements start OFFSET bytes into the buffer, so they may not be
+        # aligned for their type
+        src = (buf_ptr + OFFSET).to(ref_ptr.dtype)
+        offs = tl.arange(0, N)
+        mask = offs % 3 != 0
+        x = tl.load(src + 2 * offs, mask=mask, other=7)
+        tl.store(out_ptr + offs, x)
+        tl.store(contiguous_ptr + offs, tl.load(src + offs))
+        tl.store(src + 2 * offs + 1, x, mask=mask)
+
+    N = 8
+    itemsize = torch.empty((), dtype=dtype).element_size()
+    values = torch.arange(2 * N).to(dtype)
+    buf = torch.zeros((offset + 2 * N * itemsize, ), dtype=torch.uint8)
+    buf[offset:] = values.view(torch.uint8)
+    out = torch.zeros((N, ), dtype=dtype)
+    contiguous = torch.zeros((N, ), dtype=dtype)
+    InterpretedFunction(kernel)[(1, )](buf, values, out, contiguous, N=N, OFFSET=offset)
+
+    mask = torch.arange(N) % 3 != 0
+    expected = torch.where(mask, values[::2], torch.full((N, ), 7, dtype=dtype))
+    assert torch.equal(out, expected)
+    assert torch.equal(contiguous, values[:N])
+    stored = values.clone()
+    stored[1::2][mask] = values[::2][mask]
+    assert torch.equal(buf[offset:].clone().view(dtype), stored)
+
+
+def test_deterministic_atomics():
+    assert not GridExecutor(_program_id_kernel, ["out_ptr", "GRID_Y"], (1, )).deterministic
+    assert GridExecutor(_atomic_kernel, ["out_ptr"], (1, )).deterministic
+    assert GridExecutor(_calls_atomic_kernel, ["out_ptr"], (1, )).deterministic
+
+
+def test_atomics():
+
+    def kernel(counter_ptr, max_ptr, cas_ptr):
+        pid = tl.program_id(0)
+        tl.atomic_add(counter_ptr, 1)
+        tl.atomic_max(max_ptr, pid)
+        tl.atomic_cas(cas_ptr + pid, pid, pid + 100)
+
+    counter = torch.zeros((1, ), dtype=torch.int32)
+    max_val = torch.full((1, ), -1, dtype=torch.int32)
+    cas = torch.arange(8, dtype=torch.int32)
+    cas[1] = 100
+    InterpretedFunction(kernel)[(8, )](counter, max_val, cas)
+    assert counter.item() == 8
+    assert max_val.item() == 7
+    expected = torch.arange(8, dtype=torch.int32) + 100
+    expected[1] = 100
+    assert torch.equal(cas, expected)
+
+
+def test_atomic_add_fp16():
+
+    def kernel(out_ptr, x_ptr, N: tl.constexpr):
+        tl.atomic_add(out_ptr + tl.arange(0, N), tl.load(x_ptr + tl.arange(0, N)))
+
+    x = torch.tensor([0.5, -1.25, 3.0, 1e-7], dtype=torch.float16)
+    out = torch.ones((4, ), dtype=torch.float16)
+    InterpretedFunction(kernel)[(8, )](out, x, N=4)
+    expected = torch.ones((4, ), dtype=torch.float16)
+    for _ in range(8):
+        expected += x
+    assert torch.equal(out, expected)
+
+
+def test_reduce_scan():
+
+    def kernel(x_ptr, sum_ptr, first_ptr, argmax_ptr, cumsum_ptr, N: tl.constexpr):
+        offs = tl.arange(0, N)
+        x = tl.load(x_ptr + offs)
+        tl.store(sum_ptr, tl.sum(x, axis=0))
+        tl.store(first_ptr, tl.reduce(x, 0, first_combine))
+        _, index = tl.reduce((x, offs), 0, argmax_combine)
+        tl.store(argmax_ptr, index)
+        tl.store(cumsum_ptr + offs, tl.cumsum(x, axis=0))
+
+    x = torch.tensor([3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5], dtype=torch.int32)
+    x = torch.nn.functional.pad(x, (0, 16 - x.numel()))
+    out = [torch.zeros((1, ), dtype=torch.int32) for _ in range(3)]
+    cumsum = torch.zeros_like(x)
+    InterpretedFunction(kernel)[(1, )](x, *out, cumsum, N=16)
+    assert out[0].item() == x.sum().item()
+    assert out[1].item() == x[0].item()
+    assert out[2].item() == x.argmax().item()
+    assert torch.equal(cumsum, torch.cumsum(x, 0).to(torch.int32))
+
+
+def test_print_assert(capfd):
+
+    def kernel(x_ptr):
+        x = tl.load(x_ptr + tl.arange(0, 2))
+        tl.device_print("x", x)
+        tl.device_assert(x < 2, "x < 2")
+
+    x = torch.tensor([0, 1], dtype=torch.int32)
+    InterpretedFunction(kernel)[(1, )](x)
+    out, _ = capfd.readouterr()
+    assert out.splitlines() == ["pid (0, 0, 0) idx (0) x: 0", "pid (0, 0, 0) idx (1) x: 1"]
+    x = torch.tensor([0, 2], dtype=torch.int32)
+    with pytest.raises(AssertionError, match="x < 2"):
+        InterpretedFunction(kernel)[(1, )](x)
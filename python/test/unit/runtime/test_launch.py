@@ -43,6 +43,95 @@ def test_memory_leak() -> None:
         tracemalloc.stop()
 
 
+class _StubDriver:
+
+    def get_current_device(self):
+        return 0
+
+    def get_current_stream(self, device):
+        return 0
+
+    def get_current_target(self):
+        return ("cuda", 80)
+
+
+class _StubKernel:
+    num_warps = 4
+    num_ctas = 1
+    cluster_dims = (1, 1, 1)
+    shared = 0
+    metadata = {"tensormaps_info": []}
+    launch_enter_hook = None
+    launch_exit_hook = None
+
+    def __init__(self):
+        self.launches = 0
+
+    def _init_handles(self, device=None):
+        # (module, function, n_regs, n_spills)
+        return (None, None, 0, 0)
+
+    def launcher(self, *args):
+        self.launches += 1
+
+
+def _stub_compiler(monkeypatch):
+    # the driver and the compiler are replaced by stubs, so each launch only
+    # computes the cache key and calls a no-op launcher
+    compiled = []
+
+    def stub_compile(src, target=None, options=None):
+        compiled.append(_StubKernel())
+        return compiled[-1]
+
+    monkeypatch.setattr(triton.runtime.jit, "driver", _StubDriver())
+    monkeypatch.setattr(triton.runtime.jit, "get_cuda_version_key", lambda: "stub")
+    monkeypatch.setattr(triton.compiler, "compile", stub_compile)
+    return compiled
+
+
+def test_launch_stub_driver(monkeypatch) -> None:
+    # repeated launches with the same signature and specialization hit the
+    # cache: the kernel is compiled once and every launch reaches the launcher
+    compiled = _stub_compiler(monkeypatch)
+
+    @triton.jit
+    def kernel(x_ptr, y_ptr, out_ptr, n_elements, alpha, BLOCK_SIZE: tl.constexpr):
+        pass
+
+    x, y, out = (torch.empty(1024) for _ in range(3))
+    num_runs = 1000
+    for _ in range(num_runs):
+        kernel[(1, )](x, y, out, x.numel(), 2.0, BLOCK_SIZE=1024)
+    assert len(compiled) == 1
+    assert compiled[0].launches == num_runs
+    # a size that is not a multiple of 16 is a new specialization...
+    kernel[(1, )](x, y, out, 1000, 2.0, BLOCK_SIZE=1024)
+    assert len(compiled) == 2
+    # ...and so is a new constexpr value, but not a new float value
+    kernel[(1, )](x, y, out, x.numel(), 3.0, BLOCK_SIZE=1024)
+    kernel[(1, )](x, y, out, x.numel(), 2.0, BLOCK_SIZE=512)
+    assert len(compiled) == 3
+    assert compiled[0].launches == num_runs + 1
+
+
+def test_launch_binder_parameter_names(monkeypatch) -> None:
+    # parameters named like the internals of the generated binder
+    compiled = _stub_compiler(monkeypatch)
+
+    @triton.jit
+    def kernel(_options, _key_of, _spec_key, _default_0=1, BLOCK_SIZE: tl.constexpr = 16):
+        pass
+
+    x = torch.empty(16)
+    kernel[(1, )](x, 3, 5)
+    kernel[(1, )](x, 3, 5, _default_0=2)
+    kernel[(1, )](_options=x, _key_of=3, _spec_key=5)
+    assert len(compiled) == 2
+    assert compiled[0].launches == 2
+    assert compiled[1].launches == 1
+
+
 # LATENCY_THRESHOLD_US = 46
 
 # def test_kernel_launch_latency() -> None:
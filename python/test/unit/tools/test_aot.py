@@ -5,6 +5,7 @@ import sys
 import tempfile
 
 import numpy as np
+import pytest
 
 import triton
 from triton.common import cuda_include_dir, libcuda_dirs
@@ -96,16 +97,17 @@ static void read_csv_to_buffer(char *filename, int16_t *buffer, int size) {
 }"""
 
 
-def gen_kernel_library(dir, libname):
+def gen_kernel_library(dir, libname, bundle=False):
     c_files = glob.glob(os.path.join(dir, "*.c"))
+    defines = ["-DTT_BUNDLED_CUBINS"] if bundle else []
     subprocess.run(
-        ["gcc"] + c_files + ["-I", cuda_include_dir(), "-c", "-fPIC"],
+        ["gcc"] + c_files + ["-I", cuda_include_dir(), "-c", "-fPIC"] + defines,
         check=True,
         cwd=dir,
     )
     o_files = glob.glob(os.path.join(dir, "*.o"))
     subprocess.run(
-        ["gcc"] + o_files + ["-shared", "-o", libname, "-L", libcuda_dirs()[0]],
+        ["gcc"] + o_files + ["-shared", "-pthread", "-o", libname, "-L", libcuda_dirs()[0]],
         check=True,
         cwd=dir,
     )
@@ -268,12 +270,13 @@ def compile_aot_kernels(dir, kernel_path, dtype, BM, BN, BK, ha_hb_hints):
             )
 
 
-def link_aot_kernels(dir):
+def link_aot_kernels(dir, bundle=False):
     linker_path = os.path.join(triton.tools.__path__[0], "link.py")
 
     # link all desired configs
     h_files = glob.glob(os.path.join(dir, "*.h"))
-    subprocess.run([sys.executable, linker_path] + h_files + ["-o", "kernel"], check=True, cwd=dir)
+    options = ["--bundle"] if bundle else []
+    subprocess.run([sys.executable, linker_path] + h_files + ["-o", "kernel"] + options, check=True, cwd=dir)
 
 
 def generate_matmul_test_data(dir, M, N, K):
@@ -319,7 +322,8 @@ def test_compile_link_matmul_no_specialization():
         np.testing.assert_allclose(c_tri, c_ref * c_ref, atol=1e-4, rtol=0.0)
 
 
-def test_compile_link_matmul():
+@pytest.mark.parametrize("bundle", [False, True])
+def test_compile_link_matmul(bundle):
     np.random.seed(3)
 
     with tempfile.TemporaryDirectory() as tmp_dir:
@@ -328,11 +332,11 @@ def test_compile_link_matmul():
 
         kernel_path = write_triton_kernels(tmp_dir, kernel_src, kernel_utils_src)
         compile_aot_kernels(tmp_dir, kernel_path, dtype, BM, BN, BK, ha_hb_hints=["", ":16"])
-        link_aot_kernels(tmp_dir)
+        link_aot_kernels(tmp_dir, bundle=bundle)
 
         # compile test case
         M, N, K = 16, 16, 16
-        gen_kernel_library(tmp_dir, "libkernel.so")
+        gen_kernel_library(tmp_dir, "libkernel.so", bundle=bundle)
         gen_test_bin(tmp_dir, M, N, K)
 
         # initialize test data
@@ -2,7 +2,9 @@ import functools
 import hashlib
 import importlib
 import importlib.util
+import json
 import os
+import random
 import re
 import subprocess
 import traceback
@@ -105,6 +107,92 @@ def get_backend(device_type: str):
     return _backends[device_type] if device_type in _backends else None
 
 
+class FingerprintManifest:
+    """
+    Digests of files keyed by their path, size, modification time and inode,
+    persisted next to the cache dir so that new processes only recompute the
+    digests of files that changed.
+    """
+
+    def __init__(self, path):
+        self.path = path
+        self.entries = self._read()
+        self.updates = dict()
+
+    def _read(self):
+        try:
+            with open(self.path) as f:
+                entries = json.load(f)
+            return entries if isinstance(entries, dict) else dict()
+        except (OSError, ValueError):
+            return dict()
+
+    def get(self, path, compute):
+        """
+        Return `compute(path)`, recomputed only if the file changed since it was
+        last recorded.
+        """
+        st = os.stat(path)
+        stamp = [st.st_size, st.st_mtime_ns, st.st_ino]
+        entry = self.entries.get(path)
+        if entry is not None and entry[0] == stamp:
+            return entry[1]
+        value = compute(path)
+        self.entries[path] = self.updates[path] = [stamp, value]
+        return value
+
+    def save(self):
+        if not self.updates:
+            return
+        # merge with the entries other processes may have written meanwhile
+        entries = self._read()
+        entries.update(self.updates)
+        temp_path = f"{self.path}.tmp.pid_{os.getpid()}_{random.randint(0, 1000000)}"
+        try:
+            os.makedirs(os.path.dirname(self.path), exist_ok=True)
+            with open(temp_path, "w") as f:
+                json.dump(entries, f)
+            os.replace(temp_path, self.path)
+        except OSError:
+            # the manifest is only an optimization
+            if os.path.exists(temp_path):
+                os.remove(temp_path)
+            return
+        self.updates = dict()
+
+
+@functools.lru_cache()
+def get_fingerprint_manifest():
+    from ..runtime.cache import default_cache_dir
+    cache_dir = os.getenv("TRITON_CACHE_DIR", "").strip() or default_cache_dir()
+    return FingerprintManifest(os.path.join(cache_dir, "fingerprints.json"))
+
+
+def _sha1_file(path):
+    sha1 = hashlib.sha1()
+    with open(path, "rb") as f:
+        while True:
+            chunk = f.read(1024**2)
+            if not chunk:
+                break
+            sha1.update(chunk)
+    return sha1.hexdigest()
+
+
+def _version_output(path):
+    return subprocess.check_output([path, "--version"], stderr=subprocess.STDOUT).decode("utf-8")
+
+
+def get_binary_version_output(binary_path):
+    """
+    Return the output of `binary_path --version`, cached across processes.
+    """
+    manifest = get_fingerprint_manifest()
+    output = manifest.get(binary_path, _version_output)
+    manifest.save()
+    return output
+
+
 def _path_to_binary(binary: str):
     base_dir = os.path.join(os.path.dirname(__file__), os.pardir)
     paths = [
@@ -115,9 +203,9 @@ def _path_to_binary(binary: str):
     for p in paths:
         bin = p.split(" ")[0]
         if os.path.exists(bin) and os.path.isfile(bin):
-            result = subprocess.check_output([bin, "--version"], stderr=subprocess.STDOUT)
+            result = get_binary_version_output(bin)
             if result is not None:
-                version = re.search(r".*release (\d+\.\d+).*", result.decode("utf-8"), flags=re.MULTILINE)
+                version = re.search(r".*release (\d+\.\d+).*", result, flags=re.MULTILINE)
                 if version is not None:
                     return p, version.group(1)
     raise RuntimeError(f"Cannot find {binary}")
@@ -141,30 +229,22 @@ def path_to_nvdisasm():
 @functools.lru_cache()
 def compute_core_version_key():
     import pkgutil
+    manifest = get_fingerprint_manifest()
     contents = []
     # frontend
-    with open(__file__, "rb") as f:
-        contents += [hashlib.sha1(f.read()).hexdigest()]
+    contents += [manifest.get(__file__, _sha1_file)]
     # compiler
     compiler_path = os.path.join(TRITON_PATH, 'compiler')
     backends_path = os.path.join(TRITON_PATH, 'compiler', 'backends')
     for lib in pkgutil.iter_modules([compiler_path, backends_path]):
-        with open(lib.module_finder.find_spec(lib.name).origin, "rb") as f:
-            contents += [hashlib.sha1(f.read()).hexdigest()]
+        contents += [manifest.get(lib.module_finder.find_spec(lib.name).origin, _sha1_file)]
     # backend
-    libtriton_hash = hashlib.sha1()
-    with open(os.path.join(TRITON_PATH, "_C/libtriton.so"), "rb") as f:
-        while True:
-            chunk = f.read(1024**2)
-            if not chunk:
-                break
-            libtriton_hash.update(chunk)
-    contents.append(libtriton_hash.hexdigest())
+    contents.append(manifest.get(os.path.join(TRITON_PATH, "_C/libtriton.so"), _sha1_file))
     # language
     language_path = os.path.join(TRITON_PATH, 'language')
     for lib in pkgutil.iter_modules([language_path]):
-        with open(lib.module_finder.find_spec(lib.name).origin, "rb") as f:
-            contents += [hashlib.sha1(f.read()).hexdigest()]
+        contents += [manifest.get(lib.module_finder.find_spec(lib.name).origin, _sha1_file)]
+    manifest.save()
     return '-'.join(TRITON_VERSION) + '-'.join(contents)
 
 
@@ -177,7 +257,7 @@ def get_cuda_version_key():
         key = compute_core_version_key()
         try:
             ptxas = path_to_ptxas()[0]
-            ptxas_version = subprocess.check_output([ptxas, "--version"])
+            ptxas_version = get_binary_version_output(ptxas.split(" ")[0]).encode("utf-8")
         except RuntimeError:
             ptxas_version = b"NO_PTXAS"
         _cached_cuda_version_key = key + '-' + hashlib.sha1(ptxas_version).hexdigest()
@@ -1,4 +1,4 @@
-from .compiler import (CompiledKernel, ASTSource, compile, AttrsDescriptor)
+from .compiler import (CompiledKernel, ASTSource, TTIRSource, compile, AttrsDescriptor)
 from .errors import CompilationError
 
-__all__ = ["compile", "ASTSource", "AttrsDescriptor", "CompiledKernel", "CompilationError"]
+__all__ = ["compile", "ASTSource", "TTIRSource", "AttrsDescriptor", "CompiledKernel", "CompilationError"]
@@ -2,7 +2,9 @@ from triton.common.backend import BaseBackend
 from dataclasses import dataclass
 from ...common.backend import get_cuda_version_key, path_to_ptxas
 from ..._C.libtriton import ir, passes, nvidia, llvm
+import contextlib
 import functools
+import logging
 from typing import Any
 from ..make_launcher import make_stub
 from ..utils import get_ids_of_tensormaps, parse_tma_info
@@ -12,8 +14,11 @@ import tempfile
 import signal
 import os
 import subprocess
+import time
 from pathlib import Path
 
+logger = logging.getLogger(__name__)
+
 
 @functools.lru_cache()
 def ptx_get_version(cuda_version) -> int:
@@ -31,17 +36,42 @@ def ptx_get_version(cuda_version) -> int:
     raise RuntimeError("Triton only support CUDA 10.0 or higher")
 
 
+@contextlib.contextmanager
+def _log_time(phase):
+    start = time.perf_counter()
+    yield
+    logger.debug("LLVM %s took %.2f ms", phase, (time.perf_counter() - start) * 1e3)
+
+
+class _TargetedModule:
+    """
+    An LLVM module along with the target machine it was optimized for, which
+    codegen reuses. Printed as the module's IR when written to the cache.
+    """
+
+    def __init__(self, module, machine):
+        self.module = module
+        self.machine = machine
+
+    def __str__(self):
+        return str(self.module)
+
+
 @dataclass(frozen=True)
 class CUDAOptions:
     num_warps: int = 4
     num_ctas: int = 1
     num_stages: int = 3
+    auto_num_stages: bool = False
+    # shared memory a block can use, in bytes; estimated from the capability when None
+    max_shared_mem: int = None
     cluster_dims: tuple = (1, 1, 1)
     ptx_version: int = None
     enable_warp_specialization: bool = False
     enable_persistent: bool = False
     optimize_epilogue: bool = False
     enable_fp_fusion: bool = True
+    unroll_threshold: int = None
     allow_fp8e4nv: bool = False
     max_num_imprecise_acc_default: bool = None
     extern_libs: dict = None
@@ -87,6 +117,7 @@ class CUDABackend(BaseBackend):
         pm.enable_debug()
         passes.common.add_inliner(pm)
         passes.ttir.add_combine(pm)
+        passes.ttir.add_fold_range_checks(pm)
         passes.common.add_canonicalizer(pm)
         passes.ttir.add_reorder_broadcast(pm)
         passes.common.add_cse(pm)
@@ -141,7 +172,8 @@ class CUDABackend(BaseBackend):
             passes.common.add_licm(pm)
             passes.common.add_cse(pm)
         else:
-            passes.ttgpuir.add_pipeline(pm, opt.num_stages, opt.num_warps, opt.num_ctas, capability)
+            passes.ttgpuir.add_pipeline(pm, opt.num_stages, opt.num_warps, opt.num_ctas, capability,
+                                        opt.auto_num_stages, opt.max_shared_mem or 0)
         nvidia.passes.ttnvgpuir.add_materialize_load_store(pm, opt.num_warps, capability)
         if capability // 10 <= 8:
             passes.ttgpuir.add_prefetch(pm)
@@ -186,14 +218,19 @@ class CUDABackend(BaseBackend):
             passes.llvmir.add_di_scope(pm)
         pm.run(mod)
         # LLVM-IR (MLIR) -> LLVM-IR (LLVM)
-        nvidia.init_llvm()
-        context = llvm.context()
-        llvm_mod = llvm.to_module(mod, context)
-        nvidia.set_nvvm_reflect_ftz(llvm_mod)
-        if options.extern_libs:
-            for name, path in options.extern_libs:
-                llvm.link_extern_lib(llvm_mod, path)
-        llvm.optimize_module(llvm_mod, llvm.OPTIMIZE_O3)
+        with _log_time("translate"):
+            nvidia.init_llvm()
+            context = llvm.context()
+            llvm_mod = llvm.to_module(mod, context)
+            nvidia.set_nvvm_reflect_ftz(llvm_mod)
+            machine = llvm.set_target(llvm_mod, *CUDABackend.llvm_target(capability), options.enable_fp_fusion)
+        with _log_time("link"):
+            if options.extern_libs:
+                for name, path in options.extern_libs:
+                    llvm.link_extern_lib(llvm_mod, path)
+        with _log_time("optimize"):
+            unroll_threshold = -1 if options.unroll_threshold is None else options.unroll_threshold
+            llvm.optimize_module(llvm_mod, llvm.OPTIMIZE_O3, machine, unroll_threshold)
         # Get some metadata
         if len(tma_infos) > 0:
             metadata["tensormaps_info"] = parse_tma_info(tma_infos, metadata["ids_of_folded_args"])
@@ -201,16 +238,25 @@ class CUDABackend(BaseBackend):
                 metadata["tensormaps_info"][i].ids_of_folded_args = metadata["ids_of_folded_args"]
         metadata["ids_of_tensormaps"] = get_ids_of_tensormaps(metadata.get("tensormaps_info", None))
         metadata["shared"] = src.get_int_attr("triton_gpu.shared")
-        ret = str(llvm_mod)
-        del llvm_mod
-        del context
-        return ret
+        # Hand the module itself over to `make_ptx`, along with its target
+        # machine: it is only printed when written to the cache, and never
+        # parsed back.
+        return _TargetedModule(llvm_mod, machine)
 
     @staticmethod
-    def make_ptx(src, metadata, opt, capability):
+    def llvm_target(capability):
+        # triple, proc, features and flags of the NVPTX target
         proc = 'sm_90a' if capability == 90 else f'sm_{capability}'
-        ret = llvm.translate_to_asm(src, 'nvptx64-nvidia-cuda', proc, '', ['nvptx-short-ptr'], opt.enable_fp_fusion,
-                                    False)
+        return 'nvptx64-nvidia-cuda', proc, '', ['nvptx-short-ptr']
+
+    @staticmethod
+    def make_ptx(src, metadata, opt, capability):
+        with _log_time("codegen"):
+            if isinstance(src, _TargetedModule):
+                ret = llvm.translate_to_asm(src.module, src.machine, False)
+            else:
+                ret = llvm.translate_to_asm(str(src), *CUDABackend.llvm_target(capability), opt.enable_fp_fusion,
+                                            False)
         # Find kernel names (there should only be one)
         names = re.findall(r".visible .entry ([a-zA-Z_][a-zA-Z0-9_]*)", ret)
         assert len(names) == 1
@@ -278,7 +324,7 @@ class CUDABackend(BaseBackend):
         ids = {
             "ids_of_tensormaps": metadata.get("ids_of_tensormaps", tuple()), "ids_of_folded_args":
             metadata.get("ids_of_folded_args",
-                         tuple()), "ids_of_const_exprs": src.fn.constexprs if hasattr(src, "fn") else tuple()
+                         tuple()), "ids_of_const_exprs": getattr(src, "constexprs", tuple())
         }
         constants = src.constants if hasattr(src, "constants") else dict()
         enable_warp_specialization = False
@@ -2,6 +2,10 @@ from __future__ import annotations
 
 import hashlib
 import json
+import os
+import tempfile
+import threading
+from collections import OrderedDict
 
 from .._C.libtriton import get_env_vars, ir
 # from ..runtime import driver, jit, JITFunction
@@ -113,6 +117,10 @@ class ASTSource:
         key = f"{self.fn.cache_key}-{self.attrs.hash()}-{self.signature.values()}-{self.constants}"
         return hashlib.md5(key.encode("utf-8")).hexdigest()
 
+    @property
+    def constexprs(self):
+        return self.fn.constexprs
+
     def make_ir(self, options, context):
         return ast_to_ttir(self.fn, self, context=context, options=options)
 
@@ -154,12 +162,103 @@ class IRSource:
         return dict()
 
 
+class TTIRSource:
+    """
+    The TTIR that an ASTSource lowers to. Unlike the ASTSource it can be
+    pickled, and compiling it in another process fills the same cache entry as
+    compiling the ASTSource would.
+    """
+
+    def __init__(self, src, target, options):
+        backend = make_backend(target)
+        options = backend.parse_options(dict(options or dict(), **src.parse_options()))
+        context = ir.context()
+        ir.load_dialects(context)
+        backend.load_dialects(context)
+        self.ext = "ttir"
+        self.name = src.name
+        self.signature = src.signature
+        self.constants = src.constants
+        self.constexprs = src.constexprs
+        self.src = src.make_ir(options, context).str()
+        self._hash = src.hash()
+        self._metadata = src.metadata()
+
+    def hash(self):
+        return self._hash
+
+    def make_ir(self, options, context):
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            path = os.path.join(tmp_dir, f"{self.name}.ttir")
+            Path(path).write_text(self.src)
+            module = ir.parse_mlir_module(path, context)
+        module.context = context
+        return module
+
+    def metadata(self):
+        return self._metadata
+
+    def parse_options(self):
+        return dict()
+
+
+class KernelMemoryCache:
+    """Process-wide LRU of compiled kernels keyed by their compile hash, so that
+    JITFunctions and devices compiling the same kernel share one CompiledKernel
+    instead of reloading it from the file cache."""
+
+    def __init__(self, max_entries):
+        self.max_entries = max_entries
+        self.hits = 0
+        self.misses = 0
+        self.bytes = 0
+        self._entries = OrderedDict()
+        self._lock = threading.Lock()
+
+    @staticmethod
+    def _size(kernel):
+        return sum(len(asm) for asm in kernel.asm.values())
+
+    def get(self, key):
+        with self._lock:
+            kernel = self._entries.get(key)
+            if kernel is None:
+                self.misses += 1
+                return None
+            self._entries.move_to_end(key)
+            self.hits += 1
+            return kernel
+
+    def put(self, key, kernel):
+        with self._lock:
+            old = self._entries.pop(key, None)
+            if old is not None:
+                self.bytes -= self._size(old)
+            self._entries[key] = kernel
+            self.bytes += self._size(kernel)
+            while len(self._entries) > self.max_entries:
+                _, evicted = self._entries.popitem(last=False)
+                self.bytes -= self._size(evicted)
+
+    def clear(self):
+        with self._lock:
+            self._entries.clear()
+            self.bytes = 0
+
+    def stats(self):
+        with self._lock:
+            return {"hits": self.hits, "misses": self.misses, "bytes": self.bytes, "entries": len(self._entries)}
+
+
+kernel_cache = KernelMemoryCache(int(os.getenv("TRITON_KERNEL_CACHE_SIZE", "256")))
+
+
 def compile(src, target=None, options=None):
     if target is None:
         target = driver.get_current_target()
     backend = make_backend(target)
     # create backend
-    if not isinstance(src, ASTSource):
+    if not isinstance(src, (ASTSource, TTIRSource)):
         assert isinstance(src, str), "source must be either AST or a filepath"
         src = IRSource(src)
     extra_options = src.parse_options()
@@ -167,6 +266,9 @@ def compile(src, target=None, options=None):
     # create cache manager
     key = f"{src.hash()}-{backend.hash()}-{options.hash()}-{str(sorted(get_env_vars().items()))}"
     hash = hashlib.md5(key.encode("utf-8")).hexdigest()
+    kernel = kernel_cache.get(hash)
+    if kernel is not None:
+        return kernel
     fn_cache_manager = get_cache_manager(hash)
     metadata_filename = f"{src.name}.json"
     metadata_group = fn_cache_manager.get_group(metadata_filename) or {}
@@ -175,7 +277,9 @@ def compile(src, target=None, options=None):
         # cache hit!
         metadata = json.loads(Path(metadata_path).read_text())
         so_path = backend.make_launcher_stub(src, metadata)
-        return CompiledKernel(so_path, metadata_group)
+        kernel = CompiledKernel(so_path, metadata_group)
+        kernel_cache.put(hash, kernel)
+        return kernel
     # initialize metadata
     metadata = {
         "target": target,
@@ -201,7 +305,27 @@ def compile(src, target=None, options=None):
     fn_cache_manager.put_group(metadata_filename, metadata_group)
     so_path = backend.make_launcher_stub(src, metadata)
     # return handle to compiled kernel
-    return CompiledKernel(so_path, metadata_group)
+    kernel = CompiledKernel(so_path, metadata_group)
+    kernel_cache.put(hash, kernel)
+    return kernel
+
+
+_launchers = dict()
+_launchers_lock = threading.Lock()
+
+
+def _load_launcher(so_path):
+    # launchers only depend on the kernel signature, so many kernels share
+    # the same module and it only needs to be imported once
+    with _launchers_lock:
+        launcher = _launchers.get(so_path)
+        if launcher is None:
+            import importlib.util
+            spec = importlib.util.spec_from_file_location("__triton_launcher", so_path)
+            mod = importlib.util.module_from_spec(spec)
+            spec.loader.exec_module(mod)
+            launcher = _launchers[so_path] = getattr(mod, "launch")
+        return launcher
 
 
 class CompiledKernel:
@@ -214,11 +338,7 @@ class CompiledKernel:
     def __init__(self, so_path, metadata_group):
         metadata_path = next((Path(p) for c, p in metadata_group.items() if c.endswith(".json")))
         # initialize launcher
-        import importlib.util
-        spec = importlib.util.spec_from_file_location("__triton_launcher", so_path)
-        mod = importlib.util.module_from_spec(spec)
-        spec.loader.exec_module(mod)
-        self.run = getattr(mod, "launch")
+        self.launcher = _load_launcher(so_path)
         # initialize metadata
         self.metadata = json.loads(metadata_path.read_text())
         self.metadata['tensormaps_info'] = [InfoFromBackendForTensorMap(e) for e in self.metadata['tensormaps_info']
@@ -227,7 +347,10 @@ class CompiledKernel:
             self.metadata["tensormaps_info"][i].ids_of_folded_args = tuple(self.metadata["ids_of_folded_args"])
         self.name = self.metadata["name"]
         for key, val in self.metadata.items():
-            setattr(self, key, val)
+            # the device handles are read-only properties, whatever the
+            # metadata holds under their names
+            if not isinstance(getattr(CompiledKernel, key, None), property):
+                setattr(self, key, val)
         # stores the text of each level of IR that was generated during compilation
         asm_files = [Path(p) for c, p in metadata_group.items() if not c.endswith(".json")]
         self.asm = {
@@ -238,36 +361,65 @@ class CompiledKernel:
         # binaries are lazily initialized
         # because it involves doing runtime things
         # (e.g., checking amount of shared memory on current device)
-        self.module = None
-        self.function = None
-
-    def _init_handles(self):
-        if self.module is not None:
-            return
-        device = driver.get_current_device()
-        # not enough shared memory to run the kernel
-        max_shared = driver.utils.get_device_properties(device)["max_shared_mem"]
-        if self.shared > max_shared:
-            raise OutOfResources(self.shared, max_shared, "shared memory")
-        # TODO: n_regs, n_spills should be metadata generated when calling `ptxas`
-        self.module, self.function, self.n_regs, self.n_spills = driver.utils.load_binary(
-            self.name, self.kernel, self.shared, device)
-
-    def __getattribute__(self, name):
-        if name == 'run':
-            self._init_handles()
-        return super().__getattribute__(name)
+        # the kernel may be shared by launches on several devices and threads,
+        # so each device gets its own handles and they are never swapped into
+        # attributes of the kernel
+        self.device_handles = dict()
+        self._handles_lock = threading.Lock()
+
+    def _init_handles(self, device=None):
+        """Returns the (module, function, n_regs, n_spills) of the kernel on
+        `device`, loading the binary on that device if needed."""
+        if device is None:
+            device = driver.get_current_device()
+        handles = self.device_handles.get(device)
+        if handles is not None:
+            return handles
+        with self._handles_lock:
+            handles = self.device_handles.get(device)
+            if handles is None:
+                # not enough shared memory to run the kernel
+                max_shared = driver.utils.get_device_properties(device)["max_shared_mem"]
+                if self.shared > max_shared:
+                    raise OutOfResources(self.shared, max_shared, "shared memory")
+                # TODO: n_regs, n_spills should be metadata generated when calling `ptxas`
+                handles = driver.utils.load_binary(self.name, self.kernel, self.shared, device)
+                self.device_handles[device] = handles
+        return handles
+
+    # handles of the kernel on the current device
+    @property
+    def module(self):
+        return self._init_handles()[0]
+
+    @property
+    def function(self):
+        return self._init_handles()[1]
+
+    @property
+    def n_regs(self):
+        return self._init_handles()[2]
+
+    @property
+    def n_spills(self):
+        return self._init_handles()[3]
+
+    @property
+    def run(self):
+        self._init_handles()
+        return self.launcher
 
     def __getitem__(self, grid):
         self._init_handles()
 
         def runner(*args, stream=None):
             args_expand = driver.assemble_tensormap_to_arg(self.tensormaps_info, args)
+            device = driver.get_current_device()
             if stream is None:
-                device = driver.get_current_device()
                 stream = driver.get_current_stream(device)
-            self.run(grid[0], grid[1], grid[2], self.num_warps, self.num_ctas, self.cluster_dims[0],
-                     self.cluster_dims[1], self.cluster_dims[2], self.shared, stream, self.function,
-                     CompiledKernel.launch_enter_hook, CompiledKernel.launch_exit_hook, self, *args_expand)
+            function = self._init_handles(device)[1]
+            self.launcher(grid[0], grid[1], grid[2], self.num_warps, self.num_ctas, self.cluster_dims[0],
+                          self.cluster_dims[1], self.cluster_dims[2], self.shared, stream, function,
+                          CompiledKernel.launch_enter_hook, CompiledKernel.launch_exit_hook, self, *args_expand)
 
         return runner
@@ -30,6 +30,7 @@ from .core import (
     advance,
     arange,
     associative_scan,
+    assume_range,
     atomic_add,
     atomic_and,
     atomic_cas,
@@ -121,6 +122,7 @@ __all__ = [
     "argmin",
     "argmax",
     "associative_scan",
+    "assume_range",
     "atomic_add",
     "atomic_and",
     "atomic_cas",
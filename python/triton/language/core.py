@@ -1627,6 +1627,30 @@ def max_constancy(input, values, _builder=None):
     return semantic.max_constancy(input, values)
 
 
+@builtin
+def assume_range(input, min=None, max=None, _builder=None):
+    """
+    Let the compiler know that the values in :code:`input` are all between :code:`min` and :code:`max`, inclusive.
+
+    Comparisons, e.g. in masks, that always hold or always fail within these bounds are folded away.
+
+    :param input: the integer tensor, e.g. a kernel argument or a program id
+    :param min: the smallest value, or None if unknown
+    :type min: constexpr[int], optional
+    :param max: the largest value, or None if unknown
+    :type max: constexpr[int], optional
+    """
+    bounds = []
+    for name, bound in (("min", min), ("max", max)):
+        if bound is not None and not isinstance(bound, constexpr):
+            raise TypeError(f"{name} must have type `constexpr`")
+        bound = _constexpr_to_value(bound)
+        if bound is not None and not isinstance(bound, int):
+            raise TypeError(f"{name} must have type `constexpr[int]`, got `constexpr[{type(bound)}]")
+        bounds.append(bound)
+    return semantic.assume_range(input, *bounds, _builder)
+
+
 # -----------------------
 # Debugging functions
 # -----------------------
@@ -1377,9 +1377,9 @@ def reduction(inputs: Sequence[tl.tensor], axis: int, region_builder_fn, builder
 
 def associative_scan(inputs: Sequence[tl.tensor], axis: int, region_builder_fn,
                      builder: ir.builder) -> Tuple[tl.tensor, ...]:
-    if len(inputs) != 1:
-        raise ValueError("Current implementation only support single tensor input")
     shape = inputs[0].type.shape
+    for t in inputs:
+        assert t.type.shape == shape, "all scan inputs must have the same shape"
 
     def wrap_tensor(x, scalar_ty):
         res_ty = tl.block_type(scalar_ty, shape)
@@ -1497,6 +1497,24 @@ def max_constancy(x: tl.tensor, values: List[int]) -> tl.tensor:
     return x
 
 
+def assume_range(x: tl.tensor, min: Optional[int], max: Optional[int], builder: ir.builder) -> tl.tensor:
+    if not x.type.scalar.is_int():
+        raise ValueError(f"Input to assume_range must be an integer, got {x.type.scalar}")
+    # the compiler reads the bounds as signed values of the input's width
+    width = x.type.scalar.primitive_bitwidth
+    lo, hi = -(1 << (width - 1)), (1 << (width - 1)) - 1
+    for name, bound in (("min", min), ("max", max)):
+        if bound is not None and not lo <= bound <= hi:
+            raise ValueError(f"{name} of assume_range must be in [{lo}, {hi}] for {x.type.scalar}, got {bound}")
+    if min is not None and max is not None and min > max:
+        raise ValueError(f"min of assume_range must not be larger than max, got [{min}, {max}]")
+    if min is not None:
+        x.handle.set_attr("tt.min_value", builder.get_int64_attr(min))
+    if max is not None:
+        x.handle.set_attr("tt.max_value", builder.get_int64_attr(max))
+    return x
+
+
 def debug_barrier(builder: ir.builder) -> tl.tensor:
     return tl.tensor(builder.create_barrier(), tl.void)
 
@@ -1,11 +1,21 @@
 from __future__ import annotations
 
 import builtins
+import hashlib
+import json
+import multiprocessing
+import os
+import threading
 import time
+import warnings
+from concurrent.futures import ProcessPoolExecutor
+from concurrent.futures.process import BrokenProcessPool
 from typing import Dict
 
 from ..testing import do_bench
-from .jit import KernelInterface
+from .cache import get_cache_manager
+from .driver import driver
+from .jit import JITFunction, KernelInterface
 
 
 class OutOfResources(Exception):
@@ -23,6 +33,44 @@ class OutOfResources(Exception):
         return (type(self), (self.required, self.limit, self.name))
 
 
+def _precompile_worker(job):
+    from ..compiler import compile
+    src, target, options = job
+    try:
+        compile(src, target=target, options=options)
+    except Exception as e:
+        return f"{type(e).__name__}: {e}"
+    return None
+
+
+_precompile_pool = None
+_precompile_pool_lock = threading.Lock()
+
+
+def _get_precompile_pool(num_workers):
+    # spawned workers import the main module again, so the pool is created once
+    # and shared by all autotuners rather than once per tuning key
+    global _precompile_pool
+    with _precompile_pool_lock:
+        if _precompile_pool is not None and _precompile_pool[0] != num_workers:
+            _precompile_pool[1].shutdown(wait=False)
+            _precompile_pool = None
+        if _precompile_pool is None:
+            # workers are spawned: forking a process that initialized CUDA and
+            # runs other threads may deadlock on locks those threads hold
+            ctx = multiprocessing.get_context("spawn")
+            _precompile_pool = (num_workers, ProcessPoolExecutor(num_workers, mp_context=ctx))
+        return _precompile_pool[1]
+
+
+def _drop_precompile_pool(pool):
+    global _precompile_pool
+    with _precompile_pool_lock:
+        if _precompile_pool is not None and _precompile_pool[1] is pool:
+            _precompile_pool = None
+    pool.shutdown(wait=False)
+
+
 class Autotuner(KernelInterface):
 
     def __init__(
@@ -36,12 +84,14 @@ class Autotuner(KernelInterface):
         prune_configs_by: Dict = None,
         warmup=25,
         rep=100,
+        cache_results=False,
     ):
         """
         :param prune_configs_by: a dict of functions that are used to prune configs, fields:
             'perf_model': performance model used to predicate running time with different configs, returns running time
             'top_k': number of configs to bench
             'prune_num_stages_by'(optional): a function used to prune num_stages. It takes configs:List[Config] as its input, and returns pruned configs.
+        :param cache_results: persist the tuning results in the cache dir, also enabled by `TRITON_CACHE_AUTOTUNING=1`
         """
         if not configs:
             self.configs = [Config({}, num_warps=4, num_stages=2, num_ctas=1)]
@@ -91,6 +141,8 @@ class Autotuner(KernelInterface):
         self.fn = fn
         self.num_warmups = warmup
         self.num_reps = rep
+        self.compile_errors = {}
+        self.cache_results = cache_results or os.getenv("TRITON_CACHE_AUTOTUNING", "0") == "1"
 
     def _bench(self, *args, config, **meta):
         # check for conflicts, i.e. meta-parameters both provided
@@ -137,9 +189,14 @@ class Autotuner(KernelInterface):
                 if hasattr(arg, "dtype"):
                     key.append(str(arg.dtype))
             key = tuple(key)
+            if key not in self.cache and self.cache_results:
+                self._load_results(key, kwargs)
             if key not in self.cache:
                 # prune configs
                 pruned_configs = self.prune_configs(kwargs)
+                if len(pruned_configs) > 1 and hasattr(self.fn, "compile_args"):
+                    # if no config compiles, benchmarking them raises the error
+                    pruned_configs = self.precompile(*args, configs=pruned_configs, **kwargs) or pruned_configs
                 bench_start = time.time()
                 timings = {config: self._bench(*args, config=config, **kwargs) for config in pruned_configs}
                 bench_end = time.time()
@@ -147,6 +204,8 @@ class Autotuner(KernelInterface):
                 self.cache[key] = builtins.min(timings, key=timings.get)
                 self.pre_hook(args, reset_only=True)
                 self.configs_timings = timings
+                if self.cache_results:
+                    self._save_results(key, timings)
             config = self.cache[key]
         else:
             config = self.configs[0]
@@ -166,6 +225,74 @@ class Autotuner(KernelInterface):
         self.nargs = None
         return ret
 
+    def _results_cache(self, key):
+        from ..compiler.backends import make_backend
+        fn = self.fn
+        while not isinstance(fn, JITFunction):
+            fn = getattr(fn, "fn", None)
+            if fn is None:
+                return None, None, None
+        # results are only valid for the same kernel source, configs and
+        # hardware, so all of them go into the cache directory name
+        backend_hash = make_backend(driver.get_current_target()).hash()
+        configs = [str(config) for config in self.configs]
+        cache_key = f"{fn.cache_key}-{backend_hash}-{configs}"
+        fn_cache_manager = get_cache_manager(hashlib.md5(cache_key.encode("utf-8")).hexdigest())
+        filename = f"{fn.__name__}-{hashlib.md5(str(key).encode('utf-8')).hexdigest()}.autotune.json"
+        return fn_cache_manager, filename, backend_hash
+
+    @staticmethod
+    def _config_key(fields):
+        return json.dumps(fields, sort_keys=True, default=str)
+
+    @staticmethod
+    def _config_fields(config):
+        # configs are stored by value: pruning hooks may return new Config
+        # objects that are not in `self.configs`
+        return {
+            "kwargs": config.kwargs,
+            "num_warps": config.num_warps,
+            "num_stages": config.num_stages,
+            "num_ctas": config.num_ctas,
+            "enable_warp_specialization": config.enable_warp_specialization,
+        }
+
+    def _load_results(self, key, kwargs):
+        fn_cache_manager, filename, backend_hash = self._results_cache(key)
+        if fn_cache_manager is None:
+            return
+        path = fn_cache_manager.get_file(filename)
+        if path is None:
+            return
+        with open(path) as f:
+            results = json.load(f)
+        if results.get("key") != str(key) or results.get("backend") != backend_hash:
+            return
+        best = self._config_key(results["best"])
+        timings = [(self._config_key(fields), timing) for fields, timing in results["timings"]]
+        configs = {self._config_key(self._config_fields(config)): config for config in self.configs}
+        if best not in configs or any(k not in configs for k, _ in timings):
+            # the configs were returned by a pruning hook
+            for config in self.prune_configs(kwargs):
+                configs.setdefault(self._config_key(self._config_fields(config)), config)
+        if best not in configs:
+            return
+        self.cache[key] = configs[best]
+        self.configs_timings = {configs[k]: timing for k, timing in timings if k in configs}
+        self.bench_time = 0
+
+    def _save_results(self, key, timings):
+        fn_cache_manager, filename, backend_hash = self._results_cache(key)
+        if fn_cache_manager is None:
+            return
+        results = {
+            "key": str(key),
+            "backend": backend_hash,
+            "best": self._config_fields(self.cache[key]),
+            "timings": [[self._config_fields(config), timing] for config, timing in timings.items()],
+        }
+        fn_cache_manager.put(json.dumps(results, default=str), filename, binary=False)
+
     def prune_configs(self, kwargs):
         pruned_configs = self.configs
         if self.early_config_prune:
@@ -193,6 +320,72 @@ class Autotuner(KernelInterface):
                 pruned_configs = sorted(est_timing.keys(), key=lambda x: est_timing[x])[:top_k]
         return pruned_configs
 
+    def precompile(self, *args, configs=None, num_workers=None, **kwargs):
+        """
+        Compiles `configs` (all configs by default) for the given arguments,
+        filling the file cache so that benchmarking them only has to load the
+        binaries.
+
+        With more than one worker, each config is lowered to TTIR in this
+        process and the rest of the pipeline runs in a pool of spawned
+        processes, shared by all autotuners. Like any `multiprocessing` spawn,
+        the workers import the main module when they start.
+
+        Configs that fail to compile for these arguments are dropped from the
+        returned list and their errors are recorded in `self.compile_errors`,
+        which only holds the errors of the last call.
+
+        :param num_workers: number of worker processes, defaults to
+            `TRITON_PRECOMPILE_NUM_WORKERS` or 1, which compiles in this process.
+        """
+        if configs is None:
+            configs = self.configs
+        if num_workers is None:
+            num_workers = int(os.getenv("TRITON_PRECOMPILE_NUM_WORKERS", "1"))
+        use_pool = num_workers > 1 and len(configs) > 1
+        from ..compiler import TTIRSource
+        self.compile_errors = dict()
+        jobs = dict()
+        for config in configs:
+            try:
+                src, target, options = self.fn.compile_args(
+                    *args,
+                    num_warps=config.num_warps,
+                    num_stages=config.num_stages,
+                    num_ctas=config.num_ctas,
+                    enable_warp_specialization=config.enable_warp_specialization,
+                    **dict(kwargs, **config.kwargs),
+                )
+                if use_pool:
+                    # the front-end needs the JITFunction, so it runs here and
+                    # the workers receive the (picklable) TTIR
+                    src = TTIRSource(src, target, options)
+                jobs[config] = (src, target, options)
+            except Exception as e:
+                self.compile_errors[config] = f"{type(e).__name__}: {e}"
+        errors = dict()
+        if use_pool and len(jobs) > 1:
+            pool = _get_precompile_pool(num_workers)
+            broken = False
+            try:
+                futures = {config: pool.submit(_precompile_worker, job) for config, job in jobs.items()}
+                for config, future in futures.items():
+                    try:
+                        errors[config] = future.result()
+                    except BrokenProcessPool:
+                        broken = True
+            except BrokenProcessPool:
+                broken = True
+            if broken:
+                # e.g. the main module cannot be imported by the workers
+                warnings.warn("precompilation workers died, compiling the remaining configs in this process")
+                _drop_precompile_pool(pool)
+        for config, job in jobs.items():
+            error = errors[config] if config in errors else _precompile_worker(job)
+            if error is not None:
+                self.compile_errors[config] = error
+        return [config for config in configs if config not in self.compile_errors]
+
     def warmup(self, *args, **kwargs):
         self.nargs = dict(zip(self.arg_names, args))
         ret = []
@@ -255,7 +448,8 @@ class Config:
         return ", ".join(res)
 
 
-def autotune(configs, key, prune_configs_by=None, reset_to_zero=None, restore_value=None, warmup=25, rep=100):
+def autotune(configs, key, prune_configs_by=None, reset_to_zero=None, restore_value=None, warmup=25, rep=100,
+             cache_results=False):
     """
     Decorator for auto-tuning a :code:`triton.jit`'d function.
 
@@ -292,10 +486,15 @@ def autotune(configs, key, prune_configs_by=None, reset_to_zero=None, restore_va
     :type warmup: int
     :param rep: Repetition time (in ms) to pass to benchmarking, defaults to 100.
     :type rep: int
+    :param cache_results: whether to store the tuning results in the cache dir, so that later processes running on
+        the same hardware reuse them instead of benchmarking again. Results are discarded when the kernel source, the
+        configs or the backend change. Can also be enabled for all kernels with `TRITON_CACHE_AUTOTUNING=1`.
+    :type cache_results: bool
     """
 
     def decorator(fn):
-        return Autotuner(fn, fn.arg_names, configs, key, reset_to_zero, restore_value, prune_configs_by, warmup, rep)
+        return Autotuner(fn, fn.arg_names, configs, key, reset_to_zero, restore_value, prune_configs_by, warmup, rep,
+                         cache_results)
 
     return decorator
 
@@ -312,6 +511,11 @@ class Heuristics(KernelInterface):
             kwargs[v] = heur({**dict(zip(self.arg_names, args)), **kwargs})
         return self.fn.run(*args, **kwargs)
 
+    def compile_args(self, *args, **kwargs):
+        for v, heur in self.values.items():
+            kwargs[v] = heur({**dict(zip(self.arg_names, args)), **kwargs})
+        return self.fn.compile_args(*args, **kwargs)
+
 
 def heuristics(values):
     """
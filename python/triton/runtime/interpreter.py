@@ -1,4 +1,8 @@
 import inspect
+import os
+import threading
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import dataclass
 
 import numpy as np
 
@@ -37,6 +41,9 @@ def str_to_ty(name):
 
 
 class TensorHandle:
+    # `data` holds one value per program of the batch being executed along its
+    # leading axis, which has size 1 when all programs share the value. Scalars
+    # are 1d and blocks keep their shape after the leading axis.
 
     def __init__(self, data, dtype):
         self.data = data
@@ -60,17 +67,23 @@ class BlockPointerHandle:
         dtype_tt = self.base.dtype.element_ty
         n_bytes = dtype_tt.primitive_bitwidth // 8
         tensor_shape = self.tensor_shape
-        ptrs = np.broadcast_to(self.base.data, self.tensor_shape)
-        masks = np.ones(self.tensor_shape, dtype=bool)
-        for dim in range(len(tensor_shape)):
-            bcast_dims = [1] * len(tensor_shape)
-            bcast_dims[dim] = tensor_shape[dim]
-            off = (self.offsets[dim].data + np.arange(tensor_shape[dim])).reshape(bcast_dims)
-            ptrs = ptrs + (n_bytes * off * self.strides[dim].data).astype(np.uint64)
+        rank = len(tensor_shape)
+
+        # broadcasts a scalar of each program against the block
+        def per_program(handle):
+            return handle.data.reshape((-1, ) + (1, ) * rank)
+
+        ptrs = per_program(self.base)
+        masks = np.ones((1, ) + tuple(tensor_shape), dtype=bool)
+        for dim in range(rank):
+            bcast_dims = [1] * (rank + 1)
+            bcast_dims[dim + 1] = tensor_shape[dim]
+            off = per_program(self.offsets[dim]) + np.arange(tensor_shape[dim]).reshape(bcast_dims)
+            ptrs = ptrs + (n_bytes * off * per_program(self.strides[dim])).astype(np.uint64)
             if dim in boundary_check:
-                masks = np.logical_and(masks, off < self.shape[dim].data)
-        ptrs = TensorHandle(ptrs, self.base.dtype)
-        return ptrs, masks
+                masks = np.logical_and(masks, off < per_program(self.shape[dim]))
+        ptrs, masks = np.broadcast_arrays(ptrs, masks)
+        return TensorHandle(ptrs, self.base.dtype), TensorHandle(masks, tl.int1)
 
 
 def wrap_ret(compute_ret_ty):
@@ -86,25 +99,46 @@ def wrap_ret(compute_ret_ty):
     return wrapper
 
 
+@dataclass(frozen=True)
+class InterpreterOptions:
+    # the subset of the backend options consulted by the frontend
+    allow_fp8e4nv: bool = False
+    max_num_imprecise_acc_default: int = 0
+
+
 class Builder:
 
     def __init__(self) -> None:
         self.arch = None
-        # pass
+        self.options = InterpreterOptions()
+        # programs of a grid may run on different threads, so the programs
+        # being executed are tracked per thread
+        self._local = threading.local()
+
+    @property
+    def grid_idx(self):
+        """Indices of the programs being executed, one (x, y, z) row each."""
+        return getattr(self._local, "grid_idx", None)
+
+    @property
+    def grid_dim(self):
+        return getattr(self._local, "grid_dim", None)
 
     def set_grid_idx(self, x, y, z):
-        assert x < self.grid_dim[0]
-        assert y < self.grid_dim[1]
-        assert z < self.grid_dim[2]
-        self.grid_idx = (x, y, z)
+        self.set_grid_idxs(np.array([[x, y, z]]))
+
+    def set_grid_idxs(self, grid_idxs):
+        assert (grid_idxs < np.array(self.grid_dim)).all()
+        self._local.grid_idx = grid_idxs
 
     def set_grid_dim(self, nx, ny, nz):
-        self.grid_dim = (nx, ny, nz)
+        self._local.grid_dim = (nx, ny, nz)
 
     def np_dtype(self, tt_dtype):
         if isinstance(tt_dtype, tl.pointer_type):
             return np.dtype(np.uint64)
         np_types = {
+            tl.int1: np.dtype(bool),
             tl.float16: np.dtype(np.float16),
             tl.float32: np.dtype(np.float32),
             tl.float64: np.dtype(np.float64),
@@ -135,6 +169,9 @@ class Builder:
     def get_block_ty(self, dtype, shape):
         return tl.tensor(shape, dtype)
 
+    def get_int1(self, value):
+        return TensorHandle(np.array([value], dtype=bool), tl.int1)
+
     def get_int32(self, value):
         return TensorHandle(np.array([value], dtype=np.int32), tl.int32)
 
@@ -153,7 +190,7 @@ class Builder:
     # programming model
     def create_get_program_id(self, axis):
         assert self.grid_idx is not None
-        return TensorHandle(np.array([self.grid_idx[axis]], dtype=np.int32), tl.int32)
+        return TensorHandle(self.grid_idx[:, axis].astype(np.int32), tl.int32)
 
     def create_get_num_programs(self, axis):
         return TensorHandle(np.array([self.grid_dim[axis]], dtype=np.int32), tl.int32)
@@ -173,11 +210,12 @@ class Builder:
         dtype_np = self.np_dtype(dtype_tt)
         if other is None:
             other = TensorHandle(np.ones_like(ptrs.data, dtype=dtype_np), dtype_tt)
-        ret = _interpreter.load(ptrs.data, mask.data, other.data, dtype_np)
+        ptrs, mask, other = np.broadcast_arrays(ptrs.data, mask.data, other.data)
+        ret = _interpreter.load(ptrs, mask, other, dtype_np)
         return TensorHandle(ret, dtype_tt)
 
     def create_masked_store(self, ptrs, value, mask, cache_modifier, eviction_policy):
-        return _interpreter.store(ptrs.data, value.data, mask.data)
+        return _interpreter.store(*np.broadcast_arrays(ptrs.data, value.data, mask.data))
 
     # casting ops
     def cast_impl(self, src, dst_type):
@@ -270,14 +308,16 @@ class Builder:
 
     # tensor operators
     create_dot = lambda self, lhs, rhs: self.binary_op(lhs, rhs, np.dot)
-    create_reshape = lambda self, arg, shape, allowReorder: TensorHandle(arg.data.reshape(shape), arg.dtype)
-    create_trans = lambda self, arg: self.unary_op(arg, np.transpose)
+    create_trans = lambda self, arg: self.unary_op(arg, lambda data: np.swapaxes(data, -1, -2))
+
+    def create_reshape(self, arg, shape, allowReorder):
+        return TensorHandle(arg.data.reshape((arg.data.shape[0], ) + tuple(shape)), arg.dtype)
 
     def create_dot(self, a, b, d, allow_tf32, maxNumImpreciseAcc):
-        return TensorHandle(np.dot(a.data, b.data) + d.data, a.dtype)
+        return TensorHandle(np.matmul(a.data, b.data) + d.data, a.dtype)
 
     def create_make_range(self, start, stop):
-        return TensorHandle(np.arange(start, stop, dtype=np.int32), tl.int32)
+        return TensorHandle(np.arange(start, stop, dtype=np.int32)[np.newaxis], tl.int32)
 
     # pointer arithmetic
 
@@ -297,10 +337,10 @@ class Builder:
         return self.create_masked_store(ptrs, value, masks, cache_modifier, eviction_policy)
 
     def create_expand_dims(self, arg, axis):
-        return TensorHandle(np.expand_dims(arg.data, axis), arg.dtype)
+        return TensorHandle(np.expand_dims(arg.data, axis + 1), arg.dtype)
 
     def create_broadcast(self, arg, shape):
-        return TensorHandle(np.broadcast_to(arg.data, shape), arg.dtype)
+        return TensorHandle(np.broadcast_to(arg.data, (arg.data.shape[0], ) + tuple(shape)), arg.dtype)
 
     def create_int_to_ptr(self, val, dst_ty):
         return TensorHandle(val.data.astype(np.uint64), dst_ty)
@@ -312,13 +352,24 @@ class Builder:
     #     pass
 
     def create_splat(self, arg, shape):
-        return TensorHandle(np.full(shape, arg.data[0], dtype=self.np_dtype(arg.dtype)), arg.dtype)
+        data = arg.data.reshape((-1, ) + (1, ) * len(shape))
+        return TensorHandle(np.broadcast_to(data, (data.shape[0], ) + tuple(shape)), arg.dtype)
 
-    # def create_atomic_cas(self, ptr, cmp, val, sem):
-    #     pass
+    # atomic ops
+    def _broadcast_programs(self, *data):
+        # values shared by the programs of a batch are expanded so that every
+        # program performs its own side effect
+        shape = np.broadcast_shapes(*(d.shape for d in data))
+        shape = (len(self.grid_idx), ) + shape[1:]
+        return [np.broadcast_to(d, shape) for d in data]
 
-    # def create_atomic_rmw(self, rmwOp, ptr, val, mask, sem):
-    #     pass
+    def create_atomic_cas(self, ptr, cmp, val, sem, scope):
+        ret = _interpreter.atomic_cas(*self._broadcast_programs(ptr.data, cmp.data, val.data))
+        return TensorHandle(ret, val.dtype)
+
+    def create_atomic_rmw(self, rmwOp, ptr, val, mask, sem, scope):
+        ret = _interpreter.atomic_rmw(rmwOp, *self._broadcast_programs(ptr.data, val.data, mask.data))
+        return TensorHandle(ret, val.dtype)
 
     # def create_extern_elementwise(self, libName, libPath, symbol, argList, retType, isPure):
     #     pass
@@ -344,27 +395,42 @@ class Builder:
     # def create_inline_asm(self, inlineAsm, constraints, values, type, isPure, pack):
     #     pass
 
-    # def create_print(self, prefix, values):
-    #     pass
-
-    # def create_assert(self, condition, message, fileName, funcName, lineNo):
-    #     pass
+    def create_print(self, prefix, values):
+        # same format as the GPU lowering, built as a single string so that the
+        # lines of programs running on different threads do not interleave
+        lines = []
+        for program, grid_idx in enumerate(self.grid_idx):
+            pid = ", ".join(str(idx) for idx in grid_idx)
+            for operand, value in enumerate(values):
+                operand_str = f"(operand {operand}) " if len(values) > 1 else ""
+                data = value.data[program if len(value.data) > 1 else 0]
+                for idx in np.ndindex(data.shape):
+                    idx_str = ", ".join(str(i) for i in idx)
+                    lines.append(f"pid ({pid}) idx ({idx_str}){prefix}{operand_str}{data[idx]}")
+        print("\n".join(lines), flush=True)
+
+    def create_assert(self, condition, message, fileName, funcName, lineNo):
+        passed = np.all(condition.data.reshape(len(condition.data), -1), axis=1)
+        if not passed.all():
+            program = np.argmin(passed) if len(passed) > 1 else 0
+            pid = ", ".join(str(idx) for idx in self.grid_idx[program])
+            raise AssertionError(f"{fileName}:{lineNo}: {funcName}: block: [{pid}] Assertion `{message}` failed.")
 
     # def create_undef(self, type):
     #     pass
 
-    # def create_barrier(self):
-    #     pass
+    def create_barrier(self):
+        # programs run one at a time on a single thread each, so there is
+        # nothing to synchronize
+        pass
 
     def create_make_block_ptr(self, base, shape, strides, offsets, tensor_shape, order):
         return BlockPointerHandle(base, shape, strides, np.array(offsets), tensor_shape, order)
 
     def create_advance(self, ptr, offsets):
         assert len(ptr.offsets) == len(offsets)
-        ret = BlockPointerHandle(ptr.base, ptr.shape, ptr.strides, ptr.offsets, ptr.tensor_shape, ptr.order)
-        for i in range(len(offsets)):
-            ret.offsets[i].data += offsets[i].data
-        return ret
+        offsets = [TensorHandle(offset.data + delta.data, offset.dtype) for offset, delta in zip(ptr.offsets, offsets)]
+        return BlockPointerHandle(ptr.base, ptr.shape, ptr.strides, offsets, ptr.tensor_shape, ptr.order)
 
 
 def patch_attr(obj, name, member, builder):
@@ -375,34 +441,152 @@ def patch_attr(obj, name, member, builder):
     setattr(obj, name, new_member)
 
 
+class _DivergentPrograms(Exception):
+    """Raised when programs executed together need different Python control
+    flow, e.g. loop bounds that depend on the program id."""
+
+
+def _uniform_scalar(tensor):
+    """Returns the value of a scalar shared by all the programs executed
+    together, or raises _DivergentPrograms if they disagree on it."""
+    data = tensor.handle.data
+    if data.ndim != 1:
+        raise ValueError("the truth value or index of a block is ambiguous")
+    if len(data) > 1 and np.any(data != data[0]):
+        raise _DivergentPrograms()
+    return data[0]
+
+
+def _tensor_index(tensor):
+    return int(_uniform_scalar(tensor))
+
+
+def _tensor_bool(tensor):
+    return bool(_uniform_scalar(tensor))
+
+
 def _patch_lang_tensor(tensor, builder):
     for name, member in inspect.getmembers(tensor):
         if tl.core.is_builtin(member):
             patch_attr(tensor, name, member, builder)
-    tensor.__index__ = lambda self: int(self.handle.data)
-    tensor.__bool__ = lambda self: True
+    tensor.__index__ = _tensor_index
+    tensor.__bool__ = _tensor_bool
     tensor.__str__ = lambda self: str(self.handle.data)
-    tensor.__getitem__ = lambda self, slices: self.handle.data.__getitem__(slices)
+
+
+def _wrap_data(data, dtype):
+    if data.ndim == 1:
+        # 0d-tensor -> scalar
+        return tl.core.tensor(TensorHandle(data, dtype), dtype)
+    return tl.core.tensor(TensorHandle(data, dtype), tl.block_type(dtype, list(data.shape[1:])))
+
+
+def _combine_ufunc(combine_fn):
+    """Returns the numpy ufunc equivalent to `combine_fn`, if there is one."""
+    fn = getattr(combine_fn, "fn", combine_fn)
+    standard = tl.standard
+    ufuncs = {
+        standard._sum_combine: np.add,
+        standard._prod_combine: np.multiply,
+        standard._xor_combine: np.bitwise_xor,
+        standard.maximum: np.maximum,
+        standard.minimum: np.minimum,
+    }
+    for combine, ufunc in ufuncs.items():
+        if fn is getattr(combine, "fn", combine):
+            return ufunc
+    return None
+
+
+def _combine(combine_fn, lhs, rhs, dtypes):
+    args = [_wrap_data(data, dtype) for data, dtype in zip(lhs + rhs, dtypes + dtypes)]
+    rets = combine_fn(*args)
+    rets = [rets] if isinstance(rets, tl.core.tensor) else rets
+    # results that do not depend on the arguments may not have been broadcast
+    return [np.broadcast_to(ret.handle.data, lhs[0].shape) for ret in rets], [ret.dtype for ret in rets]
+
+
+def _reduce_tree(data, dtypes, axis, combine_fn):
+    """Reduces `data` along `axis` by combining adjacent pairs of elements,
+    which only takes a logarithmic number of calls to `combine_fn`."""
+    data = [np.moveaxis(d, axis, -1) for d in data]
+    while data[0].shape[-1] > 1:
+        even = data[0].shape[-1] // 2 * 2
+        lhs = [d[..., 0:even:2] for d in data]
+        rhs = [d[..., 1:even:2] for d in data]
+        combined, dtypes = _combine(combine_fn, lhs, rhs, dtypes)
+        data = [np.concatenate([c, d[..., even:].astype(c.dtype)], axis=-1) for c, d in zip(combined, data)]
+    return [d[..., 0] for d in data], dtypes
+
+
+def _scan_tree(data, dtypes, axis, combine_fn):
+    """Computes the inclusive scan of `data` along `axis`, doubling the span
+    covered by each element at every step (Hillis-Steele)."""
+    data = [np.moveaxis(d, axis, -1) for d in data]
+    n = data[0].shape[-1]
+    offset = 1
+    while offset < n:
+        lhs = [d[..., :n - offset] for d in data]
+        rhs = [d[..., offset:] for d in data]
+        combined, dtypes = _combine(combine_fn, lhs, rhs, dtypes)
+        data = [np.concatenate([d[..., :offset].astype(c.dtype), c], axis=-1) for c, d in zip(combined, data)]
+        offset *= 2
+    return [np.moveaxis(d, -1, axis) for d in data], dtypes
 
 
 def _patch_lang_core(lang, builder):
     for name, member in inspect.getmembers(lang):
         if tl.core.is_builtin(member):
             patch_attr(lang, name, member, builder)
-    # reduce is better off with a separate patch due to how
-    # the builder currently interfaces with custom functions
-
-    def _new_reduce(input, axis, combine_fn):
-        fn = combine_fn.fn.__name__
-        mapping = {
-            "maximum": np.max,
-            "_sum_combine": np.sum,
-        }
-        ret = mapping[fn](input.handle.data, axis=axis)
-        ret_type = tl.block_type(input.dtype, ret.shape)
-        return tl.core.tensor(TensorHandle(ret, input.dtype), ret_type)
+    # reduce and scan are better off with a separate patch due to how
+    # the builder currently interfaces with custom functions: combine
+    # functions known to numpy run as a single ufunc call, others are
+    # applied to whole slices of the input at once
+
+    def _new_reduce(input, axis, combine_fn, _builder=None, _generator=None):
+        if isinstance(input, tl.core.tensor):
+            return _new_reduce((input, ), axis, combine_fn)[0]
+        axis = tl.core._constexpr_to_value(axis)
+        data = np.broadcast_arrays(*[t.handle.data for t in input])
+        dtypes = [t.dtype for t in input]
+        if axis is None:
+            data = [d.reshape(d.shape[0], -1) for d in data]
+            axis = 0
+        # skip the leading axis, which enumerates programs
+        axis = axis % (data[0].ndim - 1) + 1
+        ufunc = _combine_ufunc(combine_fn)
+        if ufunc is not None and len(data) == 1 and data[0].dtype != bool:
+            rets = [ufunc.reduce(data[0], axis=axis, dtype=data[0].dtype)]
+        else:
+            rets, dtypes = _reduce_tree(data, dtypes, axis, combine_fn)
+        return tuple(_wrap_data(ret, dtype) for ret, dtype in zip(rets, dtypes))
+
+    def _new_scan(input, axis, combine_fn, _builder=None, _generator=None):
+        if isinstance(input, tl.core.tensor):
+            return _new_scan((input, ), axis, combine_fn)[0]
+        axis = tl.core._constexpr_to_value(axis)
+        data = np.broadcast_arrays(*[t.handle.data for t in input])
+        dtypes = [t.dtype for t in input]
+        axis = axis % (data[0].ndim - 1) + 1
+        ufunc = _combine_ufunc(combine_fn)
+        if ufunc is not None and len(data) == 1 and data[0].dtype != bool:
+            rets = [ufunc.accumulate(data[0], axis=axis, dtype=data[0].dtype)]
+        else:
+            rets, dtypes = _scan_tree(data, dtypes, axis, combine_fn)
+        return tuple(_wrap_data(ret, dtype) for ret, dtype in zip(rets, dtypes))
+
+    # device_assert locates its caller by walking up to the first frame
+    # outside of a module, which does not exist when kernels run as Python
+    def _new_device_assert(cond, msg="", _builder=None):
+        frame = inspect.currentframe().f_back
+        cond = tl.core._to_tensor(cond, builder)
+        msg = tl.core._constexpr_to_value(msg)
+        return builder.create_assert(cond.handle, msg, frame.f_code.co_filename, frame.f_code.co_name,
+                                     frame.f_lineno)
 
     lang.reduce = _new_reduce
+    lang.associative_scan = _new_scan
+    lang.device_assert = _new_device_assert
 
 
 def _patch_lang_math(lang, builder):
@@ -466,6 +650,40 @@ def _unwrap(tensor):
     return tensor
 
 
+def _uses_atomics(fn, seen=None):
+    """Returns whether `fn`, or any jit'd function it calls, uses atomics.
+    Programs of such kernels may communicate through global memory, so the
+    order in which they run is observable."""
+    seen = set() if seen is None else seen
+    if fn in seen:
+        return False
+    seen.add(fn)
+    codes = [fn.__code__]
+    while codes:
+        code = codes.pop()
+        for name in code.co_names:
+            if name.startswith("atomic_"):
+                return True
+            callee = fn.__globals__.get(name)
+            if isinstance(callee, (InterpretedFunction, triton.runtime.jit.JITFunction)):
+                if _uses_atomics(callee.fn, seen):
+                    return True
+        codes += [const for const in code.co_consts if inspect.iscode(const)]
+    return False
+
+
+def _num_workers():
+    num_workers = os.getenv("TRITON_INTERPRET_NUM_WORKERS", "")
+    return int(num_workers) if num_workers else (os.cpu_count() or 1)
+
+
+def _batch_size():
+    """Returns how many programs are executed together by a single run of the
+    kernel body, each program being a row along the leading axis of every
+    value."""
+    return max(int(os.getenv("TRITON_INTERPRET_BATCH_SIZE", "1")), 1)
+
+
 builder = Builder()
 
 RESERVED_KWS = ["num_warps", "num_stages", "num_ctas", "enable_warp_specialization", "enable_fp_fusion"]
@@ -481,6 +699,7 @@ class GridExecutor:
         self.grid = grid
         __annotations__ = {name: _normalize_ty(ty) for name, ty in fn.__annotations__.items()}
         self.constexprs = [name for name in arg_names if __annotations__.get(name) == "constexpr"]
+        self.deterministic = _uses_atomics(fn)
 
     def _patch_lang(self, builder):
         lang = [value for _, value in self.fn.__globals__.items() if value in [tl, tl.core]]
@@ -489,6 +708,45 @@ class GridExecutor:
         _patch_lang_core(lang[0], builder)
         _patch_lang_math(lang[0], builder)
 
+    def _run_programs(self, grid, grid_idxs, args, batch_size):
+        builder.set_grid_dim(*grid)
+        for i in range(0, len(grid_idxs), batch_size):
+            builder.set_grid_idxs(grid_idxs[i:i + batch_size])
+            self.fn(**args)
+
+    def _run_grid(self, grid, args, batch_size):
+        # one (x, y, z) row per program, in row-major grid order
+        grid_idxs = np.indices(grid).reshape(3, -1).T
+        num_batches = (len(grid_idxs) + batch_size - 1) // batch_size
+        num_workers = min(_num_workers(), num_batches)
+        # programs of kernels using atomics run one after another, in grid
+        # order, so that results do not depend on thread scheduling
+        if num_workers <= 1 or self.deterministic:
+            self._run_programs(grid, grid_idxs, args, batch_size)
+            return
+        # shard the grid into contiguous chunks, a few per worker so that
+        # programs with uneven work are balanced
+        num_shards = min(num_batches, 4 * num_workers)
+        shard_size = (num_batches + num_shards - 1) // num_shards * batch_size
+        shards = [grid_idxs[i:i + shard_size] for i in range(0, len(grid_idxs), shard_size)]
+        with ThreadPoolExecutor(max_workers=num_workers) as executor:
+            futures = [executor.submit(self._run_programs, grid, shard, args, batch_size) for shard in shards]
+            for future in futures:
+                future.result()
+
+    def _run_batched_grid(self, grid, args, args_hst, batch_size):
+        # programs run in lockstep until they disagree on Python control
+        # flow; the grid is then rerun one program at a time from the
+        # original arguments
+        saved = [arg.clone() if hasattr(arg, "data_ptr") else None for arg in args_hst]
+        try:
+            self._run_grid(grid, args, batch_size)
+        except _DivergentPrograms:
+            for arg, saved_arg in zip(args_hst, saved):
+                if saved_arg is not None:
+                    arg.copy_(saved_arg)
+            self._run_grid(grid, args, 1)
+
     def __call__(self, *args_dev, **kwargs):
         args_hst = [_unwrap(arg).cpu() if hasattr(arg, "data_ptr") else arg for arg in args_dev]
         # removes reserved keywords from kwargs
@@ -503,12 +761,11 @@ class GridExecutor:
         grid = self.grid(args) if callable(self.grid) else self.grid
         assert len(grid) <= 3
         grid = grid + (1, ) * (3 - len(grid))
-        builder.set_grid_dim(*grid)
-        for x in range(grid[0]):
-            for y in range(grid[1]):
-                for z in range(grid[2]):
-                    builder.set_grid_idx(x, y, z)
-                    self.fn(**args)
+        batch_size = _batch_size()
+        if batch_size > 1:
+            self._run_batched_grid(grid, args, args_hst, batch_size)
+        else:
+            self._run_grid(grid, args, 1)
         # copy arguments back to propagate side-effects
         for arg_dev, arg_hst in zip(args_dev, args_hst):
             if hasattr(arg_dev, "data_ptr"):
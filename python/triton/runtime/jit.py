@@ -137,19 +137,69 @@ class KernelArg:
 
     def specialization_key(self):
         assert not self.param.do_not_specialize
+        return _specialization_key(self.value)
 
-        if hasattr(self.value, "data_ptr"):
-            return (self.value.data_ptr() % JITFunction.divisibility == 0, )
 
-        if isinstance(self.value, int):
-            # bool is a subclass of int, so we don't check explicitly above.
-            return (
-                self.value % JITFunction.divisibility == 0,
-                self.value % JITFunction.divisibility_8 == 0,
-                self.value == 1,
-            )
+def _specialization_key(value):
+    if hasattr(value, "data_ptr"):
+        return (value.data_ptr() % JITFunction.divisibility == 0, )
+
+    if isinstance(value, int):
+        # bool is a subclass of int, so we don't check explicitly above.
+        return (
+            value % JITFunction.divisibility == 0,
+            value % JITFunction.divisibility_8 == 0,
+            value == 1,
+        )
+
+    return (False, )
+
+
+def _signature_key_expr(param):
+    # mirrors KernelArg.signature_key
+    if "Tensor" in param.annotation:
+        return f"{param.name}.dtype"
+    elif param.annotation == "bool":
+        return "'i1'"
+    elif param.annotation == "float":
+        return "'fp32'"
+    return f"__triton_key_of({param.name})"
+
 
-        return (False, )
+def _make_binder(name, params):
+    """
+    Generates a function with the same parameters as the kernel that returns
+    the argument values, the non-constexpr values passed to the launcher, the
+    parts of the cache key that depend on the arguments, and the remaining
+    keyword arguments (compilation options).
+
+    This replaces `inspect.Signature.bind` and the per-argument `KernelArg`
+    objects on the launch path. Names of the generated code other than the
+    parameters are prefixed with `__triton_`, so that they cannot collide
+    with them.
+    """
+    scope = {"__triton_key_of": JITFunction._key_of, "__triton_spec_key": _specialization_key}
+    decls = []
+    for param in params:
+        if param.has_default:
+            scope[f"__triton_default_{param.num}"] = param.default
+            decls.append(f"{param.name}=__triton_default_{param.num}")
+        else:
+            decls.append(param.name)
+
+    def tuple_expr(exprs):
+        return "(" + "".join(f"{e}, " for e in exprs) + ")"
+
+    values = tuple_expr(p.name for p in params)
+    launch_args = tuple_expr(p.name for p in params if not p.is_constexpr)
+    sig_key = tuple_expr(_signature_key_expr(p) for p in params if not p.is_constexpr)
+    spec_key = tuple_expr(f"__triton_spec_key({p.name})" for p in params if not p.do_not_specialize)
+    constexpr_key = tuple_expr(p.name for p in params if p.is_constexpr)
+    # named after the kernel so that binding errors read like a regular call
+    src = (f"def {name}({', '.join(decls + ['**__triton_options'])}):\n"
+           f"    return {values}, {launch_args}, {sig_key}, {spec_key}, {constexpr_key}, __triton_options\n")
+    exec(src, scope)
+    return scope[name]
 
 
 class KernelInterface(Generic[T]):
@@ -335,81 +385,117 @@ class JITFunction(KernelInterface[T]):
             already_compiled=False,
         )
 
-    def run(self, *args, grid, warmup, **kwargs):
-        from ..compiler import CompiledKernel, compile, ASTSource
+    def _parse_options(self, target, kwargs):
         from ..compiler.backends import make_backend
         # deprecated arguments
         assert "device_type" not in kwargs, "device_type option is deprecated; current target will be used"
         assert "device" not in kwargs, "device option is deprecated; current device will be used"
         assert "stream" not in kwargs, "stream option is deprecated; current stream will be used"
-        # parse options
+        opts = dict(kwargs, debug=self.debug)
+        if "max_shared_mem" not in opts:
+            # size shared memory buffers for the device the kernel runs on
+            # rather than for a guess from its architecture
+            opts["max_shared_mem"] = self._get_max_shared_mem()
+        options = make_backend(target).parse_options(opts)
+        for k in kwargs:
+            if k not in options.__dict__:
+                raise TypeError(f"{self.__name__}() got an unexpected keyword argument '{k}'")
+        return options
+
+    @staticmethod
+    def _get_max_shared_mem():
+        utils = getattr(driver, "utils", None)
+        if utils is None:
+            return None
+        return utils.get_device_properties(driver.get_current_device())["max_shared_mem"]
+
+    def _get_options(self, target, kwargs):
+        options_key = (target, self.debug, *kwargs.items())
+        try:
+            options = self.options_cache.get(options_key)
+        except TypeError:
+            # unhashable options, e.g. `extern_libs` dicts
+            return self._parse_options(target, kwargs)
+        if options is None:
+            options = self.options_cache[options_key] = self._parse_options(target, kwargs)
+        return options
+
+    def _bind(self, args, kwargs):
+        target = driver.get_current_target()
+        values, launch_args, sig_key, spec_key, constexpr_key, options = self.binder(*args, **kwargs)
+        options = self._get_options(target, options)
+        key = (get_cuda_version_key(), sig_key, constexpr_key, spec_key, options)
+        return target, options, values, launch_args, key
+
+    def _make_source(self, args):
+        from ..compiler import ASTSource
+        configs = (self._get_config(*[arg.value for arg in args]), )
+        constants = {
+            arg.param.num: arg.value
+            for arg in args
+            if arg.param.is_constexpr or arg.param.num in configs[0].equal_to_1 or arg.value is None
+        }
+        for i, arg in constants.items():
+            if callable(arg):
+                raise TypeError(f"Callable constexpr at index {i} is not supported")
+
+        # Build kernel signature -- doesn't include constexpr arguments.
+        signature = {arg.param.num: self._type_of(self._key_of(arg.value)) for arg in args if not arg.param.is_constexpr}
+        return ASTSource(self, signature, constants, configs[0])
+
+    def compile_args(self, *args, **kwargs):
+        """
+        Returns the `(src, target, options)` that `run` would pass to `compile`
+        for these arguments, without compiling or launching anything.
+        """
+        target, options, values, _, _ = self._bind(args, kwargs)
+        args = [KernelArg(value, param) for value, param in zip(values, self.params)]
+        return self._make_source(args), target, options.__dict__
+
+    def run(self, *args, grid, warmup, **kwargs):
         device = driver.get_current_device()
         stream = driver.get_current_stream(device)
-        target = driver.get_current_target()
-        backend = make_backend(target)
-        kwargs["debug"] = self.debug
-        options = backend.parse_options(kwargs)
-        # bind non-reserved keyword args and set defaults
-        kwargs = {k: v for k, v in kwargs.items() if not k in options.__dict__}
-        bound_args = self.signature.bind(*args, **kwargs)
-        bound_args.apply_defaults()
-        assert len(bound_args.arguments) == len(self.params)
+        target, options, values, launch_args, key = self._bind(args, kwargs)
         # canonicalize grid
         assert grid is not None
         if callable(grid):
             # Arguments are passed as a dict to `grid`, by contract.
             # TODO(jlebar): In the new launch API, pass the compiler flags as a
             # second parameter to `grid`.
-            grid = grid(dict(bound_args.arguments))
+            grid = grid(dict(zip(self.arg_names, values)))
         grid_size = len(grid)
         grid_0 = grid[0]
         grid_1 = grid[1] if grid_size > 1 else 1
         grid_2 = grid[2] if grid_size > 2 else 1
-        # compute cache key
-        args = [KernelArg(arg_value, param) for (_, arg_value), param in zip(bound_args.arguments.items(), self.params)]
-        sig_key = tuple(arg.signature_key() for arg in args if not arg.param.is_constexpr)
-        spec_key = tuple(arg.specialization_key() for arg in args if not arg.param.do_not_specialize)
-        constexpr_key = tuple(arg.value for arg in args if arg.param.is_constexpr)
-        key = (get_cuda_version_key(), sig_key, constexpr_key, spec_key, options)
         # Kernel is not cached; we have to compile.
-        if key not in self.cache[device]:
-            configs = (self._get_config(*[arg.value for arg in args]), )
-            constants = {
-                arg.param.num: arg.value
-                for arg in args
-                if arg.param.is_constexpr or arg.param.num in configs[0].equal_to_1 or arg.value is None
-            }
-            for i, arg in constants.items():
-                if callable(arg):
-                    raise TypeError(f"Callable constexpr at index {i} is not supported")
-
-            # Build kernel signature -- doesn't include constexpr arguments.
-            signature = {
-                arg.param.num: self._type_of(self._key_of(arg.value))
-                for arg in args
-                if not arg.param.is_constexpr
-            }
-
-            if self._call_hook(key, signature, device, constants, options.num_warps, options.num_ctas,
+        kernel = self.cache[device].get(key)
+        if kernel is None:
+            from ..compiler import compile
+            args = [KernelArg(value, param) for value, param in zip(values, self.params)]
+            src = self._make_source(args)
+            if self._call_hook(key, src.signature, device, src.constants, options.num_warps, options.num_ctas,
                                options.num_stages, options.enable_warp_specialization, options.enable_fp_fusion,
-                               options.extern_libs, configs):
+                               options.extern_libs, (src.attrs, )):
                 return None
             # compile the kernel
-            src = ASTSource(self, signature, constants, configs[0])
-            self.cache[device][key] = compile(
+            kernel = self.cache[device][key] = compile(
                 src,
                 target=target,
                 options=options.__dict__,
             )
 
-        kernel = self.cache[device][key]
         if not warmup:
-            args = [arg.value for arg in args if not arg.param.is_constexpr]
-            kernel.run(grid_0, grid_1, grid_2, kernel.num_warps, kernel.num_ctas,  # number of warps/ctas per instance
-                       kernel.cluster_dims[0], kernel.cluster_dims[1], kernel.cluster_dims[2],  # cluster
-                       kernel.shared, stream, kernel.function, CompiledKernel.launch_enter_hook,
-                       CompiledKernel.launch_exit_hook, kernel,
-                       *driver.assemble_tensormap_to_arg(kernel.metadata["tensormaps_info"], args))
+            # handles are looked up per launch: the kernel may be shared with
+            # launches on other devices
+            function = kernel._init_handles(device)[1]
+            tensormaps_info = kernel.metadata["tensormaps_info"]
+            if tensormaps_info:
+                launch_args = driver.assemble_tensormap_to_arg(tensormaps_info, launch_args)
+            cluster_dims = kernel.cluster_dims
+            kernel.launcher(grid_0, grid_1, grid_2, kernel.num_warps, kernel.num_ctas,  # number of warps/ctas per instance
+                            cluster_dims[0], cluster_dims[1], cluster_dims[2],  # cluster
+                            kernel.shared, stream, function, kernel.launch_enter_hook,
+                            kernel.launch_exit_hook, kernel, *launch_args)
         return kernel
 
     def __init__(self, fn, version=None, do_not_specialize=None, debug=None, noinline=None):
@@ -432,6 +518,9 @@ class JITFunction(KernelInterface[T]):
         self.src = self.src[self.src.find("def"):]
         # cache of just-in-time compiled kernels
         self.cache = defaultdict(dict)
+        # parsed compilation options, keyed by the target and option kwargs
+        self.options_cache = dict()
+        self.binder = _make_binder(fn.__name__, self.params)
         self.hash = None
         # JITFunction can be instantiated as kernel
         # when called with a grid using __getitem__
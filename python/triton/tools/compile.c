@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <inttypes.h>
 #include <string.h>
+#include <pthread.h>
 #include <cuda.h>
 
 
@@ -28,40 +29,68 @@ static inline void gpuAssert(CUresult code, const char *file, int line) {{
 #define CUBIN_NAME {kernel_name}_cubin
 CUmodule {kernel_name}_mod = NULL;
 CUfunction {kernel_name}_func = NULL;
+static pthread_mutex_t {kernel_name}_lock = PTHREAD_MUTEX_INITIALIZER;
+#ifdef TT_BUNDLED_CUBINS
+// the cubin is stored in the bundle generated by `link.py --bundle`
+extern const unsigned char *const {kernel_name}_bundled_cubin;
+#define CUBIN_DATA {kernel_name}_bundled_cubin
+#else
 unsigned char CUBIN_NAME[{bin_size}] = {{ {bin_data} }};
+#define CUBIN_DATA CUBIN_NAME
+#endif
 
 
 void unload_{kernel_name}(void) {{
-    CUDA_CHECK(cuModuleUnload({kernel_name}_mod));
+    pthread_mutex_lock(&{kernel_name}_lock);
+    if ({kernel_name}_mod != NULL) {{
+      __atomic_store_n(&{kernel_name}_func, NULL, __ATOMIC_RELEASE);
+      CUDA_CHECK(cuModuleUnload({kernel_name}_mod));
+      {kernel_name}_mod = NULL;
+    }}
+    pthread_mutex_unlock(&{kernel_name}_lock);
 }}
 
 // TODO: some code duplication with `runtime/backend/cuda.c`
 void load_{kernel_name}() {{
+    pthread_mutex_lock(&{kernel_name}_lock);
+    if ({kernel_name}_mod != NULL) {{
+      pthread_mutex_unlock(&{kernel_name}_lock);
+      return;
+    }}
     int dev = 0;
-    void *bin = (void *)&CUBIN_NAME;
+    void *bin = (void *)CUBIN_DATA;
     int shared = {shared};
+    CUfunction func;
     CUDA_CHECK(cuModuleLoadData(&{kernel_name}_mod, bin));
-    CUDA_CHECK(cuModuleGetFunction(&{kernel_name}_func, {kernel_name}_mod, "{triton_kernel_name}"));
+    CUDA_CHECK(cuModuleGetFunction(&func, {kernel_name}_mod, "{triton_kernel_name}"));
     // set dynamic shared memory if necessary
     int shared_optin;
     CUDA_CHECK(cuDeviceGetAttribute(&shared_optin, CU_DEVICE_ATTRIBUTE_MAX_SHARED_MEMORY_PER_BLOCK_OPTIN, dev));
     if (shared > 49152 && shared_optin > 49152) {{
-      CUDA_CHECK(cuFuncSetCacheConfig({kernel_name}_func, CU_FUNC_CACHE_PREFER_SHARED));
-      CUDA_CHECK(cuFuncSetAttribute({kernel_name}_func, CU_FUNC_ATTRIBUTE_MAX_DYNAMIC_SHARED_SIZE_BYTES, shared_optin))
+      CUDA_CHECK(cuFuncSetCacheConfig(func, CU_FUNC_CACHE_PREFER_SHARED));
+      CUDA_CHECK(cuFuncSetAttribute(func, CU_FUNC_ATTRIBUTE_MAX_DYNAMIC_SHARED_SIZE_BYTES, shared_optin))
     }}
+    // publish the function once it is ready to be launched
+    __atomic_store_n(&{kernel_name}_func, func, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&{kernel_name}_lock);
 }}
 
 /*
 {kernel_docstring}
 */
 CUresult {kernel_name}(CUstream stream, {signature}) {{
-    if ({kernel_name}_func == NULL)
+    // concurrent first launches wait for a single load of the module
+    CUfunction func = __atomic_load_n(&{kernel_name}_func, __ATOMIC_ACQUIRE);
+    if (func == NULL) {{
        load_{kernel_name}();
+       func = __atomic_load_n(&{kernel_name}_func, __ATOMIC_ACQUIRE);
+    }}
     unsigned int gX = {gridX};
     unsigned int gY = {gridY};
     unsigned int gZ = {gridZ};
     void *args[{num_args}] = {{ {arg_pointers} }};
     // TODO: shared memory
     if(gX * gY * gZ > 0)
-      return cuLaunchKernel({kernel_name}_func, gX, gY, gZ, {num_warps} * 32, 1, 1, {shared}, stream, args, NULL);
+      return cuLaunchKernel(func, gX, gY, gZ, {num_warps} * 32, 1, 1, {shared}, stream, args, NULL);
+    return CUDA_SUCCESS;
 }}
@@ -144,3 +144,5 @@ if __name__ == "__main__":
         template_path = Path(__file__).parent / f"compile.{ext}"
         with out_path.with_suffix(f".{sig_hash}_{suffix}.{ext}").open("w") as fp:
             fp.write(Path(template_path).read_text().format(**params))
+    # raw cubin, bundled with the others by `link.py --bundle`
+    out_path.with_suffix(f".{sig_hash}_{suffix}.cubin").write_bytes(ccinfo.asm["cubin"])
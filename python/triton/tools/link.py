@@ -157,42 +157,91 @@ def make_default_algo_kernel(meta: KernelLinkerMeta) -> str:
     return src
 
 
+# dispatch on the hints of at most this many (argument, hint) pairs with a switch
+# over all their combinations, and fall back to a chain of checks beyond
+MAX_DISPATCH_KEY_BITS = 10
+
+
+def _hint_cond(val, hint):
+    return f"({val} % {hint} == 0)" if hint == 16 else f"({val} == {hint})" if hint == 1 else None
+
+
+def _make_specialization_call(meta: KernelLinkerMeta) -> str:
+    arg_names = [arg for arg, hint in zip(meta.arg_names, meta.sizes) if hint != 1]
+    return f"{meta.orig_kernel_name}_{meta.sig_hash}_{meta.suffix}(stream, {', '.join(arg_names)})"
+
+
+def _make_hints_switch(metas: Sequence[KernelLinkerMeta]) -> str:
+    # every (argument, hint) pair checked by some specialization is one bit of
+    # the key; each value of the key goes to the most specialized kernel whose
+    # hints all hold
+    hints = []
+    for meta in metas:
+        for i, (val, hint) in enumerate(zip(meta.arg_names, meta.sizes)):
+            if hint is not None and (i, val, hint) not in hints:
+                hints.append((i, val, hint))
+    hints.sort()
+    src = "  unsigned key = 0;\n"
+    for bit, (_, val, hint) in enumerate(hints):
+        src += f"  key |= (unsigned){_hint_cond(val, hint)} << {bit};\n"
+    src += "  switch (key) {\n"
+    assigned = set()
+    for meta in metas:
+        required = 0
+        for bit, (i, _, hint) in enumerate(hints):
+            if meta.sizes[i] == hint:
+                required |= 1 << bit
+        keys = [key for key in range(1 << len(hints)) if key & required == required and key not in assigned]
+        if not keys:
+            continue
+        assigned.update(keys)
+        for key in keys:
+            src += f"  case {key}:\n"
+        src += f"    return {_make_specialization_call(meta)};\n"
+    src += "  }\n"
+    return src
+
+
+def _make_hints_chain(metas: Sequence[KernelLinkerMeta]) -> str:
+    src = ""
+    for meta in metas:
+        conds = " && ".join([  #
+            _hint_cond(val, hint)  #
+            for val, hint in zip(meta.arg_names, meta.sizes)  #
+            if hint is not None
+        ])
+        src += (f"  if ({conds})\n" if any(meta.sizes) else "if (1)\n"
+                )  # Edge case where no specializations hence no dispatching required
+        src += f"    return {_make_specialization_call(meta)};\n"
+    return src
+
+
 # generate dispatcher function for kernels with different integer value hints
 def make_kernel_hints_dispatcher(name: str, metas: Sequence[KernelLinkerMeta]) -> str:
+    metas = sorted(metas, key=lambda m: -m.num_specs)
     src = f"// launcher for: {name}\n"
-    for meta in sorted(metas, key=lambda m: -m.num_specs):
+    for meta in metas:
         src += f"CUresult {meta.orig_kernel_name}_{meta.sig_hash}_{meta.suffix}(CUstream stream, {gen_signature(meta)});\n"
     src += "\n"
 
     src += (f"CUresult {name}(CUstream stream, {gen_signature_with_full_args(metas[-1])}){{")
     src += "\n"
-    for meta in sorted(metas, key=lambda m: -m.num_specs):
-        cond_fn = (  #
-            lambda val, hint: f"({val} % {hint} == 0)"  #
-            if hint == 16  #
-            else f"({val} == {hint})"  #
-            if hint == 1  #
-            else None)
-        conds = " && ".join([  #
-            cond_fn(val, hint)  #
-            for val, hint in zip(meta.arg_names, meta.sizes)  #
-            if hint is not None
-        ])
-        src += (f"  if ({conds})\n" if any(meta.sizes) else "if (1)\n"
-                )  # Edge case where no specializations hence no dispatching required
-        arg_names = [arg for arg, hint in zip(meta.arg_names, meta.sizes) if hint != 1]
-        src += f"    return {meta.orig_kernel_name}_{meta.sig_hash}_{meta.suffix}(stream, {', '.join(arg_names)});\n"
+    num_hints = len({(i, hint) for meta in metas for i, hint in enumerate(meta.sizes) if hint is not None})
+    if num_hints <= MAX_DISPATCH_KEY_BITS:
+        src += _make_hints_switch(metas)
+    else:
+        src += _make_hints_chain(metas)
     src += "\n"
     src += "  return CUDA_ERROR_INVALID_VALUE;\n"
     src += "}\n"
 
     for mode in ["load", "unload"]:
         src += f"\n// {mode} for: {name}\n"
-        for meta in sorted(metas, key=lambda m: -m.num_specs):
+        for meta in metas:
             src += f"void {mode}_{meta.orig_kernel_name}_{meta.sig_hash}_{meta.suffix}();\n"
         src += f"void {mode}_{name}() {{"
         src += "\n"
-        for meta in sorted(metas, key=lambda m: -m.num_specs):
+        for meta in metas:
             src += (f"  {mode}_{meta.orig_kernel_name}_{meta.sig_hash}_{meta.suffix}();\n")
         src += "}\n"
     return src
@@ -241,6 +290,31 @@ def make_get_num_algos_def(meta: KernelLinkerMeta) -> str:
     return src
 
 
+# generate a single blob holding the cubins of all kernels, with an index
+def make_cubin_bundle(bundle_name: str, cubins: Sequence[tuple]) -> str:
+    alignment = 128
+    data = bytearray()
+    index = []
+    for kernel_name, cubin in cubins:
+        data += bytes(-len(data) % alignment)
+        index.append((kernel_name, len(data), len(cubin)))
+        data += cubin
+    # one page-aligned section, which loaders can map at once
+    src = f"__attribute__((section(\".tt_cubins\"), aligned(4096))) const unsigned char {bundle_name}[{max(len(data), 1)}] = {{\n"
+    for i in range(0, len(data), 16):
+        src += "  " + ", ".join(f"0x{b:02x}" for b in data[i:i + 16]) + ",\n"
+    src += "};\n\n"
+    for kernel_name, offset, _ in index:
+        src += f"const unsigned char *const {kernel_name}_bundled_cubin = {bundle_name} + {offset};\n"
+    src += "\n"
+    src += f"const struct {{ const char *name; size_t offset; size_t size; }} {bundle_name}_index[] = {{\n"
+    for kernel_name, offset, size in index:
+        src += f"  {{ \"{kernel_name}\", {offset}, {size} }},\n"
+    src += "};\n"
+    src += f"const int {bundle_name}_count = {len(index)};\n"
+    return src
+
+
 desc = """
 Triton ahead-of-time linker:
 
@@ -250,6 +324,10 @@ kernel given the specializations that were compiled.
 
 Example usage:
 python link.py /path/to/headers/*.h -o kernel_name
+
+With --bundle, the cubins of all kernels are stored in a single blob in the
+generated source instead. The kernel sources must then be compiled with
+-DTT_BUNDLED_CUBINS.
 """
 
 if __name__ == "__main__":
@@ -268,16 +346,27 @@ if __name__ == "__main__":
         default="",
         help="String to prefix kernel dispatcher names",
     )
+    parser.add_argument(
+        "--bundle",
+        action="store_true",
+        help="Bundle the cubins written by compile.py next to the headers into a single blob",
+    )
     args = parser.parse_args()
 
     # metadata
     parser = HeaderParser()
     includes = []
+    cubins = []
     for header in args.headers:
         h_path = Path(header)
         h_str = h_path.read_text()
         includes.append(h_path.name)
         parser.extract_linker_meta(h_str)
+        if args.bundle:
+            for ln in h_str.splitlines():
+                m = parser.linker_directives.match(ln)
+                if _exists(m):
+                    cubins.append((m.group(1), h_path.with_suffix(".cubin").read_bytes()))
 
     # generate headers
     algo_decls = [make_algo_decls(name, meta) for name, meta in parser.kernels.items()]
@@ -306,8 +395,12 @@ if __name__ == "__main__":
         out = ""
         out += "#include <cuda.h>\n"
         out += "#include <stdint.h>\n"
+        out += "#include <stddef.h>\n"
         out += "#include <assert.h>\n"
         out += "\n"
+        if args.bundle:
+            out += make_cubin_bundle(f"{args.out.stem}_cubins", cubins)
+            out += "\n"
         out += "\n".join(defs)
         out += "\n"
         out += func_pointers_def
@@ -116,56 +116,58 @@ tt.func @preallocate(%A : !tt.ptr<f16>) {
 tt.func @unused(%A : !tt.ptr<f16>) {
   // CHECK: offset = 0, size = 1024
   %cst0 = arith.constant dense<0.000000e+00> : tensor<32x16xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 0, size = 512
-  %cst1 = arith.constant dense<0.000000e+00> : tensor<16x16xf16, #A_SHARED>
   // CHECK-NEXT: offset = 1024, size = 512
+  %cst1 = arith.constant dense<0.000000e+00> : tensor<16x16xf16, #A_SHARED>
+  // CHECK-NEXT: offset = 2048, size = 512
   %cst2 = arith.constant dense<0.000000e+00> : tensor<16x16xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 2048, size = 1024
+  // CHECK-NEXT: offset = 0, size = 1024
   %a = tt.cat %cst1, %cst2 {axis = 0} : (tensor<16x16xf16, #A_SHARED>, tensor<16x16xf16, #A_SHARED>) -> tensor<32x16xf16, #A_SHARED>
   tt.return
-  // CHECK: size = 3072
+  // CHECK: size = 2560
+  // CHECK-NEXT: first-fit size = 3072
 }
 
 // cst0 is alive through the entire function, it cannot be released before the end of the function
 // CHECK-LABEL: longlive
 tt.func @longlive(%A : !tt.ptr<f16>) {
-  // CHECK: offset = 0, size = 512
+  // CHECK: offset = 1024, size = 512
   %cst0 = arith.constant dense<0.000000e+00> : tensor<16x16xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 1024, size = 512
-  %cst1 = arith.constant dense<0.000000e+00> : tensor<16x16xf16, #A_SHARED>
   // CHECK-NEXT: offset = 2048, size = 512
+  %cst1 = arith.constant dense<0.000000e+00> : tensor<16x16xf16, #A_SHARED>
+  // CHECK-NEXT: offset = 3072, size = 512
   %cst2 = arith.constant dense<0.000000e+00> : tensor<16x16xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 3072, size = 1024
+  // CHECK-NEXT: offset = 0, size = 1024
   %a = tt.cat %cst1, %cst2 {axis = 0} : (tensor<16x16xf16, #A_SHARED>, tensor<16x16xf16, #A_SHARED>) -> tensor<32x16xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 1024, size = 512
-  %cst3 = arith.constant dense<0.000000e+00> : tensor<16x16xf16, #A_SHARED>
   // CHECK-NEXT: offset = 2048, size = 512
+  %cst3 = arith.constant dense<0.000000e+00> : tensor<16x16xf16, #A_SHARED>
+  // CHECK-NEXT: offset = 3072, size = 512
   %cst4 = arith.constant dense<0.000000e+00> : tensor<16x16xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 3072, size = 1024
+  // CHECK-NEXT: offset = 0, size = 1024
   %b = tt.cat %cst3, %cst4 {axis = 0} : (tensor<16x16xf16, #A_SHARED>, tensor<16x16xf16, #A_SHARED>) -> tensor<32x16xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 3072, size = 512
+  // CHECK-NEXT: offset = 0, size = 512
   %cst5 = arith.constant dense<0.000000e+00> : tensor<16x16xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 3072, size = 512
+  // CHECK-NEXT: offset = 0, size = 512
   %cst6 = arith.constant dense<0.000000e+00> : tensor<16x16xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 3072, size = 1024
+  // CHECK-NEXT: offset = 0, size = 1024
   %c = tt.cat %cst3, %cst4 {axis = 0} : (tensor<16x16xf16, #A_SHARED>, tensor<16x16xf16, #A_SHARED>) -> tensor<32x16xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 1024, size = 1024
+  // CHECK-NEXT: offset = 0, size = 1024
   %d = tt.cat %cst0, %cst0 {axis = 0} : (tensor<16x16xf16, #A_SHARED>, tensor<16x16xf16, #A_SHARED>) -> tensor<32x16xf16, #A_SHARED>
   tt.return
-  // CHECK-NEXT: size = 4096
+  // CHECK-NEXT: size = 3584
+  // CHECK-NEXT: first-fit size = 4096
 }
 
 // This example triggers graph coloring with > 1 colors.
 // CHECK-LABEL: multi_color
 tt.func @multi_color(%A : !tt.ptr<f16>) {
-  // CHECK: offset = 0, size = 64
+  // CHECK: offset = 1280, size = 64
   %cst = arith.constant dense<0.000000e+00> : tensor<4x8xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 1536, size = 32
+  // CHECK-NEXT: offset = 1408, size = 32
   %cst_0 = arith.constant dense<0.000000e+00> : tensor<4x4xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 1664, size = 128
+  // CHECK-NEXT: offset = 1152, size = 128
   %cst_1 = arith.constant dense<0.000000e+00> : tensor<16x4xf16, #A_SHARED>
   %cst_2 = arith.constant dense<0.000000e+00> : tensor<16x32xf16, #AL>
-  // CHECK-NEXT: scratch offset = 128, size = 1152
+  // CHECK-NEXT: scratch offset = 0, size = 1152
   %0 = triton_gpu.convert_layout %cst_2 : (tensor<16x32xf16, #AL>) -> tensor<16x32xf16, #AL>
   %1 = triton_gpu.convert_layout %cst : (tensor<4x8xf16, #A_SHARED>) -> tensor<4x8xf16, #AL>
   // CHECK-NEXT: offset = 0, size = 128
@@ -173,22 +175,22 @@ tt.func @multi_color(%A : !tt.ptr<f16>) {
   %2 = triton_gpu.convert_layout %cst_0 : (tensor<4x4xf16, #A_SHARED>) -> tensor<4x4xf16, #AL>
   // CHECK-NEXT: scratch offset = 0, size = 1152
   %3 = triton_gpu.convert_layout %cst_2 : (tensor<16x32xf16, #AL>) -> tensor<16x32xf16, #AL>
-  // CHECK-NEXT: offset = 0, size = 256
+  // CHECK-NEXT: offset = 512, size = 256
   %cst_4 = arith.constant dense<0.000000e+00> : tensor<4x32xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 256, size = 64
+  // CHECK-NEXT: offset = 768, size = 64
   %cst_5 = arith.constant dense<0.000000e+00> : tensor<4x8xf16, #A_SHARED>
   %4 = triton_gpu.convert_layout %cst_5 : (tensor<4x8xf16, #A_SHARED>) -> tensor<4x8xf16, #AL>
   %5 = triton_gpu.convert_layout %cst_5 : (tensor<4x8xf16, #A_SHARED>) -> tensor<4x8xf16, #AL>
-  // CHECK-NEXT: offset = 1024, size = 512
+  // CHECK-NEXT: offset = 0, size = 512
   %cst_6 = arith.constant dense<0.000000e+00> : tensor<8x32xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 3104, size = 128
+  // CHECK-NEXT: offset = 1280, size = 128
   %cst_7 = arith.constant dense<0.000000e+00> : tensor<2x32xf16, #A_SHARED>
   %6 = triton_gpu.convert_layout %cst_0 : (tensor<4x4xf16, #A_SHARED>) -> tensor<4x4xf16, #AL>
-  // CHECK-NEXT: offset = 1024, size = 512
+  // CHECK-NEXT: offset = 0, size = 512
   %cst_8 = arith.constant dense<0.000000e+00> : tensor<16x16xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 256, size = 32
+  // CHECK-NEXT: offset = 768, size = 32
   %cst_9 = arith.constant dense<0.000000e+00> : tensor<4x4xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 1024, size = 512
+  // CHECK-NEXT: offset = 0, size = 512
   %cst_10 = arith.constant dense<0.000000e+00> : tensor<16x16xf16, #A_SHARED>
   %7 = triton_gpu.convert_layout %cst_1 : (tensor<16x4xf16, #A_SHARED>) -> tensor<16x4xf16, #AL>
   %8 = triton_gpu.convert_layout %cst_4 : (tensor<4x32xf16, #A_SHARED>) -> tensor<4x32xf16, #AL>
@@ -198,34 +200,36 @@ tt.func @multi_color(%A : !tt.ptr<f16>) {
   %10 = triton_gpu.convert_layout %cst_7 : (tensor<2x32xf16, #A_SHARED>) -> tensor<2x32xf16, #AL>
   %cst_12 = arith.constant dense<0.000000e+00> : tensor<4x16xf16, #AL>
   %cst_13 = arith.constant dense<0.000000e+00> : tensor<8x32xf16, #AL>
-  // CHECK-NEXT: size = 3232
+  // CHECK-NEXT: size = 1440
+  // CHECK-NEXT: first-fit size = 3232
   tt.return
 }
 
 // This example triggers graph coloring with multiple rounds
 // CHECK-LABEL: multi_color_multi_rounds
 tt.func @multi_color_multi_rounds(%arg0: !tt.ptr<f16>) {
-  // CHECK: offset = 0, size = 32
+  // CHECK: offset = 9472, size = 32
   %cst = arith.constant dense<0.000000e+00> : tensor<4x4xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 1280, size = 128
+  // CHECK-NEXT: offset = 9344, size = 128
   %cst_0 = arith.constant dense<0.000000e+00> : tensor<16x4xf16, #A_SHARED>
-  // CHECK-NEXT: offset = 2048, size = 8192
+  // CHECK-NEXT: offset = 0, size = 8192
   %cst_1 = arith.constant dense<0.000000e+00> : tensor<1024x4xf16, #A_SHARED>
   %cst_2 = arith.constant dense<0.000000e+00> : tensor<16x32xf16, #AL>
-  // CHECK-NEXT: scratch offset = 128, size = 1152
+  // CHECK-NEXT: scratch offset = 8192, size = 1152
   %0 = triton_gpu.convert_layout %cst_2 : (tensor<16x32xf16, #AL>) -> tensor<16x32xf16, #AL>
   %1 = triton_gpu.convert_layout %cst : (tensor<4x4xf16, #A_SHARED>) -> tensor<4x4xf16, #AL>
-  // CHECK-NEXT: offset = 1152, size = 128
+  // CHECK-NEXT: offset = 8704, size = 128
   %cst_3 = arith.constant dense<0.000000e+00> : tensor<2x32xf16, #A_SHARED>
   %2 = triton_gpu.convert_layout %cst : (tensor<4x4xf16, #A_SHARED>) -> tensor<4x4xf16, #AL>
-  // CHECK-NEXT: offset = 0, size = 512
+  // CHECK-NEXT: offset = 8192, size = 512
   %cst_4 = arith.constant dense<0.000000e+00> : tensor<16x16xf16, #A_SHARED>
   %3 = triton_gpu.convert_layout %cst_0 : (tensor<16x4xf16, #A_SHARED>) -> tensor<16x4xf16, #AL>
   %4 = triton_gpu.convert_layout %cst_1 : (tensor<1024x4xf16, #A_SHARED>) -> tensor<1024x4xf16, #AL>
   // CHECK-NEXT: scratch offset = 0, size = 1152
   %5 = triton_gpu.convert_layout %cst_2 : (tensor<16x32xf16, #AL>) -> tensor<16x32xf16, #AL>
   %6 = triton_gpu.convert_layout %cst_3 : (tensor<2x32xf16, #A_SHARED>) -> tensor<2x32xf16, #AL>
-  // CHECK-NEXT: size = 10240
+  // CHECK-NEXT: size = 9504
+  // CHECK-NEXT: first-fit size = 10240
   tt.return
 }
 
@@ -316,6 +316,7 @@ tt.func @for(%lb : index, %ub : index, %step : index, %A : !tt.ptr<f16>, %B : !t
 
 // Although a_shared and b_shared are synced before entering the loop,
 // they are reassociated with aliases (c_shared) and thus require a barrier.
+// The loop only reads them, so the barrier is hoisted before the loop.
 // CHECK-LABEL: for_alias
 tt.func @for_alias(%lb : index, %ub : index, %step : index, %A : !tt.ptr<f16>, %B : !tt.ptr<f16>) {
   %a_shared_init = arith.constant dense<0.00e+00> : tensor<128x32xf16, #A_SHARED>
@@ -324,9 +325,12 @@ tt.func @for_alias(%lb : index, %ub : index, %step : index, %A : !tt.ptr<f16>, %
   // CHECK-NEXT: tt.cat
   %0 = tt.cat %a_shared_init, %b_shared_init {axis = 0} : (tensor<128x32xf16, #A_SHARED>, tensor<128x32xf16, #A_SHARED>) -> tensor<256x32xf16, #A_SHARED>
   %c_shared_init = arith.constant dense<0.00e+00> : tensor<128x32xf16, #A_SHARED>
+  // CHECK: gpu.barrier
+  // CHECK-NEXT: cf.br
   %a_shared, %b_shared, %c_shared = scf.for %iv = %lb to %ub step %step iter_args(%a_shared = %a_shared_init, %b_shared = %b_shared_init, %c_shared = %c_shared_init) -> (tensor<128x32xf16, #A_SHARED>, tensor<128x32xf16, #A_SHARED>, tensor<128x32xf16, #A_SHARED>) {
+    // CHECK-NOT: gpu.barrier
+    // CHECK: tt.cat
     %cst1 = tt.cat %a_shared_init, %b_shared_init {axis = 0} : (tensor<128x32xf16, #A_SHARED>, tensor<128x32xf16, #A_SHARED>) -> tensor<256x32xf16, #AL>
-    // CHECK: gpu.barrier
     // CHECK-NEXT: tt.cat
     %7 = tt.cat %a_shared, %b_shared {axis = 0} : (tensor<128x32xf16, #A_SHARED>, tensor<128x32xf16, #A_SHARED>) -> tensor<256x32xf16, #AL>
     scf.yield %c_shared, %a_shared, %b_shared : tensor<128x32xf16, #A_SHARED>, tensor<128x32xf16, #A_SHARED>, tensor<128x32xf16, #A_SHARED>
@@ -415,6 +419,7 @@ tt.func @for_for_if(%lb : index, %ub : index, %step : index, %A : !tt.ptr<f16>,
 }
 
 // c_block_next can either be converted from c_shared_init or c_shared_next_next
+// The inner loop only reads c_shared_next, so its barrier is hoisted before it
 // CHECK-LABEL: for_if_for
 tt.func @for_if_for(%lb : index, %ub : index, %step : index, %A : !tt.ptr<f16>, %B : !tt.ptr<f16>, %i1 : i1) {
   %a_shared_init = arith.constant dense<0.00e+00> : tensor<128x32xf16, #A_SHARED>
@@ -430,9 +435,11 @@ tt.func @for_if_for(%lb : index, %ub : index, %step : index, %A : !tt.ptr<f16>,
       %cst0 = arith.constant dense<0.00e+00> : tensor<128x32xf16, #A_SHARED>
       scf.yield %cst0 : tensor<128x32xf16, #A_SHARED>
     } else {
+      // CHECK: gpu.barrier
+      // CHECK-NEXT: cf.br
       %c_shared_ = scf.for %jv = %lb to %ub step %step iter_args(%c_shared_next = %c_shared) -> (tensor<128x32xf16, #A_SHARED>) {
-        // CHECK: gpu.barrier
-        // CHECK-NEXT: triton_gpu.convert_layout
+        // CHECK-NOT: gpu.barrier
+        // CHECK: triton_gpu.convert_layout
         %c_blocked_next = triton_gpu.convert_layout %c_shared_next : (tensor<128x32xf16, #A_SHARED>) -> tensor<128x32xf16, #AL>
         scf.yield %c_shared : tensor<128x32xf16, #A_SHARED>
       }
@@ -445,6 +452,45 @@ tt.func @for_if_for(%lb : index, %ub : index, %step : index, %A : !tt.ptr<f16>,
   tt.return
 }
 
+// A loop that only reads shared memory written before it needs a single
+// barrier before the loop
+// CHECK-LABEL: for_hoist_barrier
+tt.func @for_hoist_barrier(%lb : index, %ub : index, %step : index) {
+  %a = arith.constant dense<0.00e+00> : tensor<128x32xf16, #A_SHARED>
+  // CHECK: gpu.barrier
+  // CHECK-NEXT: cf.br
+  scf.for %iv = %lb to %ub step %step {
+    // CHECK-NOT: gpu.barrier
+    // CHECK: triton_gpu.convert_layout
+    %a_blocked = triton_gpu.convert_layout %a : (tensor<128x32xf16, #A_SHARED>) -> tensor<128x32xf16, #AL>
+  }
+  // CHECK-NOT: gpu.barrier
+  // CHECK: tt.return
+  tt.return
+}
+
+// The first loop only reads %a, so its barrier is hoisted before the loop. The
+// second loop writes %c on every iteration, so its barrier has to stay.
+// CHECK-LABEL: for_hoist_one_barrier
+tt.func @for_hoist_one_barrier(%lb : index, %ub : index, %step : index) {
+  %a = arith.constant dense<0.00e+00> : tensor<128x32xf16, #A_SHARED>
+  // CHECK: gpu.barrier
+  // CHECK-NEXT: cf.br
+  scf.for %iv = %lb to %ub step %step {
+    // CHECK-NOT: gpu.barrier
+    // CHECK: triton_gpu.convert_layout
+    %a_blocked = triton_gpu.convert_layout %a : (tensor<128x32xf16, #A_SHARED>) -> tensor<128x32xf16, #AL>
+  }
+  scf.for %iv = %lb to %ub step %step {
+    // CHECK: gpu.barrier
+    // CHECK-NEXT: arith.constant
+    %c = arith.constant dense<0.00e+00> : tensor<128x32xf16, #A_SHARED>
+  }
+  // CHECK-NOT: gpu.barrier
+  // CHECK: tt.return
+  tt.return
+}
+
 // CHECK-LABEL: cf_if
 tt.func @cf_if(%i1 : i1) {
   %cst = arith.constant dense<0.000000e+00> : tensor<16x16xf16, #A_SHARED>
@@ -609,9 +655,11 @@ tt.func @for_calls(%A : !tt.ptr<f16>, %cond : i1) {
   %lb = arith.constant 0 : index
   %ub = arith.constant 10 : index
   %step = arith.constant 1 : index
+  // CHECK: gpu.barrier
+  // CHECK-NEXT: cf.br
   scf.for %iv = %lb to %ub step %step {
-    // CHECK: gpu.barrier
-    // CHECK-NEXT: tt.call
+    // CHECK-NOT: gpu.barrier
+    // CHECK: tt.call
     tt.call @convert_layout1(%A) : (!tt.ptr<f16>) -> ()
   }
   tt.return
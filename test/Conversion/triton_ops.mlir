@@ -203,6 +203,22 @@ tt.func @scan_op(%ptr: tensor<1x2x4x!tt.ptr<f32>>, %v : tensor<1x2x4xf32>) {
   tt.return
 }
 
+// CHECK-LABEL: scan_op_multiple_operands
+tt.func @scan_op_multiple_operands(%v : tensor<1x2x4xf32>, %i : tensor<1x2x4xi32>) {
+  // CHECK: tt.scan
+  // CHECK-SAME: axis = 2
+  // CHECK: tt.scan.return
+  // CHECK-NEXT: (tensor<1x2x4xf32>, tensor<1x2x4xi32>) -> (tensor<1x2x4xf32>, tensor<1x2x4xi32>)
+  %a:2 = "tt.scan"(%v, %i) <{axis = 2 : i32}>({
+  ^bb0(%arg0: f32, %arg1: i32, %arg2: f32, %arg3: i32):
+    %gt = arith.cmpf ogt, %arg0, %arg2 : f32
+    %max = arith.select %gt, %arg0, %arg2 : f32
+    %idx = arith.select %gt, %arg1, %arg3 : i32
+    tt.scan.return %max, %idx : f32, i32
+  }) : (tensor<1x2x4xf32>, tensor<1x2x4xi32>) -> (tensor<1x2x4xf32>, tensor<1x2x4xi32>)
+  tt.return
+}
+
 // CHECK-LABEL: inline_asm
 // CHECK: tt.elementwise_inline_asm "shl.b32 $0, $0, 3;"
 tt.func @inline_asm(%0: tensor<512xi8>) {
@@ -0,0 +1,96 @@
+// RUN: triton-opt %s -split-input-file -triton-fold-range-checks -canonicalize | FileCheck %s
+
+// CHECK-LABEL: @fold_in_bounds_mask
+tt.func @fold_in_bounds_mask(%ptr: tensor<128x!tt.ptr<f32>>) {
+  %offs = tt.make_range {end = 128 : i32, start = 0 : i32} : tensor<128xi32>
+  %c128 = arith.constant dense<128> : tensor<128xi32>
+  %other = arith.constant dense<0.000000e+00> : tensor<128xf32>
+  // CHECK-NOT: arith.cmpi
+  %mask = arith.cmpi slt, %offs, %c128 : tensor<128xi32>
+  // CHECK: %[[VAL:.*]] = tt.load %{{[^,]*}} {cache
+  %val = tt.load %ptr, %mask, %other {cache = 1 : i32, evict = 1 : i32, isVolatile = false} : tensor<128xf32>
+  // CHECK: tt.store %{{[^,]*}}, %[[VAL]] {cache
+  tt.store %ptr, %val, %mask {cache = 1 : i32, evict = 1 : i32} : tensor<128xf32>
+  tt.return
+}
+
+// -----
+
+// CHECK-LABEL: @fold_with_arg_hint
+tt.func @fold_with_arg_hint(%ptr: tensor<128x!tt.ptr<f32>>, %n: i32 {tt.min_value = 256 : i32}) {
+  %pid = tt.get_program_id x : i32
+  %c1 = arith.constant 1 : i32
+  %c128 = arith.constant 128 : i32
+  %offs = tt.make_range {end = 128 : i32, start = 0 : i32} : tensor<128xi32>
+  // (pid & 1) * 128 + offs < 256 <= n
+  %0 = arith.andi %pid, %c1 : i32
+  %1 = arith.muli %0, %c128 : i32
+  %2 = tt.splat %1 : (i32) -> tensor<128xi32>
+  %3 = arith.addi %2, %offs : tensor<128xi32>
+  %4 = tt.splat %n : (i32) -> tensor<128xi32>
+  // CHECK-NOT: arith.cmpi
+  %mask = arith.cmpi slt, %3, %4 : tensor<128xi32>
+  %val = arith.constant dense<1.000000e+00> : tensor<128xf32>
+  // CHECK: tt.store %{{[^,]*}}, %{{[^,]*}} {cache
+  tt.store %ptr, %val, %mask {cache = 1 : i32, evict = 1 : i32} : tensor<128xf32>
+  tt.return
+}
+
+// -----
+
+// CHECK-LABEL: @keep_unknown_bound
+tt.func @keep_unknown_bound(%ptr: tensor<128x!tt.ptr<f32>>, %n: i32) {
+  %offs = tt.make_range {end = 128 : i32, start = 0 : i32} : tensor<128xi32>
+  %0 = tt.splat %n : (i32) -> tensor<128xi32>
+  // CHECK: %[[MASK:.*]] = arith.cmpi slt
+  %mask = arith.cmpi slt, %offs, %0 : tensor<128xi32>
+  %val = arith.constant dense<1.000000e+00> : tensor<128xf32>
+  // CHECK: tt.store %{{[^,]*}}, %{{[^,]*}}, %[[MASK]]
+  tt.store %ptr, %val, %mask {cache = 1 : i32, evict = 1 : i32} : tensor<128xf32>
+  tt.return
+}
+
+// -----
+
+// CHECK-LABEL: @fold_loop_bound
+tt.func @fold_loop_bound(%lb: i32 {tt.min_value = 0 : i32}, %out: !tt.ptr<i32>) {
+  %c0 = arith.constant 0 : i32
+  %c1 = arith.constant 1 : i32
+  %c16 = arith.constant 16 : i32
+  %cm1 = arith.constant -1 : i32
+  // CHECK: scf.for %[[IV:.*]] =
+  %r = scf.for %iv = %lb to %c16 step %c1 iter_args(%acc = %c0) -> (i32) : i32 {
+    %in = arith.cmpi slt, %iv, %c16 : i32
+    %pos = arith.cmpi sge, %iv, %c0 : i32
+    %ok = arith.andi %in, %pos : i1
+    // CHECK-NOT: arith.cmpi
+    // CHECK-NOT: arith.select
+    %idx = arith.select %ok, %iv, %cm1 : i32
+    // CHECK: arith.addi %{{.*}}, %[[IV]]
+    %next = arith.addi %acc, %idx : i32
+    scf.yield %next : i32
+  }
+  tt.store %out, %r {cache = 1 : i32, evict = 1 : i32} : i32
+  tt.return
+}
+
+// -----
+
+// The accumulator is widened instead of growing one step per iteration of the
+// analysis.
+// CHECK-LABEL: @keep_loop_accumulator
+tt.func @keep_loop_accumulator(%n: i32, %out: !tt.ptr<i32>) {
+  %c0 = arith.constant 0 : i32
+  %c1 = arith.constant 1 : i32
+  %c1024 = arith.constant 1024 : i32
+  %r = scf.for %iv = %c0 to %n step %c1 iter_args(%acc = %c0) -> (i32) : i32 {
+    %next = arith.addi %acc, %c1 : i32
+    scf.yield %next : i32
+  }
+  // CHECK: arith.cmpi slt
+  %in = arith.cmpi slt, %r, %c1024 : i32
+  // CHECK: arith.select
+  %val = arith.select %in, %r, %c0 : i32
+  tt.store %out, %val {cache = 1 : i32, evict = 1 : i32} : i32
+  tt.return
+}
@@ -137,3 +137,54 @@ tt.func public @load_tensors_two_types(%arg0: !tt.ptr<f32, 1> {tt.divisibility =
 }
 
 }
+
+// -----
+
+#blocked = #triton_gpu.blocked<{sizePerThread = [1, 1], threadsPerWarp = [32, 1], warpsPerCTA = [1, 2], order = [0, 1], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [0, 1]}>
+module attributes {"triton_gpu.num-ctas" = 1 : i32, "triton_gpu.num-warps" = 2 : i32} {
+
+// The innermost dimension of the tensor pointer isn't contiguous: each thread
+// loads a single element.
+// CHECK: [[STRIDED_LAYOUT:#.*]] = #triton_gpu.blocked<{sizePerThread = [1, 1], threadsPerWarp = [1, 32], warpsPerCTA = [2, 1], order = [1, 0], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [0, 1]}>
+// CHECK-LABEL: @load_tensor_strided
+tt.func @load_tensor_strided(%arg0: !tt.ptr<f32, 1> {tt.divisibility = 16 : i32}, %arg1: i32 {tt.divisibility = 16 : i32}, %arg2: i32 {tt.divisibility = 16 : i32}) {
+  %c0 = arith.constant 0 : i32
+  %0 = arith.extsi %arg1 : i32 to i64
+  %1 = arith.extsi %arg2 : i32 to i64
+  %2 = tt.make_tensor_ptr %arg0, [%0, %1], [%1, %1], [%c0, %c0] { order = array<i32: 1, 0> } : !tt.ptr<tensor<32x32xf32, #blocked>, 1>
+  // CHECK: !tt.ptr<tensor<32x32xf32, {{.*}}>, 1> -> tensor<32x32xf32, [[STRIDED_LAYOUT]]>
+  %3 = tt.load %2 {cache = 1 : i32, evict = 1 : i32, isVolatile = false} : !tt.ptr<tensor<32x32xf32, #blocked>, 1> -> tensor<32x32xf32, #blocked>
+  tt.return
+}
+
+}
+
+// -----
+
+#blocked = #triton_gpu.blocked<{sizePerThread = [1, 1], threadsPerWarp = [32, 1], warpsPerCTA = [1, 2], order = [0, 1], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [0, 1]}>
+module attributes {"triton_gpu.num-ctas" = 1 : i32, "triton_gpu.num-warps" = 2 : i32} {
+
+// The load is advanced by an unknown offset, but it is grouped with the store
+// of the same tile: both get the layout of the store.
+// CHECK: [[TILE_LAYOUT:#.*]] = #triton_gpu.blocked<{sizePerThread = [1, 8], threadsPerWarp = [8, 4], warpsPerCTA = [2, 1], order = [1, 0], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [0, 1]}>
+// CHECK-LABEL: @copy_tensor_ptr_loop
+tt.func @copy_tensor_ptr_loop(%arg0: !tt.ptr<f16, 1> {tt.divisibility = 16 : i32}, %arg1: !tt.ptr<f16, 1> {tt.divisibility = 16 : i32}, %arg2: i32 {tt.divisibility = 16 : i32}, %arg3: i32, %lb: index, %ub: index, %step: index) {
+  %c0 = arith.constant 0 : i32
+  %c32 = arith.constant 32 : i32
+  %c1 = arith.constant 1 : i64
+  %0 = arith.extsi %arg2 : i32 to i64
+  %in = tt.make_tensor_ptr %arg0, [%0, %0], [%0, %c1], [%c0, %c0] { order = array<i32: 1, 0> } : !tt.ptr<tensor<32x32xf16, #blocked>, 1>
+  %out = tt.make_tensor_ptr %arg1, [%0, %0], [%0, %c1], [%c0, %c0] { order = array<i32: 1, 0> } : !tt.ptr<tensor<32x32xf16, #blocked>, 1>
+  %1:2 = scf.for %iv = %lb to %ub step %step iter_args(%p = %in, %q = %out) -> (!tt.ptr<tensor<32x32xf16, #blocked>, 1>, !tt.ptr<tensor<32x32xf16, #blocked>, 1>) {
+    // CHECK: tt.load {{.*}} -> tensor<32x32xf16, [[TILE_LAYOUT]]>
+    %v = tt.load %p {cache = 1 : i32, evict = 1 : i32, isVolatile = false} : !tt.ptr<tensor<32x32xf16, #blocked>, 1> -> tensor<32x32xf16, #blocked>
+    // CHECK: tt.store {{.*}}, tensor<32x32xf16, [[TILE_LAYOUT]]>
+    tt.store %q, %v {cache = 1 : i32, evict = 1 : i32} : !tt.ptr<tensor<32x32xf16, #blocked>, 1>, tensor<32x32xf16, #blocked>
+    %p_next = tt.advance %p, [%c0, %arg3] : <tensor<32x32xf16, #blocked>, 1>
+    %q_next = tt.advance %q, [%c0, %c32] : <tensor<32x32xf16, #blocked>, 1>
+    scf.yield %p_next, %q_next : !tt.ptr<tensor<32x32xf16, #blocked>, 1>, !tt.ptr<tensor<32x32xf16, #blocked>, 1>
+  }
+  tt.return
+}
+
+}
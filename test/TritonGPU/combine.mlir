@@ -2061,3 +2061,35 @@ module attributes {"triton_gpu.compute-capability" = 80 : i32, "triton_gpu.num-c
     tt.return %4 : tensor<1xi32, #triton_gpu.slice<{dim = 1, parent = #blocked}>>
   }
 }
+
+// -----
+
+#blocked = #triton_gpu.blocked<{sizePerThread = [1, 4], threadsPerWarp = [4, 8], warpsPerCTA = [4, 1], order = [1, 0], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [1, 0]}>
+#mma = #triton_gpu.nvidia_mma<{versionMajor = 2, versionMinor = 0, warpsPerCTA = [4, 1], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [1, 0], instrShape = [16, 8]}>
+#dotA = #triton_gpu.dot_op<{opIdx = 0, parent = #mma, kWidth = 2}>
+#dotB = #triton_gpu.dot_op<{opIdx = 1, parent = #mma, kWidth = 2}>
+module attributes {"triton_gpu.compute-capability" = 80 : i32, "triton_gpu.num-ctas" = 1 : i32, "triton_gpu.num-warps" = 4 : i32, "triton_gpu.threads-per-warp" = 32 : i32} {
+// The sum gets both the MMA layout of the dot and the blocked layout of the
+// load. Keeping it blocked only converts the dot result, while picking MMA
+// would convert the loaded tensor and convert the sum back for the store.
+// CHECK-DAG: [[$BLOCKED_COST:#.*]] = #triton_gpu.blocked<{sizePerThread = [1, 4], threadsPerWarp = [4, 8], warpsPerCTA = [4, 1], order = [1, 0], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [1, 0]}>
+// CHECK-DAG: [[$MMA_COST:#.*]] = #triton_gpu.nvidia_mma<{versionMajor = 2, versionMinor = 0, warpsPerCTA = [4, 1], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [1, 0], instrShape = [16, 8]}>
+// CHECK-LABEL: @resolve_conflict_by_cost
+//       CHECK:   %[[D:.*]] = tt.dot
+//       CHECK:   %[[DC:.*]] = triton_gpu.convert_layout %[[D]] : (tensor<64x64xf32, [[$MMA_COST]]>) -> tensor<64x64xf32, [[$BLOCKED_COST]]>
+//       CHECK:   %[[X:.*]] = tt.load
+//       CHECK:   arith.addf %[[DC]], %[[X]] : tensor<64x64xf32, [[$BLOCKED_COST]]>
+  tt.func @resolve_conflict_by_cost(%a: tensor<64x32xf16, #dotA>, %b: tensor<32x64xf16, #dotB>, %b2: tensor<64x64xf16, #dotB>, %ptr: tensor<64x64x!tt.ptr<f32, 1>, #blocked>, %out: tensor<64x64x!tt.ptr<f32, 1>, #mma>) {
+    %cst = arith.constant dense<0.000000e+00> : tensor<64x64xf32, #mma>
+    %d = tt.dot %a, %b, %cst {allowTF32 = true, maxNumImpreciseAcc = 0 : i32} : tensor<64x32xf16, #dotA> * tensor<32x64xf16, #dotB> -> tensor<64x64xf32, #mma>
+    %dc = triton_gpu.convert_layout %d : (tensor<64x64xf32, #mma>) -> tensor<64x64xf32, #blocked>
+    %x = tt.load %ptr {cache = 1 : i32, evict = 1 : i32, isVolatile = false} : tensor<64x64xf32, #blocked>
+    %s = arith.addf %dc, %x : tensor<64x64xf32, #blocked>
+    tt.store %ptr, %s {cache = 1 : i32, evict = 1 : i32} : tensor<64x64xf32, #blocked>
+    %h = arith.truncf %s : tensor<64x64xf32, #blocked> to tensor<64x64xf16, #blocked>
+    %ha = triton_gpu.convert_layout %h : (tensor<64x64xf16, #blocked>) -> tensor<64x64xf16, #dotA>
+    %e = tt.dot %ha, %b2, %cst {allowTF32 = true, maxNumImpreciseAcc = 0 : i32} : tensor<64x64xf16, #dotA> * tensor<64x64xf16, #dotB> -> tensor<64x64xf32, #mma>
+    tt.store %out, %e {cache = 1 : i32, evict = 1 : i32} : tensor<64x64xf32, #mma>
+    tt.return
+  }
+}
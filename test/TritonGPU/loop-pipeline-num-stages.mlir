@@ -0,0 +1,111 @@
+// RUN: triton-opt %s -split-input-file -tritongpu-pipeline=num-stages=3 -canonicalize | FileCheck %s
+// RUN: triton-opt %s -split-input-file -tritongpu-pipeline="num-stages=8 auto-num-stages=true" -canonicalize | FileCheck %s --check-prefix=AUTO
+// RUN: triton-opt %s -split-input-file -tritongpu-pipeline="num-stages=8 auto-num-stages=true max-shared-mem=131072" -canonicalize | FileCheck %s --check-prefix=SMEM
+
+#AL = #triton_gpu.blocked<{sizePerThread = [1, 4], threadsPerWarp = [4, 8], warpsPerCTA = [4, 1], order = [1, 0], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [1, 0]}>
+#ALs0 = #triton_gpu.slice<{parent=#AL, dim=0}>
+
+module attributes {"triton_gpu.num-warps" = 4 : i32, "triton_gpu.num-ctas" = 1 : i32, "triton_gpu.compute-capability" = 80} {
+// CHECK-LABEL: tt.func @loop_num_stages
+// CHECK: triton_gpu.alloc_tensor : tensor<3x128x32xf32
+// CHECK: triton_gpu.insert_slice_async
+// CHECK: triton_gpu.insert_slice_async
+// CHECK: triton_gpu.insert_slice_async
+// CHECK: triton_gpu.async_wait {num = 2 : i32}
+// CHECK: scf.for
+// CHECK:   triton_gpu.insert_slice_async
+// CHECK:   triton_gpu.async_wait {num = 2 : i32}
+// CHECK:   scf.yield
+// AUTO-LABEL: tt.func @loop_num_stages
+// AUTO: triton_gpu.alloc_tensor : tensor<3x128x32xf32
+tt.func @loop_num_stages(%lb : index, %ub : index, %step : index,
+                         %A : !tt.ptr<f32> {tt.divisibility = 16 : i32}) -> tensor<128x32xf32, #AL> {
+  %a_ptr_splat = tt.splat %A : (!tt.ptr<f32>) -> tensor<128x32x!tt.ptr<f32>, #AL>
+  %a_tmp0 = tt.make_range {end = 32: i32, start = 0: i32} : tensor<32xi32, #ALs0>
+  %a_tmp1 = tt.expand_dims %a_tmp0 {axis = 0 : i32} : (tensor<32xi32, #ALs0>) -> tensor<1x32xi32, #AL>
+  %a_offs = tt.broadcast %a_tmp1 : (tensor<1x32xi32, #AL>) -> tensor<128x32xi32, #AL>
+  %a_ptr_init = tt.addptr %a_ptr_splat, %a_offs : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xi32, #AL>
+  %a_off = arith.constant dense<4> : tensor<128x32xi32, #AL>
+  %acc_init = arith.constant dense<0.00e+00> : tensor<128x32xf32, #AL>
+
+  %loop:2 = scf.for %iv = %lb to %ub step %step iter_args(%a_ptr = %a_ptr_init, %acc = %acc_init) -> (tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xf32, #AL>) {
+    %a = tt.load %a_ptr {cache = 1 : i32, evict = 1 : i32, isVolatile = false} : tensor<128x32xf32, #AL>
+    %next_acc = arith.addf %acc, %a : tensor<128x32xf32, #AL>
+    %next_a_ptr = tt.addptr %a_ptr, %a_off : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xi32, #AL>
+    scf.yield %next_a_ptr, %next_acc : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xf32, #AL>
+  } {tt.num_stages = 4 : i32}
+  tt.return %loop#1 : tensor<128x32xf32, #AL>
+}
+
+// A deeper pipeline for one load only: the other load starts one stage later
+// with one buffer less.
+// CHECK-LABEL: tt.func @load_num_stages
+// CHECK: triton_gpu.alloc_tensor : tensor<3x128x32xf32
+// CHECK: triton_gpu.alloc_tensor : tensor<2x128x32xf32
+// CHECK: triton_gpu.async_wait {num = 2 : i32}
+// CHECK: scf.for
+// CHECK:   triton_gpu.insert_slice_async
+// CHECK:   triton_gpu.insert_slice_async
+// CHECK:   triton_gpu.async_wait {num = 2 : i32}
+// CHECK:   scf.yield
+tt.func @load_num_stages(%lb : index, %ub : index, %step : index,
+                         %A : !tt.ptr<f32> {tt.divisibility = 16 : i32},
+                         %B : !tt.ptr<f32> {tt.divisibility = 16 : i32}) -> tensor<128x32xf32, #AL> {
+  %tmp0 = tt.make_range {end = 32: i32, start = 0: i32} : tensor<32xi32, #ALs0>
+  %tmp1 = tt.expand_dims %tmp0 {axis = 0 : i32} : (tensor<32xi32, #ALs0>) -> tensor<1x32xi32, #AL>
+  %offs = tt.broadcast %tmp1 : (tensor<1x32xi32, #AL>) -> tensor<128x32xi32, #AL>
+  %a_ptr_splat = tt.splat %A : (!tt.ptr<f32>) -> tensor<128x32x!tt.ptr<f32>, #AL>
+  %a_ptr_init = tt.addptr %a_ptr_splat, %offs : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xi32, #AL>
+  %b_ptr_splat = tt.splat %B : (!tt.ptr<f32>) -> tensor<128x32x!tt.ptr<f32>, #AL>
+  %b_ptr_init = tt.addptr %b_ptr_splat, %offs : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xi32, #AL>
+  %off = arith.constant dense<4> : tensor<128x32xi32, #AL>
+  %acc_init = arith.constant dense<0.00e+00> : tensor<128x32xf32, #AL>
+
+  %loop:3 = scf.for %iv = %lb to %ub step %step iter_args(%a_ptr = %a_ptr_init, %b_ptr = %b_ptr_init, %acc = %acc_init) -> (tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xf32, #AL>) {
+    %a = tt.load %a_ptr {cache = 1 : i32, evict = 1 : i32, isVolatile = false, tt.num_stages = 4 : i32} : tensor<128x32xf32, #AL>
+    %b = tt.load %b_ptr {cache = 1 : i32, evict = 1 : i32, isVolatile = false} : tensor<128x32xf32, #AL>
+    %ab = arith.mulf %a, %b : tensor<128x32xf32, #AL>
+    %next_acc = arith.addf %acc, %ab : tensor<128x32xf32, #AL>
+    %next_a_ptr = tt.addptr %a_ptr, %off : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xi32, #AL>
+    %next_b_ptr = tt.addptr %b_ptr, %off : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xi32, #AL>
+    scf.yield %next_a_ptr, %next_b_ptr, %next_acc : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xf32, #AL>
+  }
+  tt.return %loop#2 : tensor<128x32xf32, #AL>
+}
+}
+
+// -----
+
+#AL = #triton_gpu.blocked<{sizePerThread = [1, 4], threadsPerWarp = [4, 8], warpsPerCTA = [4, 1], order = [1, 0], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [1, 0]}>
+#ALs0 = #triton_gpu.slice<{parent=#AL, dim=0}>
+
+// Each stage needs 32KB: 5 buffers are the most that fit in the 163KB of
+// shared memory of sm_80, 4 in the 128KB of a device limited to that.
+module attributes {"triton_gpu.num-warps" = 4 : i32, "triton_gpu.num-ctas" = 1 : i32, "triton_gpu.compute-capability" = 80} {
+// CHECK-LABEL: tt.func @auto_num_stages
+// CHECK: triton_gpu.alloc_tensor : tensor<2x128x64xf32
+// AUTO-LABEL: tt.func @auto_num_stages
+// AUTO: triton_gpu.alloc_tensor : tensor<5x128x64xf32
+// AUTO: triton_gpu.async_wait {num = 4 : i32}
+// SMEM-LABEL: tt.func @auto_num_stages
+// SMEM: triton_gpu.alloc_tensor : tensor<4x128x64xf32
+// SMEM: triton_gpu.async_wait {num = 3 : i32}
+tt.func @auto_num_stages(%lb : index, %ub : index, %step : index,
+                         %A : !tt.ptr<f32> {tt.divisibility = 16 : i32}) -> tensor<128x64xf32, #AL> {
+  %a_ptr_splat = tt.splat %A : (!tt.ptr<f32>) -> tensor<128x64x!tt.ptr<f32>, #AL>
+  %a_tmp0 = tt.make_range {end = 64: i32, start = 0: i32} : tensor<64xi32, #ALs0>
+  %a_tmp1 = tt.expand_dims %a_tmp0 {axis = 0 : i32} : (tensor<64xi32, #ALs0>) -> tensor<1x64xi32, #AL>
+  %a_offs = tt.broadcast %a_tmp1 : (tensor<1x64xi32, #AL>) -> tensor<128x64xi32, #AL>
+  %a_ptr_init = tt.addptr %a_ptr_splat, %a_offs : tensor<128x64x!tt.ptr<f32>, #AL>, tensor<128x64xi32, #AL>
+  %a_off = arith.constant dense<4> : tensor<128x64xi32, #AL>
+  %acc_init = arith.constant dense<0.00e+00> : tensor<128x64xf32, #AL>
+
+  %loop:2 = scf.for %iv = %lb to %ub step %step iter_args(%a_ptr = %a_ptr_init, %acc = %acc_init) -> (tensor<128x64x!tt.ptr<f32>, #AL>, tensor<128x64xf32, #AL>) {
+    %a = tt.load %a_ptr {cache = 1 : i32, evict = 1 : i32, isVolatile = false} : tensor<128x64xf32, #AL>
+    %next_acc = arith.addf %acc, %a : tensor<128x64xf32, #AL>
+    %next_a_ptr = tt.addptr %a_ptr, %a_off : tensor<128x64x!tt.ptr<f32>, #AL>, tensor<128x64xi32, #AL>
+    scf.yield %next_a_ptr, %next_acc : tensor<128x64x!tt.ptr<f32>, #AL>, tensor<128x64xf32, #AL>
+  }
+  tt.return %loop#1 : tensor<128x64xf32, #AL>
+}
+}
@@ -495,6 +495,97 @@ tt.func @dep_arg_two_uses(%arg0: !tt.ptr<f16> {tt.divisibility = 16 : i32},
   }
   tt.return %91#3 : tensor<128x128xf32, #C>
 }
+
+// Loads that do not feed a dot are pipelined through an unswizzled buffer.
+// CHECK-LABEL: tt.func @reduce_loop
+// CHECK: triton_gpu.alloc_tensor : tensor<2x128x32xf32
+// CHECK: triton_gpu.insert_slice_async
+// CHECK: triton_gpu.insert_slice_async
+// CHECK: triton_gpu.async_wait {num = 1 : i32}
+// CHECK: %[[A0:.*]] = triton_gpu.extract_slice
+// CHECK: scf.for {{.*}} iter_args({{.*}}, %[[arg_a0:.*]] = %[[A0]])
+// CHECK:   %[[A:.*]] = triton_gpu.convert_layout %[[arg_a0]] : (tensor<128x32xf32, #{{.*}}>) -> tensor<128x32xf32, #{{.*}}>
+// CHECK:   arith.addf {{.*}}, %[[A]]
+// CHECK:   triton_gpu.insert_slice_async
+// CHECK:   triton_gpu.async_wait {num = 1 : i32}
+// CHECK:   triton_gpu.extract_slice
+// CHECK:   scf.yield
+// CHECK: triton_gpu.async_wait {num = 0 : i32}
+tt.func @reduce_loop(%lb : index, %ub : index, %step : index,
+                     %A : !tt.ptr<f32> {tt.divisibility = 16 : i32}) -> tensor<128x32xf32, #AL> {
+  %a_ptr_splat = tt.splat %A : (!tt.ptr<f32>) -> tensor<128x32x!tt.ptr<f32>, #AL>
+  %a_tmp0 = tt.make_range {end = 32: i32, start = 0: i32} : tensor<32xi32, #ALs0>
+  %a_tmp1 = tt.expand_dims %a_tmp0 {axis = 0 : i32} : (tensor<32xi32, #ALs0>) -> tensor<1x32xi32, #AL>
+  %a_offs = tt.broadcast %a_tmp1 : (tensor<1x32xi32, #AL>) -> tensor<128x32xi32, #AL>
+  %a_ptr_init = tt.addptr %a_ptr_splat, %a_offs : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xi32, #AL>
+  %a_off = arith.constant dense<4> : tensor<128x32xi32, #AL>
+  %acc_init = arith.constant dense<0.00e+00> : tensor<128x32xf32, #AL>
+
+  %loop:2 = scf.for %iv = %lb to %ub step %step iter_args(%a_ptr = %a_ptr_init, %acc = %acc_init) -> (tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xf32, #AL>) {
+    %a = tt.load %a_ptr {cache = 1 : i32, evict = 1 : i32, isVolatile = false} : tensor<128x32xf32, #AL>
+    %next_acc = arith.addf %acc, %a : tensor<128x32xf32, #AL>
+    %next_a_ptr = tt.addptr %a_ptr, %a_off : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xi32, #AL>
+    scf.yield %next_a_ptr, %next_acc : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xf32, #AL>
+  }
+  tt.return %loop#1 : tensor<128x32xf32, #AL>
+}
+
+// Strided loads can only be copied one element at a time: the round trip
+// through shared memory doesn't pay off.
+// CHECK-LABEL: tt.func @reduce_loop_strided
+// CHECK-NOT: triton_gpu.insert_slice_async
+// CHECK: scf.for
+// CHECK:   tt.load
+// CHECK:   scf.yield
+tt.func @reduce_loop_strided(%lb : index, %ub : index, %step : index,
+                             %A : !tt.ptr<f32> {tt.divisibility = 16 : i32}) -> tensor<128x32xf32, #AL> {
+  %a_ptr_splat = tt.splat %A : (!tt.ptr<f32>) -> tensor<128x32x!tt.ptr<f32>, #AL>
+  %a_tmp0 = tt.make_range {end = 32: i32, start = 0: i32} : tensor<32xi32, #ALs0>
+  %a_stride = arith.constant dense<2> : tensor<32xi32, #ALs0>
+  %a_tmp1 = arith.muli %a_tmp0, %a_stride : tensor<32xi32, #ALs0>
+  %a_tmp2 = tt.expand_dims %a_tmp1 {axis = 0 : i32} : (tensor<32xi32, #ALs0>) -> tensor<1x32xi32, #AL>
+  %a_offs = tt.broadcast %a_tmp2 : (tensor<1x32xi32, #AL>) -> tensor<128x32xi32, #AL>
+  %a_ptr_init = tt.addptr %a_ptr_splat, %a_offs : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xi32, #AL>
+  %a_off = arith.constant dense<4> : tensor<128x32xi32, #AL>
+  %acc_init = arith.constant dense<0.00e+00> : tensor<128x32xf32, #AL>
+
+  %loop:2 = scf.for %iv = %lb to %ub step %step iter_args(%a_ptr = %a_ptr_init, %acc = %acc_init) -> (tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xf32, #AL>) {
+    %a = tt.load %a_ptr {cache = 1 : i32, evict = 1 : i32, isVolatile = false} : tensor<128x32xf32, #AL>
+    %next_acc = arith.addf %acc, %a : tensor<128x32xf32, #AL>
+    %next_a_ptr = tt.addptr %a_ptr, %a_off : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xi32, #AL>
+    scf.yield %next_a_ptr, %next_acc : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xf32, #AL>
+  }
+  tt.return %loop#1 : tensor<128x32xf32, #AL>
+}
+
+// The pointer of the load is computed two iterations ahead, which the
+// expander cannot schedule: the loop is left as it was.
+// CHECK-LABEL: tt.func @reduce_loop_unschedulable
+// CHECK-NOT: triton_gpu.alloc_tensor
+// CHECK-NOT: triton_gpu.insert_slice_async
+// CHECK: scf.for
+// CHECK:   tt.load
+// CHECK:   scf.yield
+// CHECK-NOT: triton_gpu.async_wait
+// CHECK: tt.return
+tt.func @reduce_loop_unschedulable(%lb : index, %ub : index, %step : index,
+                                   %A : !tt.ptr<f32> {tt.divisibility = 16 : i32}) -> tensor<128x32xf32, #AL> {
+  %a_ptr_splat = tt.splat %A : (!tt.ptr<f32>) -> tensor<128x32x!tt.ptr<f32>, #AL>
+  %a_tmp0 = tt.make_range {end = 32: i32, start = 0: i32} : tensor<32xi32, #ALs0>
+  %a_tmp1 = tt.expand_dims %a_tmp0 {axis = 0 : i32} : (tensor<32xi32, #ALs0>) -> tensor<1x32xi32, #AL>
+  %a_offs = tt.broadcast %a_tmp1 : (tensor<1x32xi32, #AL>) -> tensor<128x32xi32, #AL>
+  %a_ptr_init = tt.addptr %a_ptr_splat, %a_offs : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xi32, #AL>
+  %a_off = arith.constant dense<4> : tensor<128x32xi32, #AL>
+  %acc_init = arith.constant dense<0.00e+00> : tensor<128x32xf32, #AL>
+
+  %loop:3 = scf.for %iv = %lb to %ub step %step iter_args(%a_ptr = %a_ptr_init, %a_ptr_ahead = %a_ptr_init, %acc = %acc_init) -> (tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xf32, #AL>) {
+    %a = tt.load %a_ptr {cache = 1 : i32, evict = 1 : i32, isVolatile = false} : tensor<128x32xf32, #AL>
+    %next_acc = arith.addf %acc, %a : tensor<128x32xf32, #AL>
+    %next_a_ptr = tt.addptr %a_ptr_ahead, %a_off : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xi32, #AL>
+    scf.yield %a_ptr_ahead, %next_a_ptr, %next_acc : tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32x!tt.ptr<f32>, #AL>, tensor<128x32xf32, #AL>
+  }
+  tt.return %loop#2 : tensor<128x32xf32, #AL>
+}
 }  // end module
 
 // -----
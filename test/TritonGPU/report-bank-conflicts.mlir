@@ -0,0 +1,56 @@
+// RUN: triton-opt %s -split-input-file -triton-report-bank-conflicts -verify-diagnostics
+
+// Every lane of a warp accesses a different row of 128 bytes: without
+// swizzling they all hit the same bank.
+#rows = #triton_gpu.blocked<{sizePerThread = [1, 1], threadsPerWarp = [32, 1], warpsPerCTA = [4, 1], order = [1, 0], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [1, 0]}>
+#shared = #triton_gpu.shared<{vec = 1, perPhase = 1, maxPhase = 1, order = [1, 0], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [1, 0]}>
+#swizzled = #triton_gpu.shared<{vec = 1, perPhase = 1, maxPhase = 32, order = [1, 0], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [1, 0]}>
+
+module attributes {"triton_gpu.num-warps" = 4 : i32, "triton_gpu.num-ctas" = 1 : i32} {
+tt.func @blocked_to_shared(%arg0: tensor<128x32xf32, #rows>) -> tensor<128x32xf32, #swizzled> {
+  // expected-remark @below {{shared memory store has 32-way bank conflicts}}
+  %0 = triton_gpu.convert_layout %arg0 : (tensor<128x32xf32, #rows>) -> tensor<128x32xf32, #shared>
+  %1 = triton_gpu.convert_layout %arg0 : (tensor<128x32xf32, #rows>) -> tensor<128x32xf32, #swizzled>
+  tt.return %1 : tensor<128x32xf32, #swizzled>
+}
+
+tt.func @shared_to_blocked(%arg0: tensor<128x32xf32, #shared>, %arg1: tensor<128x32xf32, #swizzled>) -> tensor<128x32xf32, #rows> {
+  // expected-remark @below {{shared memory load has 32-way bank conflicts}}
+  %0 = triton_gpu.convert_layout %arg0 : (tensor<128x32xf32, #shared>) -> tensor<128x32xf32, #rows>
+  %1 = triton_gpu.convert_layout %arg1 : (tensor<128x32xf32, #swizzled>) -> tensor<128x32xf32, #rows>
+  %2 = arith.addf %0, %1 : tensor<128x32xf32, #rows>
+  tt.return %2 : tensor<128x32xf32, #rows>
+}
+}
+
+// -----
+
+// ldmatrix reads 16 bytes from 8 rows of 128 bytes.
+#mma = #triton_gpu.nvidia_mma<{versionMajor = 2, versionMinor = 0, warpsPerCTA = [4, 1], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [1, 0], instrShape = [16, 8]}>
+#shared = #triton_gpu.shared<{vec = 1, perPhase = 1, maxPhase = 1, order = [1, 0], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [1, 0]}>
+#swizzled = #triton_gpu.shared<{vec = 8, perPhase = 1, maxPhase = 8, order = [1, 0], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [1, 0]}>
+
+module attributes {"triton_gpu.num-warps" = 4 : i32, "triton_gpu.num-ctas" = 1 : i32} {
+tt.func @shared_to_dot_operand(%arg0: tensor<128x64xf16, #shared>, %arg1: tensor<128x64xf16, #swizzled>) {
+  // expected-remark @below {{shared memory load has 8-way bank conflicts}}
+  %0 = triton_gpu.convert_layout %arg0 : (tensor<128x64xf16, #shared>) -> tensor<128x64xf16, #triton_gpu.dot_op<{opIdx = 0, parent = #mma, kWidth = 2}>>
+  %1 = triton_gpu.convert_layout %arg1 : (tensor<128x64xf16, #swizzled>) -> tensor<128x64xf16, #triton_gpu.dot_op<{opIdx = 0, parent = #mma, kWidth = 2}>>
+  tt.return
+}
+}
+
+// -----
+
+// Padding the scratch buffer by one element per column still leaves 2-way
+// conflicts between these layouts.
+#src = #triton_gpu.blocked<{sizePerThread = [1, 4], threadsPerWarp = [2, 16], warpsPerCTA = [4, 1], order = [1, 0], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [1, 0]}>
+#dst = #triton_gpu.blocked<{sizePerThread = [4, 1], threadsPerWarp = [16, 2], warpsPerCTA = [1, 4], order = [0, 1], CTAsPerCGA = [1, 1], CTASplitNum = [1, 1], CTAOrder = [1, 0]}>
+
+module attributes {"triton_gpu.num-warps" = 4 : i32, "triton_gpu.num-ctas" = 1 : i32} {
+tt.func @blocked_to_blocked(%arg0: tensor<64x64xf32, #src>) -> tensor<64x64xf32, #dst> {
+  // expected-remark @+2 {{shared memory store has 2-way bank conflicts}}
+  // expected-remark @+1 {{shared memory load has 2-way bank conflicts}}
+  %0 = triton_gpu.convert_layout %arg0 : (tensor<64x64xf32, #src>) -> tensor<64x64xf32, #dst>
+  tt.return %0 : tensor<64x64xf32, #dst>
+}
+}
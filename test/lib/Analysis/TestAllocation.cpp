@@ -46,6 +46,8 @@ struct TestAllocationPass
         }
       });
       os << "size = " << allocation->getSharedMemorySize() << "\n";
+      os << "first-fit size = " << allocation->getFirstFitSharedMemorySize()
+         << "\n";
     });
   }
 };
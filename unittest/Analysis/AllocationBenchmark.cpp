@@ -0,0 +1,161 @@
+//===- AllocationBenchmark.cpp - Timing of shared memory allocation -------===//
+//
+// Runs ModuleAllocation on synthetic functions with a growing number of
+// shared memory buffers. Each buffer stays live while the next few buffers are
+// defined, so the interference grows with the window and not with the total
+// number of buffers.
+//
+// The small configurations check the allocation itself. The timing runs are
+// disabled by default; pass --gtest_also_run_disabled_tests to run them.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "triton/Analysis/Allocation.h"
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonGPU/IR/Dialect.h"
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+namespace mlir {
+namespace {
+
+struct AllocationBenchmarkParams {
+  unsigned numBuffers;
+  unsigned liveWindow;
+};
+
+/// Builds a function defining `numBuffers` shared memory constants of varying
+/// sizes, where each constant is read back `liveWindow` definitions later.
+/// The constants are appended to `buffers` in definition order.
+OwningOpRef<ModuleOp> buildSyntheticModule(MLIRContext &ctx,
+                                           AllocationBenchmarkParams params,
+                                           SmallVectorImpl<Value> &buffers) {
+  OpBuilder builder(&ctx);
+  auto loc = builder.getUnknownLoc();
+  OwningOpRef<ModuleOp> module = ModuleOp::create(loc);
+  (*module)->setAttr("triton_gpu.num-warps", builder.getI32IntegerAttr(4));
+  (*module)->setAttr("triton_gpu.num-ctas", builder.getI32IntegerAttr(1));
+
+  builder.setInsertionPointToEnd(module->getBody());
+  auto funcOp = builder.create<triton::FuncOp>(
+      loc, "synthetic", builder.getFunctionType({}, {}));
+  builder.setInsertionPointToStart(funcOp.addEntryBlock());
+
+  auto CTALayout =
+      triton::gpu::CTALayoutAttr::get(&ctx, {1, 1}, {1, 1}, {1, 0});
+  auto shared =
+      triton::gpu::SharedEncodingAttr::get(&ctx, 1, 1, 1, {1, 0}, CTALayout);
+  auto blocked = triton::gpu::BlockedEncodingAttr::get(
+      &ctx, {1, 1}, {1, 32}, {4, 1}, {1, 0}, CTALayout);
+  auto elemTy = builder.getF16Type();
+
+  const SmallVector<int64_t> rows = {8, 16, 32, 64};
+  SmallVector<Value> live;
+  auto readBack = [&](Value value) {
+    auto tensorTy = value.getType().cast<RankedTensorType>();
+    auto dstTy = RankedTensorType::get(tensorTy.getShape(), elemTy, blocked);
+    builder.create<triton::gpu::ConvertLayoutOp>(loc, dstTy, value);
+  };
+  for (unsigned i = 0; i < params.numBuffers; ++i) {
+    auto tensorTy =
+        RankedTensorType::get({rows[i % rows.size()], 16}, elemTy, shared);
+    auto value = builder.create<arith::ConstantOp>(
+        loc, DenseElementsAttr::get(tensorTy, builder.getF16FloatAttr(0)));
+    live.push_back(value);
+    if (live.size() > params.liveWindow)
+      readBack(live[live.size() - params.liveWindow - 1]);
+  }
+  size_t numPending = std::min<size_t>(live.size(), params.liveWindow);
+  for (auto value : llvm::drop_begin(live, live.size() - numPending))
+    readBack(value);
+  builder.create<triton::ReturnOp>(loc);
+  buffers.append(live.begin(), live.end());
+  return module;
+}
+
+void loadDialects(MLIRContext &ctx) {
+  ctx.loadDialect<triton::TritonDialect, triton::gpu::TritonGPUDialect,
+                  arith::ArithDialect>();
+}
+
+class AllocationTest
+    : public ::testing::TestWithParam<AllocationBenchmarkParams> {};
+
+TEST_P(AllocationTest, SyntheticBuffers) {
+  auto params = GetParam();
+  MLIRContext ctx;
+  loadDialects(ctx);
+  SmallVector<Value> buffers;
+  auto module = buildSyntheticModule(ctx, params, buffers);
+  ModuleAllocation allocation(*module);
+
+  auto funcOp = *module->getOps<triton::FuncOp>().begin();
+  auto *funcAlloc = allocation.getFuncData(funcOp);
+  // The largest buffer is 64x16xf16.
+  size_t maxBytes = 64 * 16 * 2;
+  EXPECT_GE(funcAlloc->getSharedMemorySize(), maxBytes);
+  EXPECT_LE(funcAlloc->getSharedMemorySize(),
+            funcAlloc->getFirstFitSharedMemorySize());
+
+  // Buffer i is still live when the next `liveWindow` buffers are defined, so
+  // none of them may share memory with it.
+  for (unsigned i = 0; i < buffers.size(); ++i) {
+    auto interval =
+        funcAlloc->getAllocatedInterval(funcAlloc->getBufferId(buffers[i]));
+    EXPECT_LE(interval.end(), funcAlloc->getSharedMemorySize());
+    for (unsigned j = i + 1;
+         j < buffers.size() && j <= i + params.liveWindow; ++j) {
+      auto other =
+          funcAlloc->getAllocatedInterval(funcAlloc->getBufferId(buffers[j]));
+      EXPECT_FALSE(interval.intersects(other))
+          << "buffers " << i << " and " << j << " overlap";
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Allocation, AllocationTest,
+    ::testing::Values(AllocationBenchmarkParams{10, 4},
+                      AllocationBenchmarkParams{100, 4},
+                      AllocationBenchmarkParams{100, 32}));
+
+class AllocationBenchmark
+    : public ::testing::TestWithParam<AllocationBenchmarkParams> {};
+
+TEST_P(AllocationBenchmark, DISABLED_SyntheticBuffers) {
+  auto params = GetParam();
+  MLIRContext ctx;
+  loadDialects(ctx);
+  SmallVector<Value> buffers;
+  auto module = buildSyntheticModule(ctx, params, buffers);
+
+  auto begin = std::chrono::steady_clock::now();
+  ModuleAllocation allocation(*module);
+  auto end = std::chrono::steady_clock::now();
+
+  auto funcOp = *module->getOps<triton::FuncOp>().begin();
+  auto *funcAlloc = allocation.getFuncData(funcOp);
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+  llvm::outs() << "buffers = " << params.numBuffers
+               << ", window = " << params.liveWindow
+               << ", time = " << us.count() << " us"
+               << ", size = " << funcAlloc->getSharedMemorySize()
+               << ", first-fit size = "
+               << funcAlloc->getFirstFitSharedMemorySize() << "\n";
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Allocation, AllocationBenchmark,
+    ::testing::Values(AllocationBenchmarkParams{10, 4},
+                      AllocationBenchmarkParams{100, 4},
+                      AllocationBenchmarkParams{1000, 4},
+                      AllocationBenchmarkParams{10000, 4},
+                      AllocationBenchmarkParams{1000, 32},
+                      AllocationBenchmarkParams{10000, 32}));
+
+} // namespace
+} // namespace mlir
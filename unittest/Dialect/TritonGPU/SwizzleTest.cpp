@@ -1,7 +1,9 @@
+#include "triton/Analysis/BankConflicts.h"
 #include "triton/Dialect/TritonGPU/IR/Dialect.h"
 #include <gtest/gtest.h>
 
 using namespace mlir;
+using mlir::triton::gpu::BlockedEncodingAttr;
 using mlir::triton::gpu::SharedEncodingAttr;
 
 struct swizzleParams {
@@ -56,3 +58,86 @@ INSTANTIATE_TEST_SUITE_P(TestDotOperands, SwizzleDotOperandTestFixture,
                                            ParamT{{32, 32}, 1, 16, {8, 2, 4}},
                                            ParamT{{16, 16}, 0, 16, {8, 4, 2}},
                                            ParamT{{16, 16}, 1, 16, {8, 4, 2}}));
+
+// The swizzling of Ampere dot operands must make ldmatrix conflict free. It
+// is used for any order of 16-bit operands, and for other types only when the
+// K dimension is contiguous.
+TEST(SwizzleDotOperandTest, LdmatrixConflictFree) {
+  MLIRContext ctx;
+  ctx.loadDialect<triton::gpu::TritonGPUDialect>();
+  auto CTALayout =
+      triton::gpu::CTALayoutAttr::get(&ctx, {1, 1}, {1, 1}, {0, 1});
+  auto parent = triton::gpu::NvidiaMmaEncodingAttr::get(
+      &ctx, 2, 0, {1, 1}, CTALayout, {16, 8});
+  for (unsigned typeWidth : {8, 16, 32}) {
+    Type eltType = IntegerType::get(&ctx, typeWidth);
+    for (unsigned opIdx : {0, 1}) {
+      auto encoding = triton::gpu::DotOperandEncodingAttr::get(
+          &ctx, opIdx, parent, 32 / typeWidth);
+      unsigned kOrder = opIdx == 0 ? 1 : 0;
+      for (SmallVector<unsigned> order :
+           {SmallVector<unsigned>{1, 0}, SmallVector<unsigned>{0, 1}}) {
+        if (typeWidth != 16 && order[0] != kOrder)
+          continue;
+        for (int64_t rows : {16, 32, 64, 128, 256}) {
+          for (int64_t cols : {16, 32, 64, 128, 256}) {
+            SmallVector<int64_t> shape = {rows, cols};
+            auto layout = SharedEncodingAttr::get(&ctx, encoding, shape, order,
+                                                  CTALayout, eltType);
+            EXPECT_EQ(getLdmatrixBankConflicts(layout, shape, typeWidth), 1u)
+                << "typeWidth=" << typeWidth << " opIdx=" << opIdx
+                << " order=[" << order[0] << ", " << order[1]
+                << "] shape=[" << rows << ", " << cols << "]";
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(BankConflictTest, Degree) {
+  auto strided = [](int64_t stride, unsigned numLanes) {
+    SmallVector<int64_t> offsets;
+    for (unsigned lane = 0; lane < numLanes; ++lane)
+      offsets.push_back(lane * stride);
+    return offsets;
+  };
+  // Consecutive words and broadcasts are conflict free.
+  EXPECT_EQ(getBankConflictDegree(strided(4, 32), 4), 1u);
+  EXPECT_EQ(getBankConflictDegree(strided(0, 32), 4), 1u);
+  EXPECT_EQ(getBankConflictDegree(strided(2, 32), 2), 1u);
+  // Every lane hits the same bank.
+  EXPECT_EQ(getBankConflictDegree(strided(128, 32), 4), 32u);
+  EXPECT_EQ(getBankConflictDegree(strided(8, 32), 4), 2u);
+  // Wide accesses are served a quarter or a half warp at a time.
+  EXPECT_EQ(getBankConflictDegree(strided(16, 32), 16), 1u);
+  EXPECT_EQ(getBankConflictDegree(strided(16, 32), 8), 2u);
+  EXPECT_EQ(getBankConflictDegree(strided(128, 32), 16), 8u);
+}
+
+TEST(BankConflictTest, MinBankConflictSharedEncoding) {
+  MLIRContext ctx;
+  ctx.loadDialect<triton::gpu::TritonGPUDialect>();
+  auto CTALayout =
+      triton::gpu::CTALayoutAttr::get(&ctx, {1, 1}, {1, 1}, {0, 1});
+  Type f32 = FloatType::getF32(&ctx);
+
+  // Rows are accessed 4 elements at a time by 8 lanes: no swizzling needed.
+  auto rowMajor =
+      BlockedEncodingAttr::get(&ctx, {1, 4}, {4, 8}, {4, 1}, {1, 0}, CTALayout);
+  auto rowMajorTy = RankedTensorType::get({128, 32}, f32, rowMajor);
+  auto layout = getMinBankConflictSharedEncoding(rowMajorTy, {1, 0}, 4);
+  EXPECT_EQ(layout.getVec(), 4u);
+  EXPECT_EQ(layout.getMaxPhase(), 1u);
+  EXPECT_EQ(getBlockedAccessBankConflicts(rowMajorTy, layout, 4), 1u);
+
+  // Every lane accesses a different row of 32 elements.
+  auto colMajor =
+      BlockedEncodingAttr::get(&ctx, {1, 1}, {32, 1}, {4, 1}, {1, 0}, CTALayout);
+  auto colMajorTy = RankedTensorType::get({128, 32}, f32, colMajor);
+  auto unswizzled = SharedEncodingAttr::get(&ctx, 1, 1, 1, {1, 0}, CTALayout);
+  EXPECT_EQ(getBlockedAccessBankConflicts(colMajorTy, unswizzled, 1), 32u);
+  layout = getMinBankConflictSharedEncoding(colMajorTy, {1, 0}, 1);
+  EXPECT_GT(layout.getMaxPhase(), 1u);
+  EXPECT_EQ(getBlockedAccessBankConflicts(colMajorTy, layout, 1), 1u);
+}